@@ -0,0 +1,185 @@
+#include "asset_store.h"
+#include "crc32.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(ESP_PLATFORM)
+#include <esp_idf_version.h>
+#include <esp_partition.h>
+#if ESP_IDF_VERSION < ESP_IDF_VERSION_VAL(5, 1, 0)
+// IDF 4.4 (Arduino 2.x): partition mmap still uses the spi_flash types
+#include <esp_spi_flash.h>
+typedef spi_flash_mmap_handle_t esp_partition_mmap_handle_t;
+#define ESP_PARTITION_MMAP_DATA SPI_FLASH_MMAP_DATA
+#define esp_partition_munmap    spi_flash_munmap
+#endif
+#endif
+
+#if defined(ARDUINO)
+#include <lvgl.h>
+#endif
+
+static const uint8_t* g_pack = nullptr;   // mapped partition or file buffer
+static const AssetPackEntry* g_entries = nullptr;
+static uint16_t g_count = 0;
+static void* g_file_buf = nullptr;        // owned only by the file stand-in
+
+#if defined(ESP_PLATFORM)
+static esp_partition_mmap_handle_t g_mmap_handle;
+static bool g_mapped = false;
+#endif
+
+#if defined(ARDUINO)
+static lv_image_dsc_t* g_dscs = nullptr;  // one descriptor per entry, same order
+#endif
+
+// Validates the pack at `base` (of `avail` bytes) and publishes it
+static bool attach_pack(const uint8_t* base, size_t avail) {
+    if (avail < sizeof(AssetPackHeader)) return false;
+    const AssetPackHeader* hdr = (const AssetPackHeader*)base;
+    if (hdr->magic != ASSET_PACK_MAGIC || hdr->version != ASSET_PACK_VERSION) return false;
+    if (hdr->total_size > avail) return false;
+
+    size_t table_size = (size_t)hdr->count * sizeof(AssetPackEntry);
+    if (sizeof(AssetPackHeader) + table_size > hdr->total_size) return false;
+    const AssetPackEntry* entries = (const AssetPackEntry*)(base + sizeof(AssetPackHeader));
+    if (crc32_update(0, entries, table_size) != hdr->table_crc) return false;
+
+    for (uint16_t i = 0; i < hdr->count; i++) {
+        const AssetPackEntry& e = entries[i];
+        if (e.name[ASSET_NAME_LEN - 1] != '\0') return false;
+        if ((e.offset % ASSET_PACK_ALIGN) != 0) return false;
+        if ((uint64_t)e.offset + e.size > hdr->total_size) return false;
+    }
+
+#if defined(ARDUINO)
+    g_dscs = (lv_image_dsc_t*)calloc(hdr->count ? hdr->count : 1, sizeof(lv_image_dsc_t));
+    if (!g_dscs) return false;
+    for (uint16_t i = 0; i < hdr->count; i++) {
+        const AssetPackEntry& e = entries[i];
+        lv_image_dsc_t& d = g_dscs[i];
+        d.header.magic = LV_IMAGE_HEADER_MAGIC;
+        d.header.cf = e.cf;
+        d.header.w = e.w;
+        d.header.h = e.h;
+        d.header.stride = e.stride;
+        d.data_size = e.size;
+        d.data = base + e.offset;
+    }
+#endif
+
+    g_pack = base;
+    g_entries = entries;
+    g_count = hdr->count;
+    return true;
+}
+
+bool asset_store_begin() {
+#if defined(ESP_PLATFORM)
+    if (g_pack) return true;
+    const esp_partition_t* part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, ASSET_PARTITION);
+    if (!part) return false;
+
+    // Peek at the header first so only the used part of the partition is mapped
+    AssetPackHeader hdr;
+    if (esp_partition_read(part, 0, &hdr, sizeof(hdr)) != ESP_OK) return false;
+    if (hdr.magic != ASSET_PACK_MAGIC || hdr.total_size == 0 || hdr.total_size > part->size) return false;
+
+    const void* ptr = nullptr;
+    if (esp_partition_mmap(part, 0, hdr.total_size, ESP_PARTITION_MMAP_DATA, &ptr, &g_mmap_handle) != ESP_OK) return false;
+    g_mapped = true;
+
+    if (!attach_pack((const uint8_t*)ptr, hdr.total_size)) {
+        asset_store_end();
+        return false;
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool asset_store_begin_file(const char* path) {
+    if (g_pack) asset_store_end();
+
+    FILE* f = fopen(path, "rb");
+    if (!f) return false;
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    if (size <= 0) { fclose(f); return false; }
+
+    g_file_buf = malloc((size_t)size);
+    bool ok = g_file_buf && fread(g_file_buf, 1, (size_t)size, f) == (size_t)size;
+    fclose(f);
+
+    if (!ok || !attach_pack((const uint8_t*)g_file_buf, (size_t)size)) {
+        asset_store_end();
+        return false;
+    }
+    return true;
+}
+
+void asset_store_end() {
+#if defined(ARDUINO)
+    free(g_dscs);
+    g_dscs = nullptr;
+#endif
+#if defined(ESP_PLATFORM)
+    if (g_mapped) {
+        esp_partition_munmap(g_mmap_handle);
+        g_mapped = false;
+    }
+#endif
+    free(g_file_buf);
+    g_file_buf = nullptr;
+    g_pack = nullptr;
+    g_entries = nullptr;
+    g_count = 0;
+}
+
+bool asset_store_ready() {
+    return g_pack != nullptr;
+}
+
+uint16_t asset_store_count() {
+    return g_count;
+}
+
+const AssetPackEntry* asset_store_entry(uint16_t idx) {
+    return (idx < g_count) ? &g_entries[idx] : nullptr;
+}
+
+static int find_index(const char* name) {
+    if (!g_pack || !name || name[0] == '\0') return -1;
+    // Table is sorted by name (byte order) by the packer
+    int lo = 0, hi = (int)g_count - 1;
+    while (lo <= hi) {
+        int mid = (lo + hi) / 2;
+        int c = strncmp(name, g_entries[mid].name, ASSET_NAME_LEN);
+        if (c == 0) return mid;
+        if (c < 0) hi = mid - 1;
+        else lo = mid + 1;
+    }
+    return -1;
+}
+
+const AssetPackEntry* asset_store_find(const char* name) {
+    int idx = find_index(name);
+    return (idx >= 0) ? &g_entries[idx] : nullptr;
+}
+
+const uint8_t* asset_store_data(const AssetPackEntry* e) {
+    return (g_pack && e) ? g_pack + e->offset : nullptr;
+}
+
+const void* asset_store_image(const char* name) {
+#if defined(ARDUINO)
+    int idx = find_index(name);
+    return (idx >= 0) ? &g_dscs[idx] : nullptr;
+#else
+    (void)name;
+    return nullptr;
+#endif
+}
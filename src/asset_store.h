@@ -0,0 +1,65 @@
+#ifndef ASSET_STORE_H
+#define ASSET_STORE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ==========================================
+// PACKED ICON STORE (raw "assets" partition)
+// ==========================================
+// Read-only image table produced by tools/pack_assets.py:
+//
+//   AssetPackHeader | AssetPackEntry[count] (sorted by name) | pixel blocks
+//
+// Pixel blocks are already in an LVGL color format and start on an
+// ASSET_PACK_ALIGN boundary, so once the partition is memory-mapped LVGL
+// draws them straight from cached flash: no filesystem, no decoder, no copy.
+
+#define ASSET_PACK_MAGIC    0x31414450u // "PDA1"
+#define ASSET_PACK_VERSION  1
+#define ASSET_PACK_ALIGN    64
+#define ASSET_NAME_LEN      32
+#define ASSET_PARTITION     "assets"
+
+struct AssetPackHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t count;
+    uint32_t table_crc;  // crc32 of the entry table
+    uint32_t total_size; // bytes used by the pack, header included
+};
+
+struct AssetPackEntry {
+    char name[ASSET_NAME_LEN]; // "/icon.png", same form as ButtonConfig::imgPath
+    uint32_t offset;           // from the start of the pack
+    uint32_t size;             // pixel block size in bytes
+    uint16_t w;
+    uint16_t h;
+    uint16_t stride;
+    uint8_t cf;                // lv_color_format_t
+    uint8_t reserved;
+};
+
+static_assert(sizeof(AssetPackHeader) == 16, "pack header layout");
+static_assert(sizeof(AssetPackEntry) == 48, "pack entry layout");
+
+// Maps the "assets" partition. Returns false if there is no such partition
+// or it does not hold a valid pack (the caller simply falls back to LittleFS).
+bool asset_store_begin();
+
+// File-backed stand-in: loads a pack image from a regular file. Used on the
+// host to exercise the packer output and the lookup code without hardware.
+bool asset_store_begin_file(const char* path);
+
+void asset_store_end();
+bool asset_store_ready();
+uint16_t asset_store_count();
+const AssetPackEntry* asset_store_entry(uint16_t idx);
+const AssetPackEntry* asset_store_find(const char* name);
+const uint8_t* asset_store_data(const AssetPackEntry* e);
+
+// LVGL image source (an lv_image_dsc_t pointing into the mapped partition)
+// for `name`, or nullptr if the pack does not contain it.
+const void* asset_store_image(const char* name);
+
+#endif // ASSET_STORE_H
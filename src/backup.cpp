@@ -0,0 +1,1386 @@
+#include "backup.h"
+#include "json_writer.h"
+#include "json_reader.h"
+#include "gzip_stream.h"
+#include "crc32.h"
+#include "profiles.h"
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <esp_heap_caps.h>
+#include <esp_timer.h>
+#include <rom/miniz.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <new>
+#include <vector>
+
+enum BackupStage : uint8_t {
+    BK_HEAD, BK_PROFILE, BK_BUTTON, BK_PROFILE_END,
+    BK_ASSETS, BK_ASSET_NEXT, BK_ASSET_DATA, BK_TAIL,
+    BK_BIN_HEAD, BK_BIN_DECK, BK_BIN_DATA, BK_BIN_FILES, BK_BIN_FILE_NEXT, BK_BIN_DELETES, BK_BIN_END,
+    BK_DONE
+};
+
+struct BaseEntry {
+    char key[JSON_READER_KEY]; // "deck:0", "profile:<name>", "file:<name>"
+    uint32_t crc;
+    uint32_t size;
+    bool seen;                 // still exists
+};
+
+struct BackupBase : public JsonHandler {
+    JsonReader reader{*this};
+    std::vector<BaseEntry> entries;
+    char key[JSON_READER_KEY] = "";
+    char val[24];
+    size_t val_len = 0;
+    char error[48] = "";
+
+    bool fail(const char* msg) {
+        if (!error[0]) strncpy(error, msg, sizeof(error) - 1);
+        return false;
+    }
+
+    bool on_begin(bool array) override {
+        return (!array && reader.depth() == 1) || fail("not a manifest");
+    }
+    bool on_end(bool) override { return true; }
+    bool on_key(const char* k) override {
+        strncpy(key, k, sizeof(key) - 1);
+        key[sizeof(key) - 1] = 0;
+        return true;
+    }
+    bool on_string(const char* s, size_t n, bool done) override {
+        size_t k = n < sizeof(val) - 1 - val_len ? n : sizeof(val) - 1 - val_len;
+        memcpy(val + val_len, s, k);
+        val_len += k;
+        if (!done) return true;
+        val[val_len] = 0;
+        val_len = 0;
+        BaseEntry e = {};
+        strcpy(e.key, key);
+        char* end;
+        e.crc = strtoul(val, &end, 16);
+        if (*end != ':') return fail("bad manifest entry");
+        e.size = strtoul(end + 1, nullptr, 10);
+        if (entries.size() >= BACKUP_BASE_MAX) return fail("manifest too large");
+        entries.push_back(e);
+        return true;
+    }
+    bool on_number(double) override { return fail("bad manifest entry"); }
+    bool on_literal(char) override { return fail("bad manifest entry"); }
+};
+
+// CRCs of assets, by name. Backups, uploads and deletes use it from the web
+// server's task, restores from the job task: g_hashes_lock guards it.
+struct FileHash {
+    char name[32];
+    uint32_t size;
+    uint32_t crc;
+};
+
+static std::vector<FileHash> g_hashes;
+static SemaphoreHandle_t g_hashes_lock = xSemaphoreCreateMutex();
+
+// Caller holds g_hashes_lock; `name` without the leading '/'
+static void forget_hash(const char* name) {
+    for (size_t i = 0; i < g_hashes.size(); i++) {
+        if (!strcmp(g_hashes[i].name, name)) {
+            g_hashes.erase(g_hashes.begin() + i);
+            return;
+        }
+    }
+}
+
+struct BackupStream {
+    BackupSettings settings;
+    backup_skip_fn skip;
+    BackupStage stage = BK_HEAD;
+    uint8_t profile = 0;
+    size_t button = 0;
+    File dir;
+    File file;
+    uint8_t carry[2];          // asset bytes not encoded yet (not a multiple of 3)
+    uint8_t carry_len = 0;
+    uint32_t assets = 0;
+    uint32_t bytes = 0;
+    int64_t t0 = 0;
+    char text[BACKUP_PART_MAX];
+    JsonWriter w{text, sizeof(text)};
+    uint8_t in[BACKUP_READ_BYTES + 2];
+    char enc[(BACKUP_READ_BYTES + 2) / 3 * 4 + 4];
+    const uint8_t* out = nullptr;
+    size_t out_len = 0;
+
+    // Binary archive: parts are built in `text`; a manifest goes through `w`
+    BackupFormat format = BACKUP_JSON;
+    BackupBase* base = nullptr;
+    GzipStream* gz = nullptr;  // nullptr: entries are stored
+    bool deflate = false;      // current entry
+    bool in_files = false;
+    uint32_t left = 0;         // raw bytes of the current entry still to read
+    uint32_t raw_crc = 0;
+    uint32_t arc_crc = 0;      // every byte before the end entry
+    uint32_t entries = 0;
+};
+
+static const char B64[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+// `len` a multiple of 3 unless it is the end of the data
+static size_t b64_encode(const uint8_t* in, size_t len, char* out) {
+    char* o = out;
+    size_t i = 0;
+    for (; i + 3 <= len; i += 3) {
+        uint32_t v = (in[i] << 16) | (in[i + 1] << 8) | in[i + 2];
+        *o++ = B64[v >> 18];
+        *o++ = B64[(v >> 12) & 63];
+        *o++ = B64[(v >> 6) & 63];
+        *o++ = B64[v & 63];
+    }
+    if (i < len) {
+        uint32_t v = in[i] << 16;
+        if (i + 1 < len) v |= in[i + 1] << 8;
+        *o++ = B64[v >> 18];
+        *o++ = B64[(v >> 12) & 63];
+        *o++ = i + 1 < len ? B64[(v >> 6) & 63] : '=';
+        *o++ = '=';
+    }
+    return o - out;
+}
+
+static void write_button(JsonWriter& w, const Button& btn) {
+    w.begin_object().str("label", btn.label).str("value", btn.value).num("type", btn.type);
+    w.hex("color", btn.color).str("icon", btn.icon).str("img", btn.imgPath).end_object();
+}
+
+static void next_asset(BackupStream* b) {
+    while (b->dir) {
+        b->file = b->dir.openNextFile();
+        if (!b->file) break;
+        if (!b->file.isDirectory() && !(b->skip && b->skip(b->file.name()))) {
+            b->w.begin_str(b->file.name());
+            b->carry_len = 0;
+            b->assets++;
+            b->stage = BK_ASSET_DATA;
+            return;
+        }
+        b->file.close();
+    }
+    b->stage = BK_TAIL;
+}
+
+static void asset_data(BackupStream* b) {
+    memcpy(b->in, b->carry, b->carry_len);
+    size_t n = b->carry_len + b->file.read(b->in + b->carry_len, BACKUP_READ_BYTES);
+    bool eof = n < (size_t)BACKUP_READ_BYTES + b->carry_len;
+    size_t whole = eof ? n : n / 3 * 3;
+    b->carry_len = n - whole;
+    memcpy(b->carry, b->in + whole, b->carry_len);
+
+    b->w.raw(b->enc, b64_encode(b->in, whole, b->enc));
+    if (eof) {
+        b->file.close();
+        b->w.end_str();
+        b->stage = BK_ASSET_NEXT;
+    }
+}
+
+// One part: a settings header, a button, a file's next chunk, ...
+static void write_part(BackupStream* b) {
+    JsonWriter& w = b->w;
+    const BackupSettings& s = b->settings;
+    w.clear();
+    switch (b->stage) {
+        case BK_HEAD:
+            w.begin_object();
+            w.hex("bg", s.bg).num("rows", s.rows).num("cols", s.cols).num("os", s.os);
+            w.num("profile", s.profile).num("lang", s.lang).str("wifi_ssid", s.wifi_ssid);
+            w.num("page_slots", DECK_PAGE_SLOTS);
+            b->stage = BK_PROFILE;
+            break;
+        case BK_PROFILE: {
+            // The two built-in decks have their own keys, the others go in "profiles"
+            const Profile* p = profile_get(b->profile);
+            if (b->profile == 0) w.begin_array("win_btns");
+            else if (b->profile == 1) w.begin_array("mac_btns");
+            else {
+                if (b->profile == PROFILE_BUILTIN) w.begin_array("profiles");
+                if (!p) { w.end_array(); b->stage = BK_ASSETS; break; }
+                w.begin_object().str("name", p->name).num("os", p->os).begin_array("btns");
+            }
+            b->button = 0;
+            b->stage = BK_BUTTON;
+            break;
+        }
+        case BK_BUTTON: {
+            const Profile* p = profile_get(b->profile);
+            if (!p || b->button >= (size_t)p->deck.page_count * DECK_PAGE_SLOTS) { b->stage = BK_PROFILE_END; break; }
+            write_button(w, p->deck.buttons[b->button++]);
+            break;
+        }
+        case BK_PROFILE_END:
+            w.end_array();
+            if (b->profile >= PROFILE_BUILTIN) w.end_object();
+            b->profile++;
+            b->stage = BK_PROFILE;
+            break;
+        case BK_ASSETS:
+            w.begin_object("assets");
+            b->dir = LittleFS.open("/");
+            b->stage = BK_ASSET_NEXT;
+            break;
+        case BK_ASSET_NEXT:
+            next_asset(b);
+            break;
+        case BK_ASSET_DATA:
+            asset_data(b);
+            break;
+        case BK_TAIL:
+            if (b->dir) b->dir.close();
+            w.end_object().end_object();
+            b->stage = BK_DONE;
+            break;
+        default:
+            break;
+    }
+}
+
+static void put16(uint8_t* p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void put32(uint8_t* p, uint32_t v) {
+    for (int i = 0; i < 4; i++) p[i] = (uint8_t)(v >> (8 * i));
+}
+
+// Already compressed formats are stored as they are
+static bool worth_deflating(const char* name) {
+    static const char* const STORED[] = {".png", ".jpg", ".jpeg", ".gif", ".webp", ".gz"};
+    const char* ext = strrchr(name, '.');
+    if (!ext) return true;
+    for (const char* e : STORED) {
+        if (!strcasecmp(ext, e)) return false;
+    }
+    return true;
+}
+
+// Entry header for the file open in `b->file`, whose data follows in BK_BIN_DATA parts
+static size_t bin_entry(BackupStream* b, uint8_t* p, uint8_t kind, uint8_t arg, const char* name, bool deflate) {
+    size_t name_len = strlen(name);
+    if (name_len > 255) name_len = 255;
+    b->deflate = deflate && b->gz;
+    if (b->deflate) gzip_reset(b->gz);
+    b->left = b->file.size();
+    b->raw_crc = 0;
+    BinEntry e = { kind, (uint8_t)(b->deflate ? BIN_F_DEFLATE : 0), (uint8_t)name_len, arg, b->left };
+    memcpy(p, &e, sizeof(e));
+    memcpy(p + sizeof(e), name, name_len);
+    b->stage = BK_BIN_DATA;
+    return sizeof(e) + name_len;
+}
+
+// One block of the current entry; the last one also ends the entry
+static size_t bin_data(BackupStream* b, uint8_t* p) {
+    size_t want = b->left < BACKUP_READ_BYTES ? b->left : BACKUP_READ_BYTES;
+    size_t n = want ? b->file.read(b->in, want) : 0;
+    // A file that shrank meanwhile ends early; its size no longer matches and restore rejects it
+    b->left = n < want ? 0 : b->left - n;
+    b->raw_crc = crc32_update(b->raw_crc, b->in, n);
+
+    size_t o = 0, len = 0;
+    if (b->deflate) {
+        if (n) len = gzip_write(b->gz, b->in, n, p + 2);
+        if (!b->left) len += gzip_finish(b->gz, p + 2 + len);
+    } else {
+        memcpy(p + 2, b->in, n);
+        len = n;
+    }
+    if (len) {
+        put16(p, (uint16_t)len);
+        o = 2 + len;
+    }
+    if (!b->left) {
+        put16(p + o, 0);
+        put32(p + o + 2, b->raw_crc);
+        o += 6;
+        b->file.close();
+        b->entries++;
+        b->stage = b->in_files ? BK_BIN_FILE_NEXT : BK_BIN_DECK;
+    }
+    return o;
+}
+
+static uint32_t file_crc(BackupStream* b, File& f, bool cache) {
+    const char* name = f.name();
+    uint32_t size = f.size();
+    if (cache) {
+        bool hit = false;
+        uint32_t crc = 0;
+        xSemaphoreTake(g_hashes_lock, portMAX_DELAY);
+        for (const FileHash& h : g_hashes) {
+            if (h.size == size && !strcmp(h.name, name)) {
+                hit = true;
+                crc = h.crc;
+                break;
+            }
+        }
+        xSemaphoreGive(g_hashes_lock);
+        if (hit) return crc;
+    }
+    uint32_t crc = 0;
+    size_t n;
+    while ((n = f.read(b->in, BACKUP_READ_BYTES)) > 0) crc = crc32_update(crc, b->in, n);
+    f.seek(0);
+    if (cache && strlen(name) < sizeof(FileHash::name)) {
+        FileHash h = {};
+        strcpy(h.name, name);
+        h.size = size;
+        h.crc = crc;
+        xSemaphoreTake(g_hashes_lock, portMAX_DELAY);
+        forget_hash(name);
+        g_hashes.push_back(h);
+        xSemaphoreGive(g_hashes_lock);
+    }
+    return crc;
+}
+
+static void entry_key(char* key, size_t size, uint8_t kind, uint8_t arg, const char* name) {
+    if (kind == BIN_DECK) snprintf(key, size, "deck:%u", arg);
+    else snprintf(key, size, "%s:%s", kind == BIN_PROFILE ? "profile" : "file", name);
+}
+
+// Entry (or manifest line) for the file open in `b->file`; false if there is
+// nothing to send for it: then the file is closed again
+static bool file_entry(BackupStream* b, uint8_t* p, size_t& o, uint8_t kind, uint8_t arg, const char* name, bool deflate) {
+    if (b->format == BACKUP_BIN && !b->base) {
+        o = bin_entry(b, p, kind, arg, name, deflate);
+        return true;
+    }
+    uint32_t size = b->file.size();
+    uint32_t crc = file_crc(b, b->file, kind == BIN_FILE);
+    char key[JSON_READER_KEY];
+    entry_key(key, sizeof(key), kind, arg, name);
+    if (b->format == BACKUP_MANIFEST) {
+        char val[24];
+        snprintf(val, sizeof(val), "%08x:%u", (unsigned)crc, (unsigned)size);
+        b->w.str(key, val);
+        b->file.close();
+        return true;
+    }
+    // Differential: left out when the base has it unchanged
+    for (BaseEntry& e : b->base->entries) {
+        if (strcmp(e.key, key) != 0) continue;
+        e.seen = true;
+        if (e.crc == crc && e.size == size) {
+            b->file.close();
+            return false;
+        }
+        break;
+    }
+    o = bin_entry(b, p, kind, arg, name, deflate);
+    return true;
+}
+
+// Deletion of the next base entry that no longer exists; false when none is left
+static bool delete_entry(BackupStream* b, uint8_t* p, size_t& o) {
+    std::vector<BaseEntry>& base = b->base->entries;
+    while (b->button < base.size()) {
+        const BaseEntry& e = base[b->button++];
+        const char* colon = strchr(e.key, ':');
+        uint8_t kind = !strncmp(e.key, "profile:", 8) ? BIN_PROFILE : !strncmp(e.key, "file:", 5) ? BIN_FILE : 0;
+        if (e.seen || !kind) continue; // Built-in decks always exist
+        const char* name = colon + 1;
+        BinEntry d = { BIN_DELETE, 0, (uint8_t)strlen(name), kind, 0 };
+        memcpy(p, &d, sizeof(d));
+        memcpy(p + sizeof(d), name, d.name_len);
+        o = sizeof(d) + d.name_len;
+        put16(p + o, 0);
+        put32(p + o + 2, 0);
+        o += 6;
+        b->entries++;
+        return true;
+    }
+    return false;
+}
+
+static void write_bin_part(BackupStream* b) {
+    uint8_t* p = (uint8_t*)b->text;
+    size_t o = 0;
+    bool manifest = b->format == BACKUP_MANIFEST;
+    if (manifest) b->w.clear();
+    switch (b->stage) {
+        case BK_BIN_HEAD: {
+            if (manifest) {
+                b->w.begin_object();
+                b->profile = 0;
+                b->stage = BK_BIN_DECK;
+                break;
+            }
+            const BackupSettings& s = b->settings;
+            BinHeader h = { BIN_MAGIC, BIN_VERSION, (uint16_t)(b->base ? BIN_H_DIFF : 0) };
+            BinConfig c = {};
+            c.bg = s.bg;
+            c.rows = s.rows;
+            c.cols = s.cols;
+            c.os = s.os;
+            c.profile = s.profile;
+            c.lang = s.lang;
+            strncpy(c.wifi_ssid, s.wifi_ssid ? s.wifi_ssid : "", sizeof(c.wifi_ssid) - 1);
+            BinEntry e = { BIN_CONFIG, 0, 0, 0, sizeof(c) };
+            memcpy(p, &h, sizeof(h));
+            memcpy(p + sizeof(h), &e, sizeof(e));
+            o = sizeof(h) + sizeof(e);
+            put16(p + o, sizeof(c));
+            memcpy(p + o + 2, &c, sizeof(c));
+            o += 2 + sizeof(c);
+            put16(p + o, 0);
+            put32(p + o + 2, crc32_update(0, &c, sizeof(c)));
+            o += 6;
+            b->entries = 1;
+            b->profile = 0;
+            b->stage = BK_BIN_DECK;
+            break;
+        }
+        case BK_BIN_DECK: {
+            // Deck files as they are on flash (flushed by the caller)
+            bool more = false;
+            while (b->profile < profile_count() && !more) {
+                const Profile* pr = profile_get(b->profile++);
+                b->file = LittleFS.open(pr->path, "r");
+                if (!b->file) continue;
+                uint8_t id = b->profile - 1;
+                if (id < PROFILE_BUILTIN) more = file_entry(b, p, o, BIN_DECK, id, "", true);
+                else more = file_entry(b, p, o, BIN_PROFILE, pr->os, pr->name, true);
+            }
+            if (!more) b->stage = BK_BIN_FILES;
+            break;
+        }
+        case BK_BIN_DATA:
+            o = bin_data(b, p);
+            break;
+        case BK_BIN_FILES:
+            b->dir = LittleFS.open("/");
+            b->in_files = true;
+            b->stage = BK_BIN_FILE_NEXT;
+            break;
+        case BK_BIN_FILE_NEXT: {
+            bool more = false;
+            while (b->dir && !more) {
+                b->file = b->dir.openNextFile();
+                if (!b->file) break;
+                if (b->file.isDirectory() || (b->skip && b->skip(b->file.name()))) {
+                    b->file.close();
+                    continue;
+                }
+                // The name lives in the File, which file_entry() may close
+                char name[32];
+                strncpy(name, b->file.name(), sizeof(name) - 1);
+                name[sizeof(name) - 1] = 0;
+                more = file_entry(b, p, o, BIN_FILE, 0, name, worth_deflating(name));
+                if (more && !manifest) b->assets++;
+            }
+            if (!more) {
+                b->button = 0;
+                b->stage = b->base ? BK_BIN_DELETES : BK_BIN_END;
+            }
+            break;
+        }
+        case BK_BIN_DELETES:
+            if (!delete_entry(b, p, o)) b->stage = BK_BIN_END;
+            break;
+        case BK_BIN_END: {
+            if (b->dir) b->dir.close();
+            if (manifest) {
+                b->w.end_object();
+                b->stage = BK_DONE;
+                break;
+            }
+            BinEntry e = { BIN_END, 0, 0, 0, b->entries };
+            memcpy(p, &e, sizeof(e));
+            put32(p + sizeof(e), b->arc_crc);
+            b->out = p;
+            b->out_len = sizeof(e) + 4;
+            b->stage = BK_DONE;
+            return;
+        }
+        default:
+            break;
+    }
+    if (manifest) {
+        b->out = (const uint8_t*)b->w.data();
+        b->out_len = b->w.size();
+        return;
+    }
+    b->arc_crc = crc32_update(b->arc_crc, p, o);
+    b->out = p;
+    b->out_len = o;
+}
+
+BackupStream* backup_create(const BackupSettings& s, backup_skip_fn skip, BackupFormat format, BackupBase* base) {
+    BackupStream* b = new (std::nothrow) BackupStream();
+    if (!b) {
+        backup_base_destroy(base);
+        return nullptr;
+    }
+    b->settings = s;
+    b->skip = skip;
+    b->format = format;
+    if (format == BACKUP_BIN) {
+        b->base = base;
+        b->gz = gzip_create(); // Without it the archive is just larger
+    } else {
+        backup_base_destroy(base);
+    }
+    if (format != BACKUP_JSON) b->stage = BK_BIN_HEAD;
+    b->t0 = esp_timer_get_time();
+    return b;
+}
+
+void backup_destroy(BackupStream* b) {
+    if (!b) return;
+    if (b->file) b->file.close();
+    if (b->dir) b->dir.close();
+    if (b->gz) gzip_destroy(b->gz);
+    backup_base_destroy(b->base);
+    Serial.printf("BACKUP: %u bytes, %u assets in %u ms%s\n", (unsigned)b->bytes, (unsigned)b->assets,
+                  (unsigned)((esp_timer_get_time() - b->t0) / 1000), b->stage == BK_DONE ? "" : " (incomplete)");
+    delete b;
+}
+
+size_t backup_read(BackupStream* b, uint8_t* buf, size_t max) {
+    size_t n = 0;
+    while (n < max) {
+        if (b->out_len == 0) {
+            if (b->stage == BK_DONE) break;
+            if (b->format != BACKUP_JSON) {
+                write_bin_part(b);
+            } else {
+                write_part(b);
+                b->out = (const uint8_t*)b->w.data();
+                b->out_len = b->w.size();
+            }
+            continue;
+        }
+        size_t k = b->out_len < max - n ? b->out_len : max - n;
+        memcpy(buf + n, b->out, k);
+        n += k;
+        b->out += k;
+        b->out_len -= k;
+    }
+    b->bytes += n;
+    return n;
+}
+
+BackupBase* backup_base_create() {
+    return new (std::nothrow) BackupBase();
+}
+
+void backup_base_destroy(BackupBase* m) {
+    delete m;
+}
+
+bool backup_base_feed(BackupBase* m, const uint8_t* data, size_t len) {
+    return m->reader.feed((const char*)data, len);
+}
+
+bool backup_base_finish(BackupBase* m) {
+    return m->reader.finish();
+}
+
+const char* backup_base_error(const BackupBase* m) {
+    static char msg[80];
+    const char* why = m->error[0] ? m->error : m->reader.error();
+    snprintf(msg, sizeof(msg), "%s at byte %u", why ? why : "invalid manifest", (unsigned)m->reader.offset());
+    return msg;
+}
+
+void backup_file_changed(const char* name) {
+    if (name[0] == '/') name++;
+    xSemaphoreTake(g_hashes_lock, portMAX_DELAY);
+    forget_hash(name);
+    xSemaphoreGive(g_hashes_lock);
+}
+
+// ==========================================
+// RESTORE
+// ==========================================
+enum RestoreCtx : uint8_t { RC_SKIP, RC_ROOT, RC_BTNS, RC_BUTTON, RC_PROFILES, RC_PROFILE, RC_ASSETS };
+
+// Archive parser states; all but RB_BLOCK gather a fixed-size field
+enum RestoreBinState : uint8_t { RB_HEADER, RB_ENTRY, RB_NAME, RB_BLEN, RB_BLOCK, RB_CRC, RB_END_CRC, RB_DONE };
+
+#define RESTORE_DECKS    (PROFILE_MAX + PROFILE_BUILTIN) // builtin keys may repeat in "profiles"
+#define RESTORE_OUT_BYTES 192
+
+struct RestoreDeck {
+    int8_t builtin;              // 0/1: win_btns/mac_btns, -1: a named profile
+    char name[PROFILE_NAME_LEN];
+    uint8_t os;
+    bool written;                // temporary deck file complete
+    bool same;                   // identical to the current deck file: nothing written
+};
+
+struct RestoreAsset {
+    char name[32];
+    bool same;
+};
+
+struct RestoreDelete {
+    uint8_t kind; // BIN_PROFILE or BIN_FILE
+    char name[32];
+};
+
+struct RestoreStream : public JsonHandler {
+    JsonReader reader{*this};
+    char error[64] = "";
+    RestoreSettings settings = {};
+    RestoreCtx ctx[JSON_READER_DEPTH] = {};
+    char key[JSON_READER_KEY] = "";
+    char sval[256];
+    size_t sval_len = 0;
+
+    uint16_t slots = 20;
+    bool slots_used = false;
+    RestoreDeck decks[RESTORE_DECKS];
+    uint8_t deck_count = 0;
+    Deck deck;
+    bool deck_open = false;
+    size_t button = 0;
+    ButtonConfig cur;
+
+    std::vector<RestoreAsset> assets;
+    std::vector<RestoreDelete> deletes;
+    File file;
+    // Output compared with the file it replaces until it differs (see sink_write)
+    File cmp;
+    bool sink_open_ = false;
+    bool sink_same = false;
+    uint32_t same_len = 0;
+    char sink_dst[40];
+    char sink_tmp[24];
+    uint32_t b64 = 0;
+    uint8_t b64_n = 0;
+    bool b64_end = false;
+    uint8_t out[RESTORE_OUT_BYTES];
+    size_t out_len = 0;
+    bool committed = false;
+
+    // Binary archive
+    bool binary = false;
+    RestoreBinState bstate = RB_HEADER;
+    uint8_t field[256];          // fixed-size field or entry name being gathered
+    size_t field_len = 0, field_need = sizeof(BinHeader);
+    BinEntry entry = {};
+    uint16_t block_left = 0;
+    uint32_t arc_crc = 0;        // every byte read so far
+    uint32_t entry_crc = 0;      // arc_crc where the current entry header starts
+    uint32_t entries = 0;
+    uint32_t raw_len = 0, raw_crc = 0;
+    BinConfig config;
+    tinfl_decompressor* inflater = nullptr;
+    uint8_t* dict = nullptr;     // TINFL_LZ_DICT_SIZE, wrapping
+    size_t dict_ofs = 0;
+    uint8_t gz_head = 0;         // gzip header bytes skipped
+    uint8_t gz_tail = 0;         // gzip trailer bytes after the deflate data
+    bool inflated = false;
+    size_t offset = 0;
+
+    bool fail(const char* msg) {
+        if (!error[0]) strncpy(error, msg, sizeof(error) - 1);
+        return false;
+    }
+
+    RestoreCtx parent() const { return ctx[reader.depth() - 1]; }
+
+    static void deck_tmp(uint8_t i, char* path, size_t size) {
+        snprintf(path, size, "/" RESTORE_TMP_PREFIX "d%u", i);
+    }
+    static void asset_tmp(size_t i, char* path, size_t size) {
+        snprintf(path, size, "/" RESTORE_TMP_PREFIX "a%u", (unsigned)i);
+    }
+
+    bool open_deck(int8_t builtin) {
+        if (builtin >= 0) {
+            if (deck_count == RESTORE_DECKS) return fail("too many profiles");
+            RestoreDeck& d = decks[deck_count++];
+            memset(&d, 0, sizeof(d));
+            d.builtin = builtin;
+        }
+        if (!deck_init(deck, 1)) return fail("out of memory");
+        deck_open = true;
+        slots_used = true;
+        button = 0;
+        return true;
+    }
+
+    bool close_deck() {
+        char path[24];
+        deck_tmp(deck_count - 1, path, sizeof(path));
+        bool ok = deck_save(deck, path);
+        deck_free(deck);
+        deck_open = false;
+        if (!ok) return fail("cannot write deck (storage full?)");
+        decks[deck_count - 1].written = true;
+        return true;
+    }
+
+    bool add_button() {
+        size_t page = button / slots, slot = button % slots;
+        button++;
+        if (slot >= DECK_PAGE_SLOTS || page >= DECK_MAX_PAGES) return true;
+        if (page >= deck.page_count && !deck_resize(deck, page + 1)) return fail("out of memory");
+        if (!deck_set(deck, page * DECK_PAGE_SLOTS + slot, cur)) return fail("out of memory");
+        return true;
+    }
+
+    // `dst`: the file this one will replace, nullptr if none
+    bool sink_open(const char* dst, const char* tmp) {
+        strncpy(sink_tmp, tmp, sizeof(sink_tmp) - 1);
+        sink_tmp[sizeof(sink_tmp) - 1] = 0;
+        strncpy(sink_dst, dst ? dst : "", sizeof(sink_dst) - 1);
+        sink_dst[sizeof(sink_dst) - 1] = 0;
+        sink_open_ = true;
+        sink_same = false;
+        same_len = 0;
+        if (dst && LittleFS.exists(dst)) cmp = LittleFS.open(dst, "r");
+        if (cmp) return true;
+        file = LittleFS.open(tmp, "w");
+        return file || fail("cannot create file (storage full?)");
+    }
+
+    // Starts the temporary file with the part that matched, which was not written
+    bool sink_diverge() {
+        cmp.close();
+        file = LittleFS.open(sink_tmp, "w");
+        if (!file) return fail("cannot create file (storage full?)");
+        File src = LittleFS.open(sink_dst, "r");
+        uint8_t buf[128];
+        for (uint32_t left = same_len; left;) {
+            size_t k = left < sizeof(buf) ? left : sizeof(buf);
+            if (src.read(buf, k) != k || file.write(buf, k) != k) {
+                src.close();
+                return fail("cannot write file (storage full?)");
+            }
+            left -= k;
+        }
+        src.close();
+        return true;
+    }
+
+    bool sink_write(const uint8_t* p, size_t n) {
+        if (cmp) {
+            uint8_t buf[64];
+            size_t i = 0;
+            while (i < n) {
+                size_t k = n - i < sizeof(buf) ? n - i : sizeof(buf);
+                if (cmp.read(buf, k) != k || memcmp(buf, p + i, k) != 0) break;
+                i += k;
+            }
+            if (i == n) {
+                same_len += n;
+                return true;
+            }
+            if (!sink_diverge()) return false;
+        }
+        return file.write(p, n) == n || fail("cannot write file (storage full?)");
+    }
+
+    // sink_same: the content equals the file it replaces and was not written
+    bool sink_close() {
+        sink_open_ = false;
+        if (cmp) {
+            if (cmp.size() == same_len) {
+                cmp.close();
+                sink_same = true;
+                return true;
+            }
+            if (!sink_diverge()) return false;
+        }
+        file.close();
+        return true;
+    }
+
+    bool flush_out() {
+        if (out_len && !sink_write(out, out_len)) return false;
+        out_len = 0;
+        return true;
+    }
+
+    bool put_byte(uint8_t v) {
+        out[out_len++] = v;
+        return out_len < sizeof(out) || flush_out();
+    }
+
+    bool open_asset(const char* name) {
+        // Names as LittleFS lists them: a bare file name
+        if (name[0] == '/') name++;
+        if (!name[0] || name[0] == '.' || strchr(name, '/') || strlen(name) >= sizeof(RestoreAsset::name)) {
+            return fail("bad asset name");
+        }
+        if (assets.size() >= RESTORE_MAX_ASSETS) return fail("too many assets");
+        RestoreAsset a;
+        strncpy(a.name, name, sizeof(a.name) - 1);
+        a.name[sizeof(a.name) - 1] = 0;
+        a.same = false;
+        char path[24], dst[40];
+        asset_tmp(assets.size(), path, sizeof(path));
+        snprintf(dst, sizeof(dst), "/%s", a.name);
+        assets.push_back(a);
+        if (!sink_open(dst, path)) return false;
+        b64 = 0;
+        b64_n = 0;
+        b64_end = false;
+        out_len = 0;
+        return true;
+    }
+
+    bool asset_data(const char* s, size_t n, bool done) {
+        if (!sink_open_ && !open_asset(key)) return false;
+        for (size_t i = 0; i < n; i++) {
+            char c = s[i];
+            int v;
+            if (c >= 'A' && c <= 'Z') v = c - 'A';
+            else if (c >= 'a' && c <= 'z') v = c - 'a' + 26;
+            else if (c >= '0' && c <= '9') v = c - '0' + 52;
+            else if (c == '+') v = 62;
+            else if (c == '/') v = 63;
+            else if (c == '=') { b64_end = true; continue; }
+            else if (c == '\n' || c == '\r' || c == ' ') continue;
+            else return fail("bad base64");
+            if (b64_end) return fail("bad base64");
+            b64 = (b64 << 6) | v;
+            if (++b64_n == 4) {
+                if (!put_byte(b64 >> 16) || !put_byte(b64 >> 8) || !put_byte(b64)) return false;
+                b64 = 0;
+                b64_n = 0;
+            }
+        }
+        if (!done) return true;
+        bool ok = true;
+        if (b64_n == 1) ok = fail("bad base64");
+        else if (b64_n == 2) ok = put_byte(b64 >> 4);
+        else if (b64_n == 3) ok = put_byte(b64 >> 10) && put_byte(b64 >> 2);
+        ok = ok && flush_out() && sink_close();
+        assets.back().same = sink_same;
+        return ok;
+    }
+
+    static uint32_t parse_color(const char* hex) {
+        if (hex[0] == '#') hex++;
+        return strtoul(hex, NULL, 16);
+    }
+
+    bool set_string(RestoreCtx c) {
+        sval[sval_len] = 0;
+        if (c == RC_ROOT) {
+            RestoreSettings& st = settings;
+            if (!strcmp(key, "bg")) { st.bg = parse_color(sval); st.has_bg = true; }
+            else if (!strcmp(key, "wifi_ssid")) { strncpy(st.wifi_ssid, sval, sizeof(st.wifi_ssid) - 1); st.has_ssid = true; }
+            else if (!strcmp(key, "wifi_pass")) { strncpy(st.wifi_pass, sval, sizeof(st.wifi_pass) - 1); st.has_pass = true; }
+        } else if (c == RC_BUTTON) {
+            if (!strcmp(key, "label")) strncpy(cur.label, sval, sizeof(cur.label) - 1);
+            else if (!strcmp(key, "value")) strncpy(cur.value, sval, sizeof(cur.value) - 1);
+            else if (!strcmp(key, "icon")) strncpy(cur.icon, sval, sizeof(cur.icon) - 1);
+            else if (!strcmp(key, "img")) strncpy(cur.imgPath, sval, sizeof(cur.imgPath) - 1);
+            else if (!strcmp(key, "color")) cur.color = parse_color(sval);
+        } else if (c == RC_PROFILE && !strcmp(key, "name")) {
+            RestoreDeck& d = decks[deck_count - 1];
+            strncpy(d.name, sval, sizeof(d.name) - 1);
+            d.name[sizeof(d.name) - 1] = 0;
+        }
+        return true;
+    }
+
+    bool on_begin(bool array) override {
+        uint8_t depth = reader.depth();
+        RestoreCtx c = RC_SKIP;
+        if (depth == 1) {
+            if (array) return fail("not a backup");
+            c = RC_ROOT;
+        } else switch (parent()) {
+            case RC_ROOT:
+                if (array && (!strcmp(key, "win_btns") || !strcmp(key, "mac_btns"))) {
+                    if (!open_deck(key[0] == 'w' ? 0 : 1)) return false;
+                    c = RC_BTNS;
+                } else if (array && !strcmp(key, "profiles")) c = RC_PROFILES;
+                else if (!array && !strcmp(key, "assets")) c = RC_ASSETS;
+                break;
+            case RC_PROFILES:
+                if (array) break;
+                if (deck_count == RESTORE_DECKS) return fail("too many profiles");
+                memset(&decks[deck_count], 0, sizeof(RestoreDeck));
+                decks[deck_count].builtin = -1;
+                strcpy(decks[deck_count].name, "Profile");
+                deck_count++;
+                c = RC_PROFILE;
+                break;
+            case RC_PROFILE:
+                if (array && !strcmp(key, "btns") && !deck_open && !decks[deck_count - 1].written) {
+                    if (!open_deck(-1)) return false;
+                    c = RC_BTNS;
+                }
+                break;
+            case RC_BTNS:
+                if (array) break;
+                memset(&cur, 0, sizeof(cur));
+                strcpy(cur.label, "Button");
+                cur.color = 0x333333;
+                c = RC_BUTTON;
+                break;
+            default:
+                break;
+        }
+        ctx[depth] = c;
+        return true;
+    }
+
+    bool on_end(bool array) override {
+        RestoreCtx c = ctx[reader.depth() + 1];
+        if (c == RC_BUTTON) return add_button();
+        if (c == RC_BTNS) return close_deck();
+        return true;
+    }
+
+    bool on_key(const char* k) override {
+        strncpy(key, k, sizeof(key) - 1);
+        key[sizeof(key) - 1] = 0;
+        return true;
+    }
+
+    bool on_string(const char* s, size_t n, bool done) override {
+        RestoreCtx c = ctx[reader.depth()];
+        if (c == RC_ASSETS) return asset_data(s, n, done);
+        if (c != RC_ROOT && c != RC_BUTTON && c != RC_PROFILE) return true;
+        size_t k = n < sizeof(sval) - 1 - sval_len ? n : sizeof(sval) - 1 - sval_len;
+        memcpy(sval + sval_len, s, k);
+        sval_len += k;
+        if (!done) return true;
+        bool ok = set_string(c);
+        sval_len = 0;
+        return ok;
+    }
+
+    bool on_number(double v) override {
+        RestoreCtx c = ctx[reader.depth()];
+        uint8_t u8 = v < 0 ? 0 : v > 255 ? 255 : (uint8_t)v;
+        RestoreSettings& st = settings;
+        if (c == RC_ROOT) {
+            if (!strcmp(key, "rows")) st.rows = u8;
+            else if (!strcmp(key, "cols")) st.cols = u8;
+            else if (!strcmp(key, "os")) { st.os = u8; st.has_os = true; }
+            else if (!strcmp(key, "profile")) { st.profile = u8; st.has_profile = true; }
+            else if (!strcmp(key, "lang")) { st.lang = u8; st.has_lang = true; }
+            else if (!strcmp(key, "page_slots")) {
+                if (slots_used) return fail("page_slots after the buttons");
+                slots = v < 1 ? 1 : v > 1024 ? 1024 : (uint16_t)v;
+            }
+        } else if (c == RC_BUTTON) {
+            if (!strcmp(key, "type")) cur.type = u8;
+            else if (!strcmp(key, "color")) cur.color = (uint32_t)v;
+        } else if (c == RC_PROFILE && !strcmp(key, "os")) {
+            decks[deck_count - 1].os = u8 > 1 ? 0 : u8;
+        }
+        return true;
+    }
+
+    bool on_literal(char) override { return true; }
+
+    // ---- binary archive ----
+
+    static void* alloc(size_t size) {
+        void* p = heap_caps_malloc(size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        return p ? p : malloc(size);
+    }
+
+    void expect(RestoreBinState s, size_t need) {
+        bstate = s;
+        field_len = 0;
+        field_need = need;
+        if (s == RB_ENTRY) entry_crc = arc_crc;
+    }
+
+    static uint32_t get32(const uint8_t* p) {
+        return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+    }
+
+    // Decompressed (or stored) entry data
+    bool raw_data(const uint8_t* p, size_t n) {
+        if (n > entry.raw_size - raw_len) return fail("entry larger than its size");
+        raw_crc = crc32_update(raw_crc, p, n);
+        switch (entry.kind) {
+            case BIN_CONFIG:
+                if (raw_len < sizeof(config)) {
+                    size_t k = n < sizeof(config) - raw_len ? n : sizeof(config) - raw_len;
+                    memcpy((uint8_t*)&config + raw_len, p, k);
+                }
+                break;
+            case BIN_DECK:
+            case BIN_PROFILE:
+            case BIN_FILE:
+                if (!sink_write(p, n)) return false;
+                break;
+            default:
+                break;
+        }
+        raw_len += n;
+        return true;
+    }
+
+    bool block_data(const uint8_t* p, size_t n) {
+        if (!(entry.flags & BIN_F_DEFLATE)) return raw_data(p, n);
+        // Only the plain 10-byte gzip header is written
+        static const uint8_t GZ_HEAD[4] = {0x1f, 0x8b, 8, 0};
+        for (; gz_head < 10 && n; gz_head++, p++, n--) {
+            if (gz_head < sizeof(GZ_HEAD) && *p != GZ_HEAD[gz_head]) return fail("bad compressed data");
+        }
+        while (!inflated) {
+            size_t in_n = n, out_n = TINFL_LZ_DICT_SIZE - dict_ofs;
+            tinfl_status st = tinfl_decompress(inflater, p, &in_n, dict, dict + dict_ofs, &out_n, TINFL_FLAG_HAS_MORE_INPUT);
+            p += in_n;
+            n -= in_n;
+            if (out_n && !raw_data(dict + dict_ofs, out_n)) return false;
+            dict_ofs = (dict_ofs + out_n) & (TINFL_LZ_DICT_SIZE - 1);
+            if (st < 0) return fail("bad compressed data");
+            if (st == TINFL_STATUS_DONE) inflated = true;
+            else if (st == TINFL_STATUS_NEEDS_MORE_INPUT) break; // HAS_MORE_OUTPUT: the dictionary wrapped
+        }
+        // CRC and size of the gzip trailer; the entry has its own
+        if (n && !inflated) return fail("bad compressed data");
+        gz_tail += n > 8 ? 9 : n;
+        return gz_tail <= 8 || fail("bad compressed data");
+    }
+
+    bool begin_entry(const char* name) {
+        raw_len = 0;
+        raw_crc = 0;
+        gz_head = 0;
+        gz_tail = 0;
+        inflated = false;
+        if (entry.flags & BIN_F_DEFLATE) {
+            if (!inflater) inflater = (tinfl_decompressor*)alloc(sizeof(tinfl_decompressor));
+            if (!dict) dict = (uint8_t*)alloc(TINFL_LZ_DICT_SIZE);
+            if (!inflater || !dict) return fail("out of memory");
+            tinfl_init(inflater);
+            dict_ofs = 0;
+        }
+        char path[24];
+        switch (entry.kind) {
+            case BIN_CONFIG:
+                memset(&config, 0, sizeof(config));
+                break;
+            case BIN_DECK:
+            case BIN_PROFILE: {
+                if (entry.kind == BIN_DECK && entry.arg > 1) return fail("bad deck");
+                if (deck_count == RESTORE_DECKS) return fail("too many profiles");
+                RestoreDeck& d = decks[deck_count++];
+                memset(&d, 0, sizeof(d));
+                d.builtin = entry.kind == BIN_DECK ? (int8_t)entry.arg : -1;
+                d.os = entry.arg > 1 ? 0 : entry.arg;
+                strncpy(d.name, name[0] ? name : "Profile", sizeof(d.name) - 1);
+                // Compared with the deck file it would replace
+                const char* dst = nullptr;
+                for (uint8_t id = 0; id < profile_count() && !dst; id++) {
+                    const Profile* pr = profile_get(id);
+                    if (id < PROFILE_BUILTIN ? d.builtin == id : d.builtin < 0 && !strcmp(pr->name, d.name)) dst = pr->path;
+                }
+                deck_tmp(deck_count - 1, path, sizeof(path));
+                if (!sink_open(dst, path)) return false;
+                break;
+            }
+            case BIN_FILE:
+                if (!open_asset(name)) return false;
+                break;
+            case BIN_DELETE: {
+                RestoreDelete del = {};
+                del.kind = entry.arg;
+                if ((del.kind != BIN_PROFILE && del.kind != BIN_FILE) || !name[0] || name[0] == '.' ||
+                    strchr(name, '/') || strlen(name) >= sizeof(del.name)) {
+                    return fail("bad delete entry");
+                }
+                if (deletes.size() >= RESTORE_MAX_ASSETS + PROFILE_MAX) return fail("too many deletes");
+                strcpy(del.name, name);
+                deletes.push_back(del);
+                break;
+            }
+            default:
+                break; // Newer kind: checked, then dropped
+        }
+        expect(RB_BLEN, 2);
+        return true;
+    }
+
+    bool end_entry(uint32_t crc) {
+        if ((entry.flags & BIN_F_DEFLATE) && !inflated) return fail("truncated compressed data");
+        if (raw_len != entry.raw_size || crc != raw_crc) return fail("entry checksum mismatch");
+        if (sink_open_ && !sink_close()) return false;
+        if (entry.kind == BIN_CONFIG) {
+            if (raw_len < sizeof(config)) return fail("bad config entry");
+            RestoreSettings& st = settings;
+            st.bg = config.bg;
+            st.has_bg = true;
+            st.rows = config.rows;
+            st.cols = config.cols;
+            st.os = config.os;
+            st.profile = config.profile;
+            st.lang = config.lang;
+            st.has_os = st.has_profile = st.has_lang = true;
+            memcpy(st.wifi_ssid, config.wifi_ssid, sizeof(st.wifi_ssid) - 1);
+            st.has_ssid = true;
+        } else if (entry.kind == BIN_DECK || entry.kind == BIN_PROFILE) {
+            RestoreDeck& d = decks[deck_count - 1];
+            d.same = sink_same;
+            if (!d.same) {
+                // CRC says it arrived intact, not that it is a deck
+                char path[24];
+                deck_tmp(deck_count - 1, path, sizeof(path));
+                Deck check;
+                bool ok = deck_load(check, path);
+                deck_free(check);
+                if (!ok) return fail("bad deck file");
+            }
+            d.written = true;
+        } else if (entry.kind == BIN_FILE) {
+            assets.back().same = sink_same;
+        }
+        entries++;
+        expect(RB_ENTRY, sizeof(BinEntry));
+        return true;
+    }
+
+    bool field_done() {
+        switch (bstate) {
+            case RB_HEADER: {
+                BinHeader h;
+                memcpy(&h, field, sizeof(h));
+                if (h.magic != BIN_MAGIC) return fail("not a backup archive");
+                if (h.version > BIN_VERSION) return fail("archive from a newer firmware");
+                expect(RB_ENTRY, sizeof(BinEntry));
+                return true;
+            }
+            case RB_ENTRY:
+                memcpy(&entry, field, sizeof(entry));
+                if (entry.kind == BIN_END) {
+                    if (entry.flags || entry.name_len) return fail("bad end entry");
+                    expect(RB_END_CRC, 4);
+                }
+                else if (entry.name_len) expect(RB_NAME, entry.name_len);
+                else return begin_entry("");
+                return true;
+            case RB_NAME:
+                field[field_len] = 0;
+                return begin_entry((const char*)field);
+            case RB_BLEN:
+                block_left = field[0] | field[1] << 8;
+                if (block_left) bstate = RB_BLOCK;
+                else expect(RB_CRC, 4);
+                return true;
+            case RB_CRC:
+                return end_entry(get32(field));
+            case RB_END_CRC:
+                if (get32(field) != entry_crc) return fail("archive checksum mismatch");
+                if (entry.raw_size != entries) return fail("entries missing");
+                bstate = RB_DONE;
+                return true;
+            default:
+                return true;
+        }
+    }
+
+    bool bin_feed(const uint8_t* p, size_t n) {
+        if (error[0]) return false;
+        while (n) {
+            if (bstate == RB_DONE) return fail("data after the end");
+            size_t k;
+            if (bstate == RB_BLOCK) {
+                k = n < block_left ? n : block_left;
+                if (!block_data(p, k)) return false;
+                block_left -= k;
+                if (!block_left) expect(RB_BLEN, 2);
+            } else {
+                k = field_need - field_len < n ? field_need - field_len : n;
+                memcpy(field + field_len, p, k);
+                field_len += k;
+            }
+            arc_crc = crc32_update(arc_crc, p, k);
+            offset += k;
+            p += k;
+            n -= k;
+            if (bstate != RB_BLOCK && field_len == field_need && !field_done()) return false;
+        }
+        return true;
+    }
+};
+
+RestoreStream* restore_create(bool binary) {
+    // Leftovers of a restore that never finished
+    std::vector<String> stale;
+    File root = LittleFS.open("/");
+    for (File f = root.openNextFile(); f; f = root.openNextFile()) {
+        if (strncmp(f.name(), RESTORE_TMP_PREFIX, strlen(RESTORE_TMP_PREFIX)) == 0) stale.push_back(String("/") + f.name());
+    }
+    root.close();
+    for (const String& p : stale) LittleFS.remove(p);
+
+    RestoreStream* r = new (std::nothrow) RestoreStream();
+    if (r) r->binary = binary;
+    return r;
+}
+
+void restore_destroy(RestoreStream* r) {
+    if (!r) return;
+    if (r->file) r->file.close();
+    if (r->cmp) r->cmp.close();
+    if (r->deck_open) deck_free(r->deck);
+    free(r->inflater);
+    free(r->dict);
+    if (!r->committed) {
+        char path[24];
+        for (uint8_t i = 0; i < r->deck_count; i++) {
+            r->deck_tmp(i, path, sizeof(path));
+            if (LittleFS.exists(path)) LittleFS.remove(path);
+        }
+        for (size_t i = 0; i < r->assets.size(); i++) {
+            r->asset_tmp(i, path, sizeof(path));
+            if (LittleFS.exists(path)) LittleFS.remove(path);
+        }
+    }
+    delete r;
+}
+
+bool restore_feed(RestoreStream* r, const uint8_t* data, size_t len) {
+    if (r->binary) return r->bin_feed(data, len);
+    return r->reader.feed((const char*)data, len);
+}
+
+const char* restore_error(const RestoreStream* r) {
+    static char msg[96];
+    const char* why = r->error[0] ? r->error : r->binary ? nullptr : r->reader.error();
+    size_t offset = r->binary ? r->offset : r->reader.offset();
+    snprintf(msg, sizeof(msg), "%s at byte %u", why ? why : "invalid backup", (unsigned)offset);
+    return msg;
+}
+
+bool restore_commit(RestoreStream* r, RestoreSettings& out) {
+    if (r->binary) {
+        if (r->error[0]) return false;
+        if (r->bstate != RB_DONE) return r->fail("truncated archive");
+    } else if (!r->reader.finish()) {
+        return false;
+    }
+
+    // The profile list as it will be: profiles a differential archive
+    // deleted leave it (built-ins stay), new ones are appended
+    ProfileEntry list[PROFILE_MAX];
+    size_t count = profile_list(list, PROFILE_MAX);
+    bool list_changed = false;
+    std::vector<String> gone; // deck files of the removed profiles
+    for (const RestoreDelete& d : r->deletes) {
+        if (d.kind != BIN_PROFILE) continue;
+        for (size_t i = PROFILE_BUILTIN; i < count; i++) {
+            if (strcmp(list[i].name, d.name) != 0) continue;
+            gone.push_back(list[i].path);
+            memmove(&list[i], &list[i + 1], (count - i - 1) * sizeof(ProfileEntry));
+            count--;
+            list_changed = true;
+            break;
+        }
+    }
+    // Where each deck goes; every new profile must fit before anything is replaced
+    char dst[RESTORE_DECKS][PROFILE_PATH_LEN];
+    for (uint8_t i = 0; i < r->deck_count; i++) {
+        const RestoreDeck& d = r->decks[i];
+        dst[i][0] = '\0';
+        if (!d.written || d.same) continue;
+        int id = d.builtin;
+        // Same name: overwrite that profile, otherwise add one
+        for (size_t p = PROFILE_BUILTIN; p < count && id < 0; p++) {
+            if (!strcmp(list[p].name, d.name)) id = p;
+        }
+        if (id < 0) {
+            if (count >= PROFILE_MAX) return r->fail("too many profiles");
+            ProfileEntry& e = list[count];
+            memset(&e, 0, sizeof(e));
+            strncpy(e.name, d.name, PROFILE_NAME_LEN - 1);
+            e.os = d.os > 1 ? 0 : d.os;
+            profile_new_path(list, count, e.path, sizeof(e.path));
+            id = count++;
+            list_changed = true;
+        }
+        strcpy(dst[i], list[id].path);
+    }
+
+    // Replaced files are kept aside until every rename succeeded, so a
+    // failure puts everything back
+    struct Move {
+        String dst;
+        String old;  // what dst held, "" if nothing
+        bool placed; // dst is the restored file
+    };
+    std::vector<Move> moves;
+    auto place = [&](const char* tmp, const String& to) -> bool {
+        bool ours = false; // a second deck for the same profile
+        for (const Move& m : moves) ours = ours || m.dst == to;
+        moves.push_back({ to, "", false });
+        Move& m = moves.back();
+        if (!ours && LittleFS.exists(to)) {
+            char old[24];
+            snprintf(old, sizeof(old), "/" RESTORE_TMP_PREFIX "o%u", (unsigned)moves.size());
+            if (!LittleFS.rename(to, old)) return false;
+            m.old = old;
+        }
+        m.placed = LittleFS.rename(tmp, to);
+        return m.placed;
+    };
+
+    char path[24];
+    char why[64] = "";
+    unsigned same = 0;
+    for (uint8_t i = 0; i < r->deck_count && !why[0]; i++) {
+        const RestoreDeck& d = r->decks[i];
+        if (!d.written) continue;
+        if (d.same) { same++; continue; }
+        r->deck_tmp(i, path, sizeof(path));
+        if (!place(path, dst[i])) snprintf(why, sizeof(why), "could not replace profile %s", d.name);
+    }
+    for (size_t i = 0; i < r->assets.size() && !why[0]; i++) {
+        if (r->assets[i].same) { same++; continue; }
+        r->asset_tmp(i, path, sizeof(path));
+        if (!place(path, String("/") + r->assets[i].name)) snprintf(why, sizeof(why), "could not replace %s", r->assets[i].name);
+    }
+    if (!why[0] && list_changed && !profile_write_list(list, count)) snprintf(why, sizeof(why), "could not write the profile list");
+    if (why[0]) {
+        for (size_t i = moves.size(); i-- > 0;) {
+            if (moves[i].placed) LittleFS.remove(moves[i].dst);
+            if (moves[i].old.length() && !LittleFS.rename(moves[i].old, moves[i].dst)) {
+                Serial.printf("STORAGE ERROR: restore could not put back %s\n", moves[i].dst.c_str());
+            }
+        }
+        Serial.printf("RESTORE: %s, rolled back\n", why);
+        return r->fail(why);
+    }
+
+    for (const Move& m : moves) {
+        if (m.old.length()) LittleFS.remove(m.old);
+    }
+    for (const RestoreAsset& a : r->assets) {
+        if (!a.same) backup_file_changed(a.name);
+    }
+    for (const String& g : gone) LittleFS.remove(g);
+    for (const RestoreDelete& d : r->deletes) {
+        if (d.kind != BIN_FILE) continue;
+        String dst = String("/") + d.name;
+        // Never a deck file or the profile list, whatever the archive says
+        bool system = dst == PROFILE_LIST_FILE;
+        for (size_t i = 0; i < count && !system; i++) system = dst == list[i].path;
+        if (system || !LittleFS.exists(dst)) continue;
+        LittleFS.remove(dst);
+        backup_file_changed(d.name);
+    }
+    r->committed = true;
+    out = r->settings;
+    Serial.printf("RESTORE: %u decks, %u assets, %u unchanged, %u deleted, %u bytes\n", r->deck_count,
+                  (unsigned)r->assets.size(), same, (unsigned)r->deletes.size(),
+                  (unsigned)(r->binary ? r->offset : r->reader.offset()));
+    return true;
+}
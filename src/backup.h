@@ -0,0 +1,168 @@
+#ifndef BACKUP_H
+#define BACKUP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ==========================================
+// STREAMING BACKUP
+// ==========================================
+// Produces the JSON backup (settings, every profile's buttons, every asset
+// base64-encoded) a piece at a time for a chunked response. Buttons are read
+// from the resident decks, assets from LittleFS through one small buffer, so
+// memory use does not depend on how many or how large the assets are.
+//
+// The JSON layout is the one /api/restore has always read:
+//   { settings..., "page_slots", "win_btns": [...], "mac_btns": [...],
+//     "profiles": [{ "name", "os", "btns": [...] }],
+//     "assets": { "<file name>": "<base64>", ... } }
+
+#define BACKUP_PART_MAX   2048 // one button with every field escaped still fits
+#define BACKUP_READ_BYTES 768  // asset bytes per part (base64: 1024 chars)
+
+// Binary archive (/api/backup.bin, tools/pdbackup.py on the host), little endian:
+//   BinHeader
+//   entries : BinEntry | name | blocks | u32 crc32 of the entry's raw data
+//   blocks  : u16 length + that many bytes, ..., u16 0
+//   end     : BinEntry { BIN_END, raw_size = entries before it } | u32 crc32
+//             of every archive byte before this BinEntry
+// Deck entries carry the profile's deck file as is, file entries an asset.
+// With BIN_F_DEFLATE the blocks hold a gzip member of the raw data instead
+// (no optional header fields); files that are compressed already are stored.
+// Entries of an unknown kind are skipped on restore.
+//
+// A differential archive (BIN_H_DIFF) is made against a manifest of an
+// earlier backup: it holds the settings, the decks and files whose CRC32 or
+// size differ from the manifest's, and a BIN_DELETE entry (no data) for each
+// profile or file the manifest lists that is gone.
+#define BIN_MAGIC   0x31424450u // "PDB1"
+#define BIN_VERSION 1
+
+enum BinKind : uint8_t {
+    BIN_CONFIG = 1,  // BinConfig
+    BIN_DECK = 2,    // built-in profile `arg` (0 Windows, 1 macOS)
+    BIN_PROFILE = 3, // named profile, `arg` = target OS
+    BIN_FILE = 4,
+    BIN_DELETE = 5,  // profile or file `name` is gone, `arg` = BIN_PROFILE or BIN_FILE
+    BIN_END = 0xFF,
+};
+
+#define BIN_F_DEFLATE 0x01 // BinEntry.flags
+#define BIN_H_DIFF    0x01 // BinHeader.flags
+
+struct BinHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t flags;
+};
+
+struct BinEntry {
+    uint8_t kind;
+    uint8_t flags;
+    uint8_t name_len;
+    uint8_t arg;
+    uint32_t raw_size;
+};
+
+struct BinConfig {
+    uint32_t bg;
+    uint8_t rows, cols, os, profile, lang;
+    uint8_t reserved[3];
+    char wifi_ssid[32];
+};
+
+static_assert(sizeof(BinHeader) == 8 && sizeof(BinEntry) == 8 && sizeof(BinConfig) == 44, "archive layout");
+
+struct BackupSettings {
+    uint32_t bg;
+    uint8_t rows, cols, os, profile, lang;
+    const char* wifi_ssid;
+};
+
+// Asset files for which this returns true are left out
+typedef bool (*backup_skip_fn)(const char* name);
+
+// Manifest: what a backup would hold, one JSON key per deck and file with its
+// CRC32 and size, no content:
+//   { "deck:0": "1a2b3c4d:2048", "profile:Games": "...", "file:logo.png": "..." }
+// CRCs of assets are cached and only recomputed for files reported through
+// backup_file_changed() or whose size changed; decks are small and rehashed.
+enum BackupFormat : uint8_t { BACKUP_JSON, BACKUP_BIN, BACKUP_MANIFEST };
+
+#define BACKUP_BASE_MAX 160 // manifest entries a differential backup compares against
+
+struct BackupStream;
+struct BackupBase;
+
+// nullptr if out of memory. `s` is copied, `wifi_ssid` must outlive the stream.
+// `base` (BACKUP_BIN only, taken over): make a differential archive against it.
+BackupStream* backup_create(const BackupSettings& s, backup_skip_fn skip, BackupFormat format = BACKUP_JSON,
+                            BackupBase* base = nullptr);
+void backup_destroy(BackupStream* b);
+
+// Next bytes of the backup into `buf`; 0 once it is complete
+size_t backup_read(BackupStream* b, uint8_t* buf, size_t max);
+
+// An earlier manifest, parsed as it is uploaded. feed() and finish() return
+// false once it is invalid; backup_base_error() says why.
+BackupBase* backup_base_create();
+void backup_base_destroy(BackupBase* m);
+bool backup_base_feed(BackupBase* m, const uint8_t* data, size_t len);
+bool backup_base_finish(BackupBase* m);
+const char* backup_base_error(const BackupBase* m);
+
+// The content of asset `name` changed or it was removed (drops its cached
+// CRC). Any task.
+void backup_file_changed(const char* name);
+
+// ==========================================
+// STREAMING RESTORE
+// ==========================================
+// Reads a backup as it is uploaded: the JSON is parsed incrementally
+// (JsonReader), buttons go into one deck at a time, assets are base64-decoded
+// straight into files. An archive is checked entry by entry (CRC, sizes) and
+// inflated on the fly into the same kind of files. Everything is written to
+// hidden temporary files (RESTORE_TMP_PREFIX); nothing existing is touched
+// until restore_commit() after the whole document was read and found valid,
+// which renames them into place. An abandoned restore leaves only temporary
+// files, removed by the next restore_create().
+//
+// Assets and archived decks are compared with the file they replace while
+// they arrive; one that turns out identical is never written at all.
+//
+// Backups without "page_slots" (before paged decks) have 20 buttons per page.
+
+#define RESTORE_TMP_PREFIX ".rst_"
+#define RESTORE_MAX_ASSETS 128
+
+struct RestoreSettings {
+    bool has_bg, has_profile, has_os, has_lang, has_ssid, has_pass;
+    uint32_t bg;
+    uint8_t rows, cols; // 0: not in the backup
+    uint8_t profile, os, lang;
+    char wifi_ssid[32];
+    char wifi_pass[64];
+};
+
+struct RestoreStream;
+
+// `binary`: the input is a BinHeader archive, JSON otherwise
+RestoreStream* restore_create(bool binary = false);
+// Drops the temporary files unless committed
+void restore_destroy(RestoreStream* r);
+
+// false once the input is invalid; restore_error() says why
+bool restore_feed(RestoreStream* r, const uint8_t* data, size_t len);
+
+// After the last byte: checks the document is complete, then moves decks
+// and assets into place and rewrites the profile list (profiles added by
+// name, those a differential archive deleted removed). All or nothing: the
+// replaced files are kept until every rename succeeded and put back if one
+// fails. Resident profiles are not touched; the caller applies `out` and
+// reloads them (profiles_load()). Call persist_flush() first: pending edits
+// would land on top of the restored files.
+bool restore_commit(RestoreStream* r, RestoreSettings& out);
+
+const char* restore_error(const RestoreStream* r);
+
+#endif // BACKUP_H
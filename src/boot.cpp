@@ -0,0 +1,65 @@
+#include "boot.h"
+#include <Arduino.h>
+#include <esp_timer.h>
+
+static const char* const g_names[BOOT_PHASES] = {
+    "serial", "panel", "fs", "config", "ui", "first_frame", "ble", "wifi"
+};
+
+// 32-bit stores are atomic here; 71 minutes of range is plenty for a boot
+static volatile uint32_t g_start[BOOT_PHASES] = {};
+static volatile uint32_t g_end[BOOT_PHASES] = {};
+static volatile uint32_t g_usable = 0;
+
+static uint32_t now_us() {
+    uint32_t t = (uint32_t)esp_timer_get_time();
+    return t ? t : 1; // 0 means "not yet"
+}
+
+void boot_phase_start(BootPhase p) {
+    if (p >= BOOT_PHASES) return;
+    g_start[p] = now_us();
+    g_end[p] = 0;
+}
+
+void boot_phase_end(BootPhase p) {
+    if (p >= BOOT_PHASES || !g_start[p]) return;
+    g_end[p] = now_us();
+    // Phases finishing after the deck is up get their own line
+    if (g_usable) {
+        Serial.printf("BOOT: %s done at %u ms (%u ms)\n", g_names[p],
+                      (unsigned)(g_end[p] / 1000), (unsigned)((g_end[p] - g_start[p]) / 1000));
+    }
+}
+
+void boot_mark_usable() {
+    g_usable = now_us();
+    String line = "BOOT:";
+    for (uint8_t i = 0; i < BOOT_PHASES; i++) {
+        if (!g_start[i]) continue;
+        line += " ";
+        line += g_names[i];
+        if (g_end[i]) line += " " + String((g_end[i] - g_start[i]) / 1000) + "ms";
+        else line += " ...";
+    }
+    Serial.println(line);
+    Serial.printf("BOOT: deck usable at %u ms (target %u ms)%s\n", (unsigned)(g_usable / 1000),
+                  (unsigned)(BOOT_TARGET_US / 1000), g_usable > BOOT_TARGET_US ? " - SLOW" : "");
+}
+
+const char* boot_phase_name(BootPhase p) {
+    return p < BOOT_PHASES ? g_names[p] : "";
+}
+
+BootPhaseTime boot_phase_time(BootPhase p) {
+    BootPhaseTime t = {};
+    if (p < BOOT_PHASES) {
+        t.start_us = g_start[p];
+        t.end_us = g_end[p];
+    }
+    return t;
+}
+
+uint32_t boot_usable_us() {
+    return g_usable;
+}
@@ -0,0 +1,45 @@
+#ifndef BOOT_H
+#define BOOT_H
+
+#include <stdint.h>
+
+// ==========================================
+// BOOT PHASE TIMING
+// ==========================================
+// Start and end of every boot phase in microseconds since the app started
+// (esp_timer_get_time). The filesystem and BLE phases run in a task on the
+// other core while the panel comes up, and WiFi associates in the background,
+// so phases overlap: the deck is usable once the first frame is on screen,
+// not when every phase is done.
+
+#define BOOT_TARGET_US 1000000 // usable deck within one second
+
+enum BootPhase : uint8_t {
+    BOOT_SERIAL,
+    BOOT_PANEL,
+    BOOT_FS,
+    BOOT_CONFIG,
+    BOOT_UI,
+    BOOT_FIRST_FRAME,
+    BOOT_BLE,
+    BOOT_WIFI,   // until an IP is assigned
+    BOOT_PHASES
+};
+
+struct BootPhaseTime {
+    uint32_t start_us; // 0: not started
+    uint32_t end_us;   // 0: still running
+};
+
+// Safe from any task; each phase is written by one task only
+void boot_phase_start(BootPhase p);
+void boot_phase_end(BootPhase p);
+
+// First frame of the deck is on screen: logs every phase finished so far
+void boot_mark_usable();
+
+const char* boot_phase_name(BootPhase p);
+BootPhaseTime boot_phase_time(BootPhase p);
+uint32_t boot_usable_us(); // 0 until boot_mark_usable()
+
+#endif // BOOT_H
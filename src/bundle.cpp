@@ -0,0 +1,210 @@
+#include "bundle.h"
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <new>
+#include <vector>
+
+#define TAR_BLOCK 512
+
+enum BundleState : uint8_t { BS_HEADER, BS_DATA, BS_PAD, BS_END };
+
+struct Bundle {
+    bool (*allow)(const char* path);
+    BundleState state = BS_HEADER;
+    uint8_t hdr[TAR_BLOCK];
+    size_t fill = 0;       // header bytes so far
+    uint32_t remaining = 0; // data bytes left in the entry
+    uint32_t pad = 0;       // then padding to the next block
+    uint8_t zero_blocks = 0;
+    bool extracting = false; // the data belongs to files.back()
+    bool long_name = false;  // a GNU long name entry precedes this one
+    uint32_t offset = 0;    // archive bytes consumed
+    uint32_t hdr_at = 0;    // offset of the current header, for error messages
+    File f;                 // entry being extracted, if any
+    char tmp[72];
+    std::vector<BundleFile> files;
+    char error[64] = "";
+};
+
+Bundle* bundle_create(bool (*allow)(const char* path)) {
+    Bundle* b = new (std::nothrow) Bundle();
+    if (b) b->allow = allow;
+    return b;
+}
+
+void bundle_destroy(Bundle* b) {
+    if (!b) return;
+    if (b->f) {
+        b->f.close();
+        LittleFS.remove(b->tmp);
+    }
+    delete b;
+}
+
+size_t bundle_file_count(const Bundle* b) {
+    return b->files.size();
+}
+
+const BundleFile& bundle_file(const Bundle* b, size_t i) {
+    return b->files[i];
+}
+
+const char* bundle_error(const Bundle* b) {
+    return b->error;
+}
+
+// Octal numeric field, NUL or space terminated
+static bool octal(const uint8_t* p, size_t len, uint32_t& out) {
+    uint64_t v = 0;
+    size_t i = 0;
+    while (i < len && p[i] == ' ') i++;
+    for (; i < len && p[i] >= '0' && p[i] <= '7'; i++) v = v * 8 + (p[i] - '0');
+    if (i < len && p[i] != ' ' && p[i] != '\0') return false;
+    if (v > UINT32_MAX) return false;
+    out = (uint32_t)v;
+    return true;
+}
+
+static bool checksum_ok(const uint8_t* h) {
+    uint32_t stored;
+    if (!octal(h + 148, 8, stored)) return false;
+    uint32_t sum = 0;
+    for (size_t i = 0; i < TAR_BLOCK; i++) sum += (i >= 148 && i < 156) ? ' ' : h[i];
+    return sum == stored;
+}
+
+static void entry_failed(Bundle* b, const char* why) {
+    if (b->f) {
+        b->f.close();
+        LittleFS.remove(b->tmp);
+    }
+    if (b->extracting && !b->files.back().error) b->files.back().error = why;
+}
+
+static void entry_done(Bundle* b) {
+    if (b->f) {
+        b->f.close();
+        BundleFile& e = b->files.back();
+        // The old file stays in place until the new one is complete
+        if (!LittleFS.rename(b->tmp, e.name)) {
+            LittleFS.remove(b->tmp);
+            e.error = "Could not replace the file";
+        }
+    }
+    b->extracting = false;
+    b->state = b->pad ? BS_PAD : BS_HEADER;
+}
+
+static bool reject(Bundle* b, const char* why) {
+    snprintf(b->error, sizeof(b->error), "%s at byte %u", why, (unsigned)b->hdr_at);
+    return false;
+}
+
+// A complete header block is in b->hdr
+static bool begin_entry(Bundle* b) {
+    const uint8_t* h = b->hdr;
+    bool zero = true;
+    for (size_t i = 0; i < TAR_BLOCK && zero; i++) zero = h[i] == 0;
+    if (zero) {
+        // Two of them end the archive
+        if (++b->zero_blocks == 2) b->state = BS_END;
+        return true;
+    }
+    b->zero_blocks = 0;
+    if (!checksum_ok(h)) return reject(b, "Not a tar header");
+    uint32_t size;
+    if (!octal(h + 124, 12, size)) return reject(b, "Entry too large");
+    b->remaining = size;
+    b->pad = (TAR_BLOCK - size % TAR_BLOCK) % TAR_BLOCK;
+    b->state = size ? BS_DATA : BS_HEADER;
+
+    // Regular files only ('\0' is the pre-POSIX spelling, '7' contiguous)
+    char type = (char)h[156];
+    bool long_name = b->long_name;
+    b->long_name = type == 'L';
+    if (type != '0' && type != '\0' && type != '7') return true;
+
+    // Last path component; ustar's prefix field only adds directories
+    char full[101];
+    memcpy(full, h, 100);
+    full[100] = '\0';
+    const char* base = strrchr(full, '/');
+    base = base ? base + 1 : full;
+    if (!*base) return true; // "dir/" written as a file entry
+
+    if (b->files.size() >= BUNDLE_MAX_FILES) return reject(b, "Too many files");
+    b->files.push_back(BundleFile());
+    BundleFile& e = b->files.back();
+    e.size = size;
+    e.error = nullptr;
+    b->extracting = true;
+    snprintf(e.name, sizeof(e.name), "/%s", base);
+    if (long_name || strlen(base) + 2 > sizeof(e.name)) {
+        e.error = "Name too long";
+    } else if (base[0] == '.' || (b->allow && !b->allow(e.name))) {
+        e.error = "Not allowed";
+    } else {
+        upload_tmp_path(e.name, b->tmp, sizeof(b->tmp));
+        b->f = LittleFS.open(b->tmp, "w");
+        if (!b->f) e.error = "Could not create the file";
+    }
+    if (!size) entry_done(b);
+    return true;
+}
+
+static bool bundle_sink(void* ctx, const uint8_t* data, size_t len) {
+    Bundle* b = (Bundle*)ctx;
+    while (len) {
+        size_t n = len;
+        switch (b->state) {
+            case BS_HEADER:
+                if (!b->fill) b->hdr_at = b->offset;
+                if (n > TAR_BLOCK - b->fill) n = TAR_BLOCK - b->fill;
+                memcpy(b->hdr + b->fill, data, n);
+                b->fill += n;
+                if (b->fill == TAR_BLOCK) {
+                    b->fill = 0;
+                    if (!begin_entry(b)) return false;
+                }
+                break;
+            case BS_DATA:
+                if (n > b->remaining) n = b->remaining;
+                // A failed file is skipped; the ones after it still get their chance
+                if (b->f && b->f.write(data, n) != n) entry_failed(b, "Write failed (storage full?)");
+                b->remaining -= n;
+                if (!b->remaining) entry_done(b);
+                break;
+            case BS_PAD:
+                if (n > b->pad) n = b->pad;
+                b->pad -= n;
+                if (!b->pad) b->state = BS_HEADER;
+                break;
+            case BS_END:
+                return true; // Trailing blocks (tar pads to 10 KB records)
+        }
+        data += n;
+        len -= n;
+        b->offset += n;
+    }
+    return true;
+}
+
+static bool bundle_finish(void* ctx, bool ok) {
+    Bundle* b = (Bundle*)ctx;
+    // Without the end blocks, but not inside an entry, is taken as complete
+    bool inside = b->state == BS_DATA || b->state == BS_PAD || b->fill != 0;
+    if (inside) {
+        entry_failed(b, "Incomplete");
+        if (ok) snprintf(b->error, sizeof(b->error), "Archive ends inside an entry");
+        return false;
+    }
+    return ok;
+}
+
+UploadResult bundle_start(Bundle* b, size_t size, AsyncClient* client, uint32_t* id) {
+    *id = 0;
+    UploadResult res = upload_prepare(size);
+    if (res != UPLOAD_OK) return res;
+    *id = upload_start(bundle_sink, bundle_finish, b, client, [](void* b) { bundle_destroy((Bundle*)b); });
+    return *id ? UPLOAD_OK : UPLOAD_FAILED;
+}
@@ -0,0 +1,47 @@
+#ifndef BUNDLE_H
+#define BUNDLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "upload.h"
+
+// ==========================================
+// ASSET BUNDLES (tar)
+// ==========================================
+// POST /api/bundle takes a tar archive (ustar or GNU, as `tar -cf` writes
+// them) and extracts its regular files into the LittleFS root while it
+// arrives, through the buffered upload pipeline (upload.h): nothing but the
+// current 512-byte header is held in memory. Directories in entry names are
+// dropped ("icons/mute.png" -> "/mute.png"); directory, link and metadata
+// entries are skipped. Each file goes through a temporary name and replaces
+// an existing one only when complete, so a broken archive leaves the files
+// before the break extracted and nothing half-written.
+
+#define BUNDLE_MAX_FILES 256
+#define BUNDLE_NAME_LEN  48 // longest file name kept, terminator included
+
+struct BundleFile {
+    char name[BUNDLE_NAME_LEN]; // "/mute.png"
+    uint32_t size;
+    const char* error;          // nullptr: written
+};
+
+struct Bundle;
+
+// `allow` decides which paths may be written (system files may not)
+Bundle* bundle_create(bool (*allow)(const char* path));
+void bundle_destroy(Bundle* b);
+
+// Starts the upload of a `size`-byte archive into `b` (see upload_prepare()).
+// If upload_end() returns UPLOAD_PENDING or upload_abort() false, the upload
+// task destroys `b` once it is done with it.
+UploadResult bundle_start(Bundle* b, size_t size, AsyncClient* client, uint32_t* id);
+
+// After upload_end(): the entries seen, in archive order
+size_t bundle_file_count(const Bundle* b);
+const BundleFile& bundle_file(const Bundle* b, size_t i);
+
+// Why the archive itself was rejected, "" if it was not
+const char* bundle_error(const Bundle* b);
+
+#endif // BUNDLE_H
@@ -0,0 +1,56 @@
+#include "button_cache.h"
+#include <vector>
+
+struct CachedButton {
+    uint32_t key;
+    lv_draw_buf_t* buf;
+};
+
+static std::vector<CachedButton> g_slots;
+
+static void release(CachedButton& c) {
+    if (!c.buf) return;
+    lv_image_cache_drop(c.buf);
+    lv_draw_buf_destroy(c.buf);
+    c.buf = nullptr;
+}
+
+const lv_draw_buf_t* button_cache_get(uint16_t idx, uint32_t key) {
+    if (idx >= g_slots.size() || !g_slots[idx].buf || g_slots[idx].key != key) return nullptr;
+    return g_slots[idx].buf;
+}
+
+const lv_draw_buf_t* button_cache_store(uint16_t idx, uint32_t key, lv_obj_t* obj) {
+    if (idx >= g_slots.size()) g_slots.resize(idx + 1, CachedButton{ 0, nullptr });
+    CachedButton& c = g_slots[idx];
+    release(c);
+    // ARGB8888 keeps the rounded corners transparent over any background
+    c.buf = lv_snapshot_take(obj, LV_COLOR_FORMAT_ARGB8888);
+    c.key = key;
+    return c.buf;
+}
+
+void button_cache_drop(uint16_t first, uint16_t count) {
+    for (size_t i = first; i < g_slots.size() && i < (size_t)first + count; i++) release(g_slots[i]);
+}
+
+void button_cache_clear() {
+    for (CachedButton& c : g_slots) release(c);
+    g_slots.clear();
+}
+
+const lv_draw_buf_t* button_cache_at(uint16_t idx) {
+    return idx < g_slots.size() ? g_slots[idx].buf : nullptr;
+}
+
+uint16_t button_cache_count() {
+    uint16_t n = 0;
+    for (const CachedButton& c : g_slots) n += c.buf ? 1 : 0;
+    return n;
+}
+
+size_t button_cache_bytes() {
+    size_t total = 0;
+    for (const CachedButton& c : g_slots) total += c.buf ? c.buf->data_size : 0;
+    return total;
+}
@@ -0,0 +1,32 @@
+#ifndef BUTTON_CACHE_H
+#define BUTTON_CACHE_H
+
+#include <lvgl.h>
+
+// ==========================================
+// PRE-RENDERED BUTTONS
+// ==========================================
+// One ARGB8888 snapshot per grid slot (LV_USE_SNAPSHOT), tagged with a key the
+// caller derives from everything that affects the look of the cell. While the
+// key matches, the cell is drawn as a single image: an invalidation costs one
+// blit instead of re-rasterizing the rounded rect, shadow, icon and label.
+
+// Snapshot of slot `idx` if it was rendered with `key`, otherwise nullptr
+const lv_draw_buf_t* button_cache_get(uint16_t idx, uint32_t key);
+
+// Renders `obj` (laid out, on a screen) into the slot. Returns the snapshot,
+// or nullptr when it could not be allocated.
+const lv_draw_buf_t* button_cache_store(uint16_t idx, uint32_t key, lv_obj_t* obj);
+
+// Frees slots first..first+count-1 (e.g. a page that is no longer materialized)
+void button_cache_drop(uint16_t first, uint16_t count);
+void button_cache_clear();
+
+// Whatever slot `idx` holds, without a key check (drawing a page that was
+// filled, and so validated, when it was built)
+const lv_draw_buf_t* button_cache_at(uint16_t idx);
+
+uint16_t button_cache_count();
+size_t button_cache_bytes();
+
+#endif // BUTTON_CACHE_H
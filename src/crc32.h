@@ -0,0 +1,36 @@
+#ifndef CRC32_H
+#define CRC32_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(ESP_PLATFORM)
+#include <rom/crc.h>
+#endif
+
+// Standard CRC-32 (zlib / PNG polynomial). Pass 0 to start, then feed the
+// previous result back in to checksum data in several chunks.
+inline uint32_t crc32_update(uint32_t crc, const void* data, size_t len)
+{
+#if defined(ESP_PLATFORM)
+    // Table lives in ROM, no RAM cost
+    return crc32_le(crc, (const uint8_t*)data, (uint32_t)len);
+#else
+    static uint32_t table[256];
+    static bool table_ready = false;
+    if (!table_ready) {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++) c = (c & 1) ? (0xEDB88320u ^ (c >> 1)) : (c >> 1);
+            table[i] = c;
+        }
+        table_ready = true;
+    }
+    const uint8_t* p = (const uint8_t*)data;
+    crc = ~crc;
+    while (len--) crc = table[(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+#endif
+}
+
+#endif // CRC32_H
@@ -0,0 +1,414 @@
+#include "deck.h"
+#include "crc32.h"
+#include "profiles.h"
+#include "str_arena.h"
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <esp_heap_caps.h>
+
+#define DECK_V1_SLOTS 20
+// Log positions tracked: one per resident profile, so saving any of them
+// appends, plus one shared by hidden files (restore temporaries)
+#define DECK_LOG_FILES (PROFILE_MAX + 1)
+
+// Where the next append goes, per file; filled by deck_load()/deck_save()
+struct LogState {
+    char path[32];
+    uint32_t next_seq;
+    uint32_t records;    // records in the file
+    uint32_t live;       // records a compaction would write
+    uint16_t page_count; // after replaying the file
+    bool appendable;     // the file is a log that ends on a good record
+};
+
+static LogState g_logs[DECK_LOG_FILES];
+static uint8_t g_log_next = 0; // round-robin slot for new paths, when none is free
+
+static const char DEFAULT_LABEL[] = "Button";
+
+void deck_default_button(ButtonConfig& b) {
+    memset(&b, 0, sizeof(ButtonConfig));
+    b.color = 0x333333;
+    strncpy(b.label, DEFAULT_LABEL, 15);
+}
+
+void deck_default_button(Button& b) {
+    b.label = DEFAULT_LABEL;
+    b.value = b.icon = b.imgPath = "";
+    b.color = 0x333333;
+    b.type = 0;
+}
+
+static void reset_pages(Deck& d, uint16_t from, uint16_t to) {
+    for (size_t i = (size_t)from * DECK_PAGE_SLOTS; i < (size_t)to * DECK_PAGE_SLOTS; i++) {
+        deck_default_button(d.buttons[i]);
+    }
+}
+
+bool deck_resize(Deck& d, uint16_t page_count) {
+    if (page_count < 1) page_count = 1;
+    if (page_count > DECK_MAX_PAGES) page_count = DECK_MAX_PAGES;
+    if (!d.buttons) {
+        size_t size = sizeof(Button) * DECK_PAGE_SLOTS * DECK_MAX_PAGES;
+        d.buttons = (Button*)heap_caps_malloc(size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        if (!d.buttons) d.buttons = (Button*)malloc(size);
+        if (!d.buttons) return false;
+        d.page_count = 0;
+    }
+    if (!d.strings) d.strings = str_arena_create();
+    if (!d.strings) return false;
+    if (page_count > d.page_count) reset_pages(d, d.page_count, page_count);
+    d.page_count = page_count;
+    return true;
+}
+
+bool deck_init(Deck& d, uint16_t page_count) {
+    d.page_count = 0;
+    str_arena_destroy(d.strings);
+    d.strings = nullptr;
+    return deck_resize(d, page_count);
+}
+
+void deck_free(Deck& d) {
+    heap_caps_free(d.buttons);
+    str_arena_destroy(d.strings);
+    d.buttons = nullptr;
+    d.strings = nullptr;
+    d.page_count = 0;
+}
+
+static const char* intern(Deck& d, const char* s, size_t max) {
+    size_t len = strnlen(s, max);
+    // The default label keeps its static pointer
+    if (len == sizeof(DEFAULT_LABEL) - 1 && memcmp(s, DEFAULT_LABEL, len) == 0) return DEFAULT_LABEL;
+    return str_arena_intern(d.strings, s, len);
+}
+
+bool deck_set(Deck& d, size_t index, const ButtonConfig& b) {
+    Button packed;
+    packed.label = intern(d, b.label, sizeof(b.label));
+    packed.value = intern(d, b.value, sizeof(b.value));
+    packed.icon = intern(d, b.icon, sizeof(b.icon));
+    packed.imgPath = intern(d, b.imgPath, sizeof(b.imgPath));
+    packed.color = b.color;
+    packed.type = b.type;
+    if (!packed.label || !packed.value || !packed.icon || !packed.imgPath) return false;
+    d.buttons[index] = packed;
+    return true;
+}
+
+static void unpack(const Button& b, ButtonConfig& out) {
+    memset(&out, 0, sizeof(ButtonConfig));
+    strncpy(out.label, b.label, sizeof(out.label) - 1);
+    strncpy(out.value, b.value, sizeof(out.value) - 1);
+    strncpy(out.icon, b.icon, sizeof(out.icon) - 1);
+    strncpy(out.imgPath, b.imgPath, sizeof(out.imgPath) - 1);
+    out.color = b.color;
+    out.type = b.type;
+}
+
+void deck_get(const Deck& d, size_t index, ButtonConfig& out) {
+    unpack(d.buttons[index], out);
+}
+
+static LogState& log_state(const char* path) {
+    for (LogState& st : g_logs) {
+        if (strcmp(st.path, path) == 0) return st;
+    }
+    const char* base = strrchr(path, '/');
+    base = base ? base + 1 : path;
+    LogState* slot = &g_logs[DECK_LOG_FILES - 1];
+    if (base[0] != '.') {
+        // A free slot, else one of a deleted profile, else round robin
+        slot = nullptr;
+        for (uint8_t i = 0; i < DECK_LOG_FILES - 1 && !slot; i++) {
+            if (!g_logs[i].path[0]) slot = &g_logs[i];
+        }
+        for (uint8_t i = 0; i < DECK_LOG_FILES - 1 && !slot; i++) {
+            if (!LittleFS.exists(g_logs[i].path)) slot = &g_logs[i];
+        }
+        if (!slot) slot = &g_logs[g_log_next++ % (DECK_LOG_FILES - 1)];
+    }
+    LogState& st = *slot;
+    memset(&st, 0, sizeof(st));
+    strncpy(st.path, path, sizeof(st.path) - 1);
+    return st;
+}
+
+static bool is_default(const Button& b) {
+    return b.color == 0x333333 && b.type == 0 && strcmp(b.label, DEFAULT_LABEL) == 0 &&
+           !b.value[0] && !b.icon[0] && !b.imgPath[0];
+}
+
+// --- v4 payload: varints and length-prefixed strings ---
+
+static uint8_t* put_varint(uint8_t* p, uint32_t v) {
+    while (v >= 0x80) {
+        *p++ = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    *p++ = (uint8_t)v;
+    return p;
+}
+
+static const uint8_t* get_varint(const uint8_t* p, const uint8_t* end, uint32_t* v) {
+    *v = 0;
+    for (int shift = 0; p < end && shift < 35; shift += 7) {
+        uint8_t c = *p++;
+        *v |= (uint32_t)(c & 0x7F) << shift;
+        if (!(c & 0x80)) return p;
+    }
+    return nullptr;
+}
+
+static uint8_t* put_string(uint8_t* p, const char* s, size_t max) {
+    size_t len = strnlen(s, max);
+    p = put_varint(p, len);
+    memcpy(p, s, len);
+    return p + len;
+}
+
+// Longer strings than the field holds are cut, like any edit would
+static const uint8_t* get_string(const uint8_t* p, const uint8_t* end, char* out, size_t size) {
+    uint32_t len;
+    p = p ? get_varint(p, end, &len) : nullptr;
+    if (!p || len > (uint32_t)(end - p)) return nullptr;
+    memcpy(out, p, len < size - 1 ? len : size - 1);
+    return p + len;
+}
+
+static uint16_t encode_button(const Button& b, uint8_t* buf) {
+    // Field sizes of the edit buffer bound every string (DECK_LOG_MAX_PAYLOAD)
+    uint8_t* p = put_varint(buf, b.type);
+    p = put_varint(p, b.color);
+    p = put_string(p, b.label, sizeof(ButtonConfig::label) - 1);
+    p = put_string(p, b.value, sizeof(ButtonConfig::value) - 1);
+    p = put_string(p, b.icon, sizeof(ButtonConfig::icon) - 1);
+    p = put_string(p, b.imgPath, sizeof(ButtonConfig::imgPath) - 1);
+    return (uint16_t)(p - buf);
+}
+
+static bool decode_button(const uint8_t* p, uint16_t len, ButtonConfig& b) {
+    const uint8_t* end = p + len;
+    uint32_t type, color;
+    memset(&b, 0, sizeof(ButtonConfig));
+    p = get_varint(p, end, &type);
+    p = p ? get_varint(p, end, &color) : nullptr;
+    p = get_string(p, end, b.label, sizeof(b.label));
+    p = get_string(p, end, b.value, sizeof(b.value));
+    p = get_string(p, end, b.icon, sizeof(b.icon));
+    p = get_string(p, end, b.imgPath, sizeof(b.imgPath));
+    b.type = (uint8_t)type;
+    b.color = color;
+    return p != nullptr;
+}
+
+static uint32_t record_crc(const DeckLogRecord& r, const void* payload) {
+    uint32_t crc = crc32_update(0, &r, offsetof(DeckLogRecord, crc));
+    return crc32_update(crc, payload, r.len);
+}
+
+static bool write_record(File& f, uint32_t seq, uint8_t kind, uint16_t index, const void* payload, uint16_t len) {
+    DeckLogRecord r = {};
+    r.seq = seq;
+    r.index = index;
+    r.kind = kind;
+    r.len = len;
+    r.crc = record_crc(r, payload);
+    return f.write((const uint8_t*)&r, sizeof(r)) == sizeof(r) &&
+           (len == 0 || f.write((const uint8_t*)payload, len) == len);
+}
+
+// v1 (bare array) and v2 (PDK2 header + fixed pages)
+static bool load_fixed(Deck& d, File& f) {
+    size_t size = f.size();
+    DeckFileHeader hdr = {};
+    uint16_t file_slots = DECK_V1_SLOTS;
+    uint16_t pages = 1;
+    if (size == sizeof(ButtonConfig) * DECK_V1_SLOTS) {
+        // v1: bare array of 20 records
+    } else if (f.read((uint8_t*)&hdr, sizeof(hdr)) == sizeof(hdr) && hdr.magic == DECK_FILE_MAGIC &&
+               hdr.version == DECK_FILE_VERSION && hdr.record_size == sizeof(ButtonConfig) &&
+               hdr.page_count > 0 && hdr.page_slots > 0 &&
+               size >= sizeof(hdr) + (size_t)hdr.page_count * hdr.page_slots * sizeof(ButtonConfig)) {
+        file_slots = hdr.page_slots;
+        pages = hdr.page_count < DECK_MAX_PAGES ? hdr.page_count : DECK_MAX_PAGES;
+    } else {
+        return false;
+    }
+
+    if (!deck_init(d, pages)) return false;
+    // Pages written with a different slot count keep their first slots
+    uint16_t keep = file_slots < DECK_PAGE_SLOTS ? file_slots : DECK_PAGE_SLOTS;
+    bool ok = true;
+    ButtonConfig b;
+    for (uint16_t p = 0; p < pages && ok; p++) {
+        for (uint16_t s = 0; s < keep && ok; s++) {
+            ok = f.read((uint8_t*)&b, sizeof(b)) == sizeof(b) && deck_set(d, (size_t)p * DECK_PAGE_SLOTS + s, b);
+        }
+        if (ok && file_slots > keep) f.seek((file_slots - keep) * sizeof(ButtonConfig), SeekCur);
+    }
+    return ok;
+}
+
+static bool load_log(Deck& d, File& f, LogState& st) {
+    DeckLogHeader hdr;
+    if (f.read((uint8_t*)&hdr, sizeof(hdr)) != sizeof(hdr) || hdr.magic != DECK_LOG_MAGIC || hdr.page_slots == 0) {
+        return false;
+    }
+    // v3 records carry a whole ButtonConfig
+    bool fixed = hdr.version == 3;
+    if (fixed ? hdr.record_size != sizeof(ButtonConfig) : hdr.version != DECK_LOG_VERSION) return false;
+    if (!deck_init(d, 1)) return false;
+
+    size_t size = f.size();
+    size_t good_end = sizeof(hdr);
+    uint32_t records = 0, next_seq = 1;
+    static_assert(sizeof(ButtonConfig) <= DECK_LOG_MAX_PAYLOAD, "v3 records must fit the payload buffer");
+    uint8_t payload[DECK_LOG_MAX_PAYLOAD];
+    ButtonConfig b;
+    DeckLogRecord r;
+    while (f.read((uint8_t*)&r, sizeof(r)) == sizeof(r)) {
+        if (records > 0 && r.seq != next_seq) break;
+        if (r.len > sizeof(payload) || f.read(payload, r.len) != r.len) break;
+        if (record_crc(r, payload) != r.crc) break;
+
+        if (r.kind == DECK_LOG_PAGES) {
+            deck_resize(d, r.index);
+        } else if (r.kind == DECK_LOG_BUTTON) {
+            uint16_t page = r.index / hdr.page_slots, slot = r.index % hdr.page_slots;
+            bool ok = fixed ? r.len == sizeof(ButtonConfig) : decode_button(payload, r.len, b);
+            if (ok && fixed) memcpy(&b, payload, sizeof(b));
+            if (ok && page < d.page_count && slot < DECK_PAGE_SLOTS) deck_set(d, (size_t)page * DECK_PAGE_SLOTS + slot, b);
+        }
+        records++;
+        next_seq = r.seq + 1;
+        good_end = f.position();
+    }
+
+    st.next_seq = next_seq;
+    st.records = records;
+    st.live = records;
+    st.page_count = d.page_count;
+    // A damaged tail, another slot layout or v3 records: the next save compacts
+    st.appendable = good_end == size && hdr.page_slots == DECK_PAGE_SLOTS && !fixed;
+    if (good_end != size) Serial.printf("DECK: %s damaged after %u records\n", st.path, (unsigned)records);
+    return true;
+}
+
+bool deck_load(Deck& d, const char* path) {
+    File f = LittleFS.open(path, "r");
+    if (!f) return false;
+
+    uint32_t magic = 0;
+    bool is_log = f.read((uint8_t*)&magic, sizeof(magic)) == sizeof(magic) && magic == DECK_LOG_MAGIC;
+    f.seek(0, SeekSet);
+    LogState& st = log_state(path);
+    bool ok;
+    if (is_log) {
+        ok = load_log(d, f, st);
+    } else {
+        ok = load_fixed(d, f);
+        st.appendable = false;
+    }
+    f.close();
+    return ok;
+}
+
+bool deck_save(const Deck& d, const char* path, size_t* written) {
+    LogState& st = log_state(path);
+    String tmp = String("/.") + (path[0] == '/' ? path + 1 : path) + ".tmp";
+    File f = LittleFS.open(tmp, "w");
+    if (!f) return false;
+
+    DeckLogHeader hdr = { DECK_LOG_MAGIC, DECK_LOG_VERSION, DECK_PAGE_SLOTS, 0, 0 };
+    uint32_t seq = st.next_seq ? st.next_seq : 1;
+    uint32_t records = 1;
+    bool ok = f.write((const uint8_t*)&hdr, sizeof(hdr)) == sizeof(hdr) &&
+              write_record(f, seq++, DECK_LOG_PAGES, d.page_count, nullptr, 0);
+    // Replay starts from defaults: only customized buttons need a record
+    uint8_t payload[DECK_LOG_MAX_PAYLOAD];
+    for (size_t i = 0; ok && i < (size_t)d.page_count * DECK_PAGE_SLOTS; i++) {
+        if (is_default(d.buttons[i])) continue;
+        ok = write_record(f, seq++, DECK_LOG_BUTTON, (uint16_t)i, payload, encode_button(d.buttons[i], payload));
+        records++;
+    }
+    size_t size = f.size();
+    f.close();
+
+    // The old file stays in place until the new one is complete
+    if (!ok || !LittleFS.rename(tmp, path)) {
+        LittleFS.remove(tmp);
+        return false;
+    }
+    st.next_seq = seq;
+    st.records = records;
+    st.live = records;
+    st.page_count = d.page_count;
+    st.appendable = true;
+    if (written) *written = size;
+    return true;
+}
+
+bool deck_append(const Deck& d, const char* path, const uint16_t* indices, size_t count, size_t* written) {
+    LogState& st = log_state(path);
+    if (!st.appendable) return deck_save(d, path, written);
+
+    File f = LittleFS.open(path, "a");
+    if (!f) return false;
+    size_t start = f.size();
+    bool ok = true;
+    uint32_t appended = 0;
+    if (d.page_count != st.page_count) {
+        ok = write_record(f, st.next_seq++, DECK_LOG_PAGES, d.page_count, nullptr, 0);
+        appended++;
+    }
+    uint8_t payload[DECK_LOG_MAX_PAYLOAD];
+    for (size_t i = 0; i < count && ok; i++) {
+        uint16_t len = encode_button(d.buttons[indices[i]], payload);
+        ok = write_record(f, st.next_seq++, DECK_LOG_BUTTON, indices[i], payload, len);
+        appended++;
+    }
+    size_t bytes = f.size() - start;
+    f.close();
+    if (!ok) {
+        st.appendable = false; // Partial record at the end: compact next time
+        return false;
+    }
+    st.records += appended;
+    st.page_count = d.page_count;
+    if (written) *written = bytes;
+
+    if (st.records >= 2 * st.live + DECK_LOG_SLACK) {
+        size_t compacted = 0;
+        uint32_t before = st.records;
+        if (deck_save(d, path, &compacted)) {
+            Serial.printf("DECK: compacted %s, %u -> %u records\n", path, (unsigned)before, (unsigned)st.records);
+            if (written) *written += compacted;
+        }
+    }
+    return true;
+}
+
+DeckFootprint deck_footprint(const Deck& d) {
+    DeckFootprint fp = {};
+    fp.slots = (uint32_t)d.page_count * DECK_PAGE_SLOTS;
+    uint32_t block = DECK_MAX_PAGES * DECK_PAGE_SLOTS;
+    StrArenaStats st = str_arena_stats(d.strings);
+    fp.strings = st.strings;
+    fp.ram_fixed = block * sizeof(ButtonConfig);
+    fp.ram_packed = block * sizeof(Button) + st.reserved + st.table;
+
+    // Compacted files: header, page count record, one record per custom button
+    uint32_t base = sizeof(DeckLogHeader) + sizeof(DeckLogRecord);
+    fp.flash_fixed = base;
+    fp.flash_packed = base;
+    uint8_t payload[DECK_LOG_MAX_PAYLOAD];
+    for (uint32_t i = 0; i < fp.slots; i++) {
+        if (is_default(d.buttons[i])) continue;
+        fp.custom++;
+        fp.flash_fixed += sizeof(DeckLogRecord) + sizeof(ButtonConfig);
+        fp.flash_packed += sizeof(DeckLogRecord) + encode_button(d.buttons[i], payload);
+    }
+    return fp;
+}
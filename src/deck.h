@@ -0,0 +1,155 @@
+#ifndef DECK_H
+#define DECK_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ==========================================
+// DECK (PAGED BUTTON PROFILE)
+// ==========================================
+// A profile is a list of pages of DECK_PAGE_SLOTS buttons each; the grid
+// shows the first rows*cols slots of the current page. Buttons live in one
+// PSRAM block sized for DECK_MAX_PAGES up front, so adding or removing pages
+// never moves a Button the UI may be pointing at.
+//
+// In RAM a Button is packed: four string pointers into the profile's
+// interned string arena plus color and type (24 bytes instead of the 320 of
+// a ButtonConfig). ButtonConfig remains the edit buffer and the fixed
+// on-disk record of older files; deck_set()/deck_get() convert.
+//
+// File format: an append-only log (little endian)
+//   DeckLogHeader | DeckLogRecord + payload | DeckLogRecord + payload | ...
+// Loading replays the records in order: DECK_LOG_PAGES sets the page count
+// (like deck_resize), DECK_LOG_BUTTON replaces one button. Saving one button
+// appends one record; once the log holds well over twice what a fresh copy
+// would, it is compacted into a new file (page count + non-default buttons)
+// that replaces the old one by rename. Replay stops at the first record whose
+// CRC or sequence number is wrong, so a torn append only loses itself and a
+// torn compaction never touches the previous file.
+//
+// A v4 button payload is variable length: varint type, varint color, then
+// label, value, icon and image path as varint length + bytes.
+//
+// Older formats still load and are converted on the next save:
+//   v3: the same log with one whole ButtonConfig per button record
+//   v2 "PDK2": DeckFileHeader | page_count * page_slots * ButtonConfig
+//   v1: headerless, exactly 20 records, one page
+// Files written with fewer slots per page (20 before large grids) fill the
+// first slots of each page and leave the rest at defaults.
+
+#define DECK_LOG_MAGIC     0x334C4450u // "PDL3"
+#define DECK_LOG_VERSION   4
+#define DECK_LOG_MAX_PAYLOAD 384       // largest encoded button (ButtonConfig limits)
+#define DECK_LOG_SLACK     64          // records tolerated past 2x the compacted size
+#define DECK_FILE_MAGIC    0x324B4450u // "PDK2" (read only)
+#define DECK_FILE_VERSION  2
+#define DECK_PAGE_SLOTS    60          // largest grid (10x6)
+#define DECK_MAX_PAGES     16
+
+struct ButtonConfig {
+    char label[16];
+    char value[256];
+    uint8_t type; // 0: App, 1: Media, 2: Basic, 3: Adv
+    uint32_t color;
+    char icon[8];
+    char imgPath[32];
+};
+
+struct DeckFileHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t page_count;
+    uint16_t page_slots;  // slots per page when the file was written
+    uint16_t record_size; // sizeof(ButtonConfig)
+};
+
+struct DeckLogHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t page_slots;  // index = page * page_slots + slot
+    uint16_t record_size; // v3: sizeof(ButtonConfig), v4: 0 (variable)
+    uint16_t reserved;
+};
+
+enum DeckLogKind : uint8_t { DECK_LOG_PAGES = 1, DECK_LOG_BUTTON = 2 };
+
+struct DeckLogRecord {
+    uint32_t seq;   // previous record + 1
+    uint16_t index; // DECK_LOG_BUTTON: button index, DECK_LOG_PAGES: page count
+    uint8_t kind;
+    uint8_t reserved;
+    uint16_t len;   // payload bytes following the record
+    uint16_t reserved2;
+    uint32_t crc;   // crc32 of the fields above, then the payload
+};
+
+struct StrArena;
+
+// Strings are never null; "" when unset
+struct Button {
+    const char* label;
+    const char* value;
+    const char* icon;
+    const char* imgPath;
+    uint32_t color;
+    uint8_t type;
+};
+
+struct Deck {
+    Button* buttons = nullptr;   // DECK_MAX_PAGES * DECK_PAGE_SLOTS
+    StrArena* strings = nullptr; // every string of the profile, interned
+    uint16_t page_count = 0;
+};
+
+void deck_default_button(ButtonConfig& b);
+void deck_default_button(Button& b);
+
+// Allocates the button block on first use; pages past the old count are reset
+// to defaults. `page_count` is clamped to 1..DECK_MAX_PAGES.
+bool deck_resize(Deck& d, uint16_t page_count);
+
+// Resets every page and sets the page count. Starts a new string arena:
+// strings of the previous buttons are gone.
+bool deck_init(Deck& d, uint16_t page_count);
+
+void deck_free(Deck& d);
+
+inline Button* deck_page(const Deck& d, uint16_t page) {
+    return d.buttons + (size_t)page * DECK_PAGE_SLOTS;
+}
+
+// Replaces the button at `index` (page * DECK_PAGE_SLOTS + slot) with a copy
+// of `b`. Replaced strings stay in the arena until the next deck_init().
+bool deck_set(Deck& d, size_t index, const ButtonConfig& b);
+
+// Copies button `index` into an edit buffer
+void deck_get(const Deck& d, size_t index, ButtonConfig& out);
+
+// false if the file is missing or not a deck (`d` untouched). A log with a
+// damaged tail loads up to the last good record.
+bool deck_load(Deck& d, const char* path);
+
+// Writes a compacted log to a temporary file and renames it over `path`.
+// `written` (optional) receives the bytes written.
+bool deck_save(const Deck& d, const char* path, size_t* written = nullptr);
+
+// Appends the buttons at the given indices (page * DECK_PAGE_SLOTS + slot),
+// preceded by a page count record if that changed. Falls back to deck_save()
+// when `path` was not loaded or saved as a clean log, and compacts when the
+// log has grown too long.
+bool deck_append(const Deck& d, const char* path, const uint16_t* indices, size_t count, size_t* written = nullptr);
+
+struct DeckFootprint {
+    uint32_t slots;        // buttons held (page_count * DECK_PAGE_SLOTS)
+    uint32_t custom;       // non-default buttons (the ones a file stores)
+    uint32_t strings;      // distinct interned strings
+    uint32_t ram_fixed;    // button block as ButtonConfig[DECK_MAX_PAGES * DECK_PAGE_SLOTS]
+    uint32_t ram_packed;   // button block as Button[...] + string arena
+    uint32_t flash_fixed;  // compacted v3 log (whole ButtonConfig records)
+    uint32_t flash_packed; // compacted v4 log
+};
+
+// What `d` costs in both representations, computed without touching files
+DeckFootprint deck_footprint(const Deck& d);
+
+#endif // DECK_H
@@ -0,0 +1,93 @@
+#include "firmware.h"
+#include <Arduino.h>
+#include <Update.h>
+#include <ctype.h>
+#include <esp_ota_ops.h>
+#include <mbedtls/sha256.h>
+
+static mbedtls_sha256_context g_sha;
+static char g_expected[65] = ""; // "" : nothing to check
+static char g_digest[65] = "";
+static char g_error[64] = "";
+
+static bool firmware_sink(void*, const uint8_t* data, size_t len) {
+    mbedtls_sha256_update(&g_sha, data, len);
+    if (Update.write((uint8_t*)data, len) == len) return true;
+    snprintf(g_error, sizeof(g_error), "Write error: %s", Update.errorString());
+    return false;
+}
+
+static bool firmware_finish(void*, bool ok) {
+    uint8_t sum[32];
+    mbedtls_sha256_finish(&g_sha, sum);
+    mbedtls_sha256_free(&g_sha);
+    for (int i = 0; i < 32; i++) snprintf(g_digest + i * 2, 3, "%02x", sum[i]);
+
+    if (!ok) {
+        Update.abort();
+        return false;
+    }
+    if (g_expected[0] && strcmp(g_expected, g_digest) != 0) {
+        Update.abort();
+        snprintf(g_error, sizeof(g_error), "SHA-256 mismatch");
+        return false;
+    }
+    // Checks the image and switches the boot partition
+    if (!Update.end(true)) {
+        snprintf(g_error, sizeof(g_error), "Update end failed: %s", Update.errorString());
+        return false;
+    }
+    return true;
+}
+
+UploadResult firmware_start(size_t size, const char* sha256, AsyncClient* client, uint32_t* id) {
+    *id = 0;
+    g_digest[0] = '\0';
+    g_error[0] = '\0';
+
+    g_expected[0] = '\0';
+    if (sha256 && *sha256) {
+        bool valid = strlen(sha256) == 64;
+        for (size_t i = 0; valid && i < 64; i++) valid = isxdigit((unsigned char)sha256[i]);
+        if (!valid) {
+            snprintf(g_error, sizeof(g_error), "sha256 must be 64 hex digits");
+            return UPLOAD_INVALID;
+        }
+        for (size_t i = 0; i <= 64; i++) g_expected[i] = tolower((unsigned char)sha256[i]);
+    }
+
+    const esp_partition_t* part = esp_ota_get_next_update_partition(NULL);
+    if (!part) {
+        snprintf(g_error, sizeof(g_error), "No OTA partition");
+        return UPLOAD_FAILED;
+    }
+    if (size > part->size + FIRMWARE_FORM_SLACK) {
+        snprintf(g_error, sizeof(g_error), "Image too large: %u KB, partition %u KB",
+                 (unsigned)(size / 1024), (unsigned)(part->size / 1024));
+        return UPLOAD_INVALID;
+    }
+
+    // Multipart: the image size is only known once it is complete
+    if (!Update.begin(UPDATE_SIZE_UNKNOWN)) {
+        snprintf(g_error, sizeof(g_error), "Cannot begin update: %s", Update.errorString());
+        return UPLOAD_FAILED;
+    }
+    mbedtls_sha256_init(&g_sha);
+    mbedtls_sha256_starts(&g_sha, 0);
+    *id = upload_start(firmware_sink, firmware_finish, nullptr, client);
+    if (!*id) {
+        mbedtls_sha256_free(&g_sha);
+        Update.abort();
+        snprintf(g_error, sizeof(g_error), "Another upload is in progress");
+        return UPLOAD_BUSY;
+    }
+    return UPLOAD_OK;
+}
+
+const char* firmware_sha256() {
+    return g_digest;
+}
+
+const char* firmware_error() {
+    return g_error[0] ? g_error : upload_error();
+}
@@ -0,0 +1,29 @@
+#ifndef FIRMWARE_H
+#define FIRMWARE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "upload.h"
+
+// ==========================================
+// WEB FIRMWARE UPDATE
+// ==========================================
+// /api/update streams the image through the buffered upload pipeline
+// (upload.h): the writer task hands it to Update in 4 KB blocks while the
+// TCP window throttles the browser, and a SHA-256 of the image is computed
+// on the way. Update.end() runs when the upload ends, so the result is
+// known before the reply; the caller restarts afterwards.
+
+#define FIRMWARE_FORM_SLACK 4096 // multipart overhead allowed over the partition size
+
+// `size`: the request's content length, checked against the OTA partition.
+// `sha256`: 64 hex digits the image must hash to, or null.
+UploadResult firmware_start(size_t size, const char* sha256, AsyncClient* client, uint32_t* id);
+
+// After upload_end(): digest of the image, lowercase hex ("" before the end)
+const char* firmware_sha256();
+
+// Why the last update failed
+const char* firmware_error();
+
+#endif // FIRMWARE_H
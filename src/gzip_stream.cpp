@@ -0,0 +1,153 @@
+#include "gzip_stream.h"
+#include "crc32.h"
+#include <stdlib.h>
+#include <string.h>
+#if defined(ESP_PLATFORM)
+#include <esp_heap_caps.h>
+#endif
+
+#define GZIP_HASH_SIZE (1u << GZIP_HASH_BITS)
+#define MIN_MATCH 3
+#define MAX_MATCH 258
+#define MAX_DIST  32768
+
+struct GzipStream {
+    uint8_t window[GZIP_WINDOW];   // last bytes written, by absolute position & (GZIP_WINDOW - 1)
+    uint32_t head[GZIP_HASH_SIZE]; // latest absolute position + 1 per 3-byte hash, 0: none
+    uint32_t pos;                  // absolute position of the next input byte
+    uint32_t crc;
+    uint32_t bits;
+    uint8_t bit_count;
+    bool started;
+};
+
+static const uint16_t LEN_BASE[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                                      35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+static const uint8_t LEN_EXTRA[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+                                      3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+static const uint16_t DIST_BASE[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+                                       257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+static const uint8_t DIST_EXTRA[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+                                       7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+GzipStream* gzip_create() {
+    GzipStream* z = nullptr;
+#if defined(ESP_PLATFORM)
+    z = (GzipStream*)heap_caps_malloc(sizeof(GzipStream), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+#endif
+    if (!z) z = (GzipStream*)malloc(sizeof(GzipStream));
+    if (z) memset(z, 0, sizeof(GzipStream));
+    return z;
+}
+
+void gzip_destroy(GzipStream* z) {
+    free(z); // heap_caps_malloc() memory is freed by free() too
+}
+
+void gzip_reset(GzipStream* z) {
+    memset(z, 0, sizeof(GzipStream));
+}
+
+// Deflate packs bits LSB first
+static void put_bits(GzipStream* z, uint8_t* out, size_t& o, uint32_t value, uint8_t n) {
+    z->bits |= value << z->bit_count;
+    z->bit_count += n;
+    while (z->bit_count >= 8) {
+        out[o++] = (uint8_t)z->bits;
+        z->bits >>= 8;
+        z->bit_count -= 8;
+    }
+}
+
+// Huffman codes are defined MSB first
+static void put_code(GzipStream* z, uint8_t* out, size_t& o, uint32_t code, uint8_t n) {
+    uint32_t rev = 0;
+    for (uint8_t i = 0; i < n; i++) rev |= ((code >> i) & 1) << (n - 1 - i);
+    put_bits(z, out, o, rev, n);
+}
+
+// Fixed literal/length code (RFC 1951 3.2.6)
+static void put_symbol(GzipStream* z, uint8_t* out, size_t& o, uint16_t sym) {
+    if (sym < 144)      put_code(z, out, o, 0x30 + sym, 8);
+    else if (sym < 256) put_code(z, out, o, 0x190 + (sym - 144), 9);
+    else if (sym < 280) put_code(z, out, o, sym - 256, 7);
+    else                put_code(z, out, o, 0xC0 + (sym - 280), 8);
+}
+
+static void put_match(GzipStream* z, uint8_t* out, size_t& o, uint16_t len, uint16_t dist) {
+    uint8_t l = 28;
+    while (LEN_BASE[l] > len) l--;
+    put_symbol(z, out, o, 257 + l);
+    if (LEN_EXTRA[l]) put_bits(z, out, o, len - LEN_BASE[l], LEN_EXTRA[l]);
+    uint8_t d = 29;
+    while (DIST_BASE[d] > dist) d--;
+    put_code(z, out, o, d, 5);
+    if (DIST_EXTRA[d]) put_bits(z, out, o, dist - DIST_BASE[d], DIST_EXTRA[d]);
+}
+
+static inline uint32_t hash3(const uint8_t* p) {
+    uint32_t v = ((uint32_t)p[0] << 16) | ((uint32_t)p[1] << 8) | p[2];
+    return (v * 2654435761u) >> (32 - GZIP_HASH_BITS);
+}
+
+size_t gzip_write(GzipStream* z, const void* data, size_t len, uint8_t* out) {
+    const uint8_t* d = (const uint8_t*)data;
+    size_t o = 0;
+    if (!z->started) {
+        static const uint8_t header[10] = {0x1f, 0x8b, 8, 0, 0, 0, 0, 0, 0, 0xff}; // deflate, no name/time, OS unknown
+        memcpy(out, header, sizeof(header));
+        o = sizeof(header);
+        put_bits(z, out, o, 1, 1); // BFINAL: the only block
+        put_bits(z, out, o, 1, 2); // BTYPE 01: fixed Huffman
+        z->started = true;
+    }
+
+    const uint32_t base = z->pos;
+    // Byte at absolute position `a`: from this input, or from the window before it
+    auto at = [&](uint32_t a) -> uint8_t { return a >= base ? d[a - base] : z->window[a & (GZIP_WINDOW - 1)]; };
+
+    size_t i = 0;
+    while (i < len) {
+        uint16_t best = 0;
+        uint32_t dist = 0;
+        if (i + MIN_MATCH <= len) {
+            uint32_t h = hash3(d + i);
+            uint32_t cand = z->head[h];
+            z->head[h] = base + i + 1;
+            if (cand) {
+                uint32_t q = cand - 1;
+                dist = base + i - q;
+                bool in_window = q >= base || base - q <= GZIP_WINDOW;
+                if (dist > 0 && dist <= MAX_DIST && in_window) {
+                    size_t limit = len - i < MAX_MATCH ? len - i : MAX_MATCH;
+                    while (best < limit && at(q + best) == d[i + best]) best++;
+                }
+            }
+        }
+        if (best >= MIN_MATCH) {
+            put_match(z, out, o, best, (uint16_t)dist);
+            // Later data can match inside this one too
+            for (size_t k = i + 1; k < i + best && k + MIN_MATCH <= len; k++) z->head[hash3(d + k)] = base + k + 1;
+            i += best;
+        } else {
+            put_symbol(z, out, o, d[i]);
+            i++;
+        }
+    }
+
+    size_t keep = len < GZIP_WINDOW ? len : GZIP_WINDOW;
+    for (size_t k = len - keep; k < len; k++) z->window[(base + k) & (GZIP_WINDOW - 1)] = d[k];
+    z->pos += len;
+    z->crc = crc32_update(z->crc, d, len);
+    return o;
+}
+
+size_t gzip_finish(GzipStream* z, uint8_t* out) {
+    size_t o = 0;
+    if (!z->started) o = gzip_write(z, "", 0, out);
+    put_symbol(z, out, o, 256); // End of block
+    if (z->bit_count) put_bits(z, out, o, 0, 8 - z->bit_count);
+    for (int i = 0; i < 4; i++) out[o++] = (uint8_t)(z->crc >> (8 * i));
+    for (int i = 0; i < 4; i++) out[o++] = (uint8_t)(z->pos >> (8 * i));
+    return o;
+}
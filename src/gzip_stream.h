@@ -0,0 +1,41 @@
+#ifndef GZIP_STREAM_H
+#define GZIP_STREAM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ==========================================
+// STREAMING GZIP COMPRESSOR
+// ==========================================
+// Small gzip writer for responses generated piece by piece: one deflate
+// block with the fixed Huffman codes, greedy LZ77 matches against the last
+// GZIP_WINDOW bytes through a single-entry hash table. Far from zlib's ratio
+// but needs ~12 KB and no tables to transmit; a default /api/config page
+// (5 KB of JSON) comes out under 300 bytes.
+//
+// Each gzip_write() compresses its input completely (matches never wait for
+// more data), so output can be sent as soon as it is produced.
+
+#define GZIP_WINDOW    4096 // power of two
+#define GZIP_HASH_BITS 11
+
+// Worst case output of gzip_write() for `len` input bytes (header included)
+#define GZIP_BOUND(len) ((len) + (len) / 8 + 24)
+#define GZIP_TRAILER_MAX 24 // includes the header if nothing was written
+
+struct GzipStream;
+
+// Allocated in PSRAM when available; nullptr if out of memory
+GzipStream* gzip_create();
+void gzip_destroy(GzipStream* z);
+
+// Starts a new, independent gzip stream in the same memory
+void gzip_reset(GzipStream* z);
+
+// Compresses `len` bytes into `out` (GZIP_BOUND(len) bytes), returns bytes written
+size_t gzip_write(GzipStream* z, const void* data, size_t len, uint8_t* out);
+
+// Ends the stream (end of block, CRC, size) into `out` (GZIP_TRAILER_MAX bytes)
+size_t gzip_finish(GzipStream* z, uint8_t* out);
+
+#endif // GZIP_STREAM_H
@@ -0,0 +1,316 @@
+#include "icon_atlas.h"
+#include "crc32.h"
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <esp_heap_caps.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <lvgl.h>
+#include <src/draw/lv_image_decoder_private.h> // lv_image_decoder_dsc_t layout
+#include <vector>
+#include <string>
+#include <algorithm>
+
+#define ICON_ATLAS_NAME_LEN 32
+
+struct AtlasFileHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t count;
+    uint32_t key;
+    uint16_t width;
+    uint16_t height;
+};
+
+struct AtlasSlot {
+    char name[ICON_ATLAS_NAME_LEN];
+    uint16_t x, y, w, h;
+    uint16_t flags;      // lv_image_header_t flags of the decoded source (premultiplied...)
+    uint16_t reserved;
+};
+
+static uint8_t* g_pixels = nullptr;     // ARGB8888, ICON_ATLAS_WIDTH * g_height
+static uint16_t g_height = 0;
+static AtlasSlot* g_slots = nullptr;
+static lv_image_dsc_t* g_dscs = nullptr;
+static uint16_t g_count = 0;
+static uint32_t g_key = 0;
+static volatile bool g_stale = false; // g_pixels and the cache file may predate a file change
+static volatile uint32_t g_generation = 0; // icon_atlas_invalidate() calls
+static volatile bool g_writing = false;    // a cache write is in flight
+
+static const uint32_t ATLAS_STRIDE = ICON_ATLAS_WIDTH * 4;
+
+void icon_atlas_clear() {
+    // Descriptors may still be referenced by the image cache
+    for (uint16_t i = 0; i < g_count; i++) lv_image_cache_drop(&g_dscs[i]);
+    heap_caps_free(g_pixels);
+    free(g_slots);
+    free(g_dscs);
+    g_pixels = nullptr;
+    g_slots = nullptr;
+    g_dscs = nullptr;
+    g_count = 0;
+    g_height = 0;
+    g_key = 0;
+}
+
+static void publish() {
+    g_dscs = (lv_image_dsc_t*)calloc(g_count ? g_count : 1, sizeof(lv_image_dsc_t));
+    for (uint16_t i = 0; g_dscs && i < g_count; i++) {
+        const AtlasSlot& s = g_slots[i];
+        lv_image_dsc_t& d = g_dscs[i];
+        d.header.magic = LV_IMAGE_HEADER_MAGIC;
+        d.header.cf = LV_COLOR_FORMAT_ARGB8888;
+        // Never ALLOCATED/MODIFIABLE: LVGL does not own this memory (caches of older builds kept them)
+        d.header.flags = s.flags & LV_IMAGE_FLAGS_PREMULTIPLIED;
+        d.header.w = s.w;
+        d.header.h = s.h;
+        d.header.stride = ATLAS_STRIDE; // sub-rectangle: rows are atlas rows
+        d.data = g_pixels + (uint32_t)s.y * ATLAS_STRIDE + (uint32_t)s.x * 4;
+        d.data_size = (uint32_t)(s.h - 1) * ATLAS_STRIDE + (uint32_t)s.w * 4;
+    }
+}
+
+// Converts one decoded row segment into ARGB8888 (B, G, R, A byte order)
+static bool blit_row(uint8_t* dst, const lv_draw_buf_t* src, uint32_t sx, uint32_t sy, uint32_t w) {
+    const lv_image_header_t& h = src->header;
+    const uint8_t* row = src->data + sy * h.stride;
+    switch (h.cf) {
+        case LV_COLOR_FORMAT_ARGB8888:
+            memcpy(dst, row + sx * 4, w * 4);
+            return true;
+        case LV_COLOR_FORMAT_XRGB8888:
+            for (uint32_t i = 0; i < w; i++) {
+                memcpy(dst + i * 4, row + (sx + i) * 4, 3);
+                dst[i * 4 + 3] = 0xFF;
+            }
+            return true;
+        case LV_COLOR_FORMAT_RGB888:
+            for (uint32_t i = 0; i < w; i++) {
+                memcpy(dst + i * 4, row + (sx + i) * 3, 3);
+                dst[i * 4 + 3] = 0xFF;
+            }
+            return true;
+        case LV_COLOR_FORMAT_RGB565:
+        case LV_COLOR_FORMAT_RGB565A8: {
+            const uint16_t* px = (const uint16_t*)row + sx;
+            // RGB565A8: alpha plane follows the color plane, half the stride
+            const uint8_t* alpha = (h.cf == LV_COLOR_FORMAT_RGB565A8)
+                ? src->data + h.stride * h.h + sy * (h.stride / 2) + sx : nullptr;
+            for (uint32_t i = 0; i < w; i++) {
+                uint16_t c = px[i];
+                dst[i * 4 + 0] = (uint8_t)((c & 0x1F) << 3);
+                dst[i * 4 + 1] = (uint8_t)(((c >> 5) & 0x3F) << 2);
+                dst[i * 4 + 2] = (uint8_t)(((c >> 11) & 0x1F) << 3);
+                dst[i * 4 + 3] = alpha ? alpha[i] : 0xFF;
+            }
+            return true;
+        }
+        default:
+            return false;
+    }
+}
+
+static uint32_t compute_key(const std::vector<std::string>& names) {
+    uint32_t key = 0;
+    for (const std::string& n : names) {
+        File f = LittleFS.open(n.c_str(), "r");
+        uint32_t size = f ? (uint32_t)f.size() : 0;
+        if (f) f.close();
+        key = crc32_update(key, n.c_str(), n.size() + 1);
+        key = crc32_update(key, &size, sizeof(size));
+    }
+    return key;
+}
+
+static bool load_cache(uint32_t key) {
+    File f = LittleFS.open(ICON_ATLAS_FILE, "r");
+    if (!f) return false;
+
+    AtlasFileHeader hdr;
+    bool ok = f.read((uint8_t*)&hdr, sizeof(hdr)) == sizeof(hdr) &&
+              hdr.magic == ICON_ATLAS_MAGIC && hdr.version == ICON_ATLAS_VERSION &&
+              hdr.key == key && hdr.width == ICON_ATLAS_WIDTH;
+    if (ok) {
+        size_t px_size = (size_t)ATLAS_STRIDE * hdr.height;
+        g_slots = (AtlasSlot*)calloc(hdr.count ? hdr.count : 1, sizeof(AtlasSlot));
+        g_pixels = (uint8_t*)heap_caps_malloc(px_size ? px_size : 4, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        ok = g_slots && g_pixels &&
+             f.read((uint8_t*)g_slots, hdr.count * sizeof(AtlasSlot)) == hdr.count * sizeof(AtlasSlot) &&
+             f.read(g_pixels, px_size) == px_size;
+        if (ok) {
+            g_count = hdr.count;
+            g_height = hdr.height;
+            g_key = key;
+        }
+    }
+    f.close();
+    if (!ok) icon_atlas_clear();
+    return ok;
+}
+
+struct AtlasWrite {
+    AtlasFileHeader header;
+    uint8_t* payload; // slots, then pixels: a copy, the atlas may be cleared meanwhile
+    size_t len;
+    uint32_t generation;
+};
+
+static void write_task(void* arg) {
+    AtlasWrite* job = (AtlasWrite*)arg;
+    uint32_t t0 = millis();
+    File f = LittleFS.open(ICON_ATLAS_TMP_FILE, "w");
+    bool ok = f && f.write((const uint8_t*)&job->header, sizeof(job->header)) == sizeof(job->header) &&
+              f.write(job->payload, job->len) == job->len;
+    if (f) f.close();
+    // A file changed while it was written: the next sync rebuilds anyway
+    ok = ok && job->generation == g_generation && LittleFS.rename(ICON_ATLAS_TMP_FILE, ICON_ATLAS_FILE);
+    if (ok) Serial.printf("ATLAS: cache saved (%u KB) in %lu ms\n", (unsigned)(job->len / 1024), millis() - t0);
+    else LittleFS.remove(ICON_ATLAS_TMP_FILE);
+    heap_caps_free(job->payload);
+    delete job;
+    g_writing = false;
+    vTaskDelete(NULL);
+}
+
+// Hands a copy to a one-shot task: the file is hundreds of KB and this runs on the LVGL thread
+static void save_cache() {
+    if (g_writing) return; // This atlas is rebuilt on the next boot instead
+    size_t slots = g_count * sizeof(AtlasSlot);
+    size_t len = slots + (size_t)ATLAS_STRIDE * g_height;
+    AtlasWrite* job = new AtlasWrite();
+    job->header = { ICON_ATLAS_MAGIC, ICON_ATLAS_VERSION, g_count, g_key, ICON_ATLAS_WIDTH, g_height };
+    job->payload = (uint8_t*)heap_caps_malloc(len ? len : 4, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    job->len = len;
+    job->generation = g_generation;
+    if (!job->payload) {
+        delete job;
+        return;
+    }
+    memcpy(job->payload, g_slots, slots);
+    memcpy(job->payload + slots, g_pixels, len - slots);
+    g_writing = true;
+    if (xTaskCreate(write_task, "atlas", 4096, job, 1, NULL) != pdPASS) {
+        g_writing = false;
+        heap_caps_free(job->payload);
+        delete job;
+    }
+}
+
+static bool rebuild(const std::vector<std::string>& names, uint32_t key) {
+    // Pass 1: headers only, shelf-pack the (cropped) sizes tallest first
+    struct Item { std::string name; uint16_t w, h, sw, sh; };
+    std::vector<Item> items;
+    for (const std::string& n : names) {
+        std::string src = "L:" + n;
+        lv_image_header_t info;
+        if (lv_image_decoder_get_info(src.c_str(), &info) != LV_RESULT_OK) continue;
+        if (info.w == 0 || info.h == 0) continue;
+        items.push_back({ n, (uint16_t)std::min<uint32_t>(info.w, ICON_ATLAS_MAX_DIM),
+                          (uint16_t)std::min<uint32_t>(info.h, ICON_ATLAS_MAX_DIM),
+                          (uint16_t)info.w, (uint16_t)info.h });
+    }
+    std::sort(items.begin(), items.end(), [](const Item& a, const Item& b) { return a.h > b.h; });
+
+    g_slots = (AtlasSlot*)calloc(items.size() ? items.size() : 1, sizeof(AtlasSlot));
+    if (!g_slots) return false;
+    uint16_t x = 0, y = 0, shelf_h = 0;
+    for (size_t i = 0; i < items.size(); i++) {
+        if (x + items[i].w > ICON_ATLAS_WIDTH) { y += shelf_h; x = 0; shelf_h = 0; }
+        AtlasSlot& s = g_slots[i];
+        strncpy(s.name, items[i].name.c_str(), ICON_ATLAS_NAME_LEN - 1);
+        s.x = x; s.y = y; s.w = items[i].w; s.h = items[i].h;
+        x += s.w;
+        shelf_h = std::max(shelf_h, s.h);
+    }
+    g_height = y + shelf_h;
+
+    size_t px_size = (size_t)ATLAS_STRIDE * g_height;
+    g_pixels = (uint8_t*)heap_caps_calloc(1, px_size ? px_size : 4, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!g_pixels) return false;
+
+    // Pass 2: decode each image once and copy its centered crop into the atlas
+    uint16_t kept = 0;
+    for (size_t i = 0; i < items.size(); i++) {
+        AtlasSlot s = g_slots[i];
+        std::string src = "L:" + items[i].name;
+        lv_image_decoder_dsc_t dsc;
+        bool ok = false;
+        if (lv_image_decoder_open(&dsc, src.c_str(), NULL) == LV_RESULT_OK) {
+            const lv_draw_buf_t* db = dsc.decoded;
+            if (db && db->data) {
+                uint32_t sx = (items[i].sw - s.w) / 2;
+                uint32_t sy = (items[i].sh - s.h) / 2;
+                ok = true;
+                for (uint16_t r = 0; r < s.h && ok; r++) {
+                    uint8_t* dst = g_pixels + (uint32_t)(s.y + r) * ATLAS_STRIDE + (uint32_t)s.x * 4;
+                    ok = blit_row(dst, db, sx, sy + r, s.w);
+                }
+                s.flags = db->header.flags & LV_IMAGE_FLAGS_PREMULTIPLIED;
+            }
+            lv_image_decoder_close(&dsc);
+        }
+        // Undecodable (or tiled JPG) images stay on the per-file path
+        if (ok) g_slots[kept++] = s;
+    }
+    g_count = kept;
+    g_key = key;
+    save_cache();
+    return true;
+}
+
+bool icon_atlas_sync(const char* const* paths, size_t count) {
+    std::vector<std::string> names;
+    for (size_t i = 0; i < count; i++) {
+        if (!paths[i] || paths[i][0] != '/') continue;
+        if (strlen(paths[i]) >= ICON_ATLAS_NAME_LEN) continue;
+        names.push_back(paths[i]);
+    }
+    std::sort(names.begin(), names.end());
+    names.erase(std::unique(names.begin(), names.end()), names.end());
+
+    // Cleared before the files are read: a change during the rebuild sets it again
+    bool stale = g_stale;
+    g_stale = false;
+    uint32_t key = compute_key(names);
+    if (g_pixels && key == g_key && !stale) return true;
+
+    icon_atlas_clear();
+    if (names.empty()) return true;
+
+    uint32_t t0 = millis();
+    bool ok = !stale && load_cache(key);
+    if (!ok) {
+        ok = rebuild(names, key);
+        if (!ok) icon_atlas_clear();
+    }
+    if (ok) {
+        publish();
+        Serial.printf("ATLAS: %u icons, %ux%u px (%u KB) in %lu ms\n", g_count, ICON_ATLAS_WIDTH, g_height,
+                      (unsigned)(icon_atlas_bytes() / 1024), millis() - t0);
+    }
+    return ok;
+}
+
+void icon_atlas_invalidate() {
+    g_generation++;
+    g_stale = true;
+    if (LittleFS.exists(ICON_ATLAS_FILE)) LittleFS.remove(ICON_ATLAS_FILE);
+}
+
+const void* icon_atlas_image(const char* path) {
+    if (!g_dscs || !path) return nullptr;
+    for (uint16_t i = 0; i < g_count; i++) {
+        if (strncmp(g_slots[i].name, path, ICON_ATLAS_NAME_LEN) == 0) return &g_dscs[i];
+    }
+    return nullptr;
+}
+
+uint16_t icon_atlas_count() {
+    return g_count;
+}
+
+size_t icon_atlas_bytes() {
+    return (size_t)ATLAS_STRIDE * g_height;
+}
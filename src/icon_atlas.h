@@ -0,0 +1,46 @@
+#ifndef ICON_ATLAS_H
+#define ICON_ATLAS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ==========================================
+// ICON ATLAS
+// ==========================================
+// All images referenced by the active profile, decoded once into a single
+// ARGB8888 buffer in PSRAM. Each button image is an lv_image_dsc_t that
+// points at its sub-rectangle of the atlas (data offset + atlas stride), so
+// a grid rebuild touches one allocation instead of one per button.
+//
+// The atlas is cached in LittleFS (ICON_ATLAS_FILE) and keyed by the list of
+// source paths and their sizes; a boot with an unchanged profile is a single
+// sequential read instead of one open + decode per icon. A rebuilt atlas is
+// written to the cache by a background task. A file replaced by
+// one of the same size keeps that key, so whatever writes or deletes files
+// calls icon_atlas_invalidate().
+
+#define ICON_ATLAS_FILE     "/.atlas.bin"
+#define ICON_ATLAS_TMP_FILE "/.atlas.tmp" // written in the background, then renamed
+#define ICON_ATLAS_MAGIC    0x54414450u // "PDAT"
+#define ICON_ATLAS_VERSION  1
+#define ICON_ATLAS_WIDTH    512         // px; shelves are packed left to right
+#define ICON_ATLAS_MAX_DIM  64          // px; larger images are center-cropped like lv_image does
+
+// Loads the cached atlas if it matches `paths`, otherwise decodes every path
+// and writes a new cache. Paths that cannot be decoded are left out and keep
+// loading from LittleFS. Must run on the LVGL thread.
+bool icon_atlas_sync(const char* const* paths, size_t count);
+
+void icon_atlas_clear();
+
+// A file changed: drops the cache file and makes the next sync rebuild.
+// Safe from any task.
+void icon_atlas_invalidate();
+
+// LVGL image source for `path` inside the atlas, or nullptr
+const void* icon_atlas_image(const char* path);
+
+uint16_t icon_atlas_count();
+size_t icon_atlas_bytes();
+
+#endif // ICON_ATLAS_H
@@ -0,0 +1,129 @@
+#include "jobs.h"
+#include <Arduino.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+
+struct Job {
+    JobInfo info;
+    job_fn fn;
+    void* arg;
+};
+
+static Job g_jobs[JOB_HISTORY]; // by id % JOB_HISTORY
+static uint32_t g_next_id = 1;
+static uint32_t g_running = 0;
+static QueueHandle_t g_queue = nullptr; // ids
+static SemaphoreHandle_t g_lock = nullptr;
+static TaskHandle_t g_task = nullptr;
+
+static void lock() {
+    xSemaphoreTake(g_lock, portMAX_DELAY);
+}
+
+static void unlock() {
+    xSemaphoreGive(g_lock);
+}
+
+static Job& slot(uint32_t id) {
+    return g_jobs[id % JOB_HISTORY];
+}
+
+static void job_task(void*) {
+    for (;;) {
+        uint32_t id;
+        if (xQueueReceive(g_queue, &id, portMAX_DELAY) != pdTRUE) continue;
+        lock();
+        Job& j = slot(id);
+        job_fn fn = j.fn;
+        void* arg = j.arg;
+        j.info.state = JOB_RUNNING;
+        j.info.started_us = esp_timer_get_time();
+        g_running = id;
+        unlock();
+
+        char result[JOB_RESULT_LEN] = "";
+        bool ok = fn(arg, result, sizeof(result));
+
+        lock();
+        j.info.state = ok ? JOB_DONE : JOB_FAILED;
+        if (ok) j.info.progress = 100;
+        memcpy(j.info.result, result, sizeof(result));
+        j.info.finished_us = esp_timer_get_time();
+        g_running = 0;
+        JobInfo done = j.info;
+        unlock();
+        Serial.printf("JOB: #%u %s %s in %u ms (queued %u ms)%s%s\n", (unsigned)done.id, done.name,
+                      ok ? "done" : "failed", (unsigned)((done.finished_us - done.started_us) / 1000),
+                      (unsigned)((done.started_us - done.queued_us) / 1000), result[0] ? ": " : "", result);
+    }
+}
+
+void jobs_begin() {
+    if (!g_lock) g_lock = xSemaphoreCreateMutex();
+    if (!g_queue) g_queue = xQueueCreate(JOB_HISTORY, sizeof(uint32_t));
+    // Restores reload every profile: deck parsing wants some stack
+    if (!g_task) xTaskCreate(job_task, "jobs", 8192, NULL, 1, &g_task);
+}
+
+uint32_t job_submit(const char* name, job_fn fn, void* arg) {
+    if (!g_task) return 0;
+    lock();
+    uint32_t id = g_next_id;
+    Job& j = slot(id);
+    if (j.info.id && (j.info.state == JOB_QUEUED || j.info.state == JOB_RUNNING)) {
+        unlock();
+        return 0;
+    }
+    g_next_id++;
+    memset(&j, 0, sizeof(j));
+    j.info.id = id;
+    strncpy(j.info.name, name, sizeof(j.info.name) - 1);
+    j.info.state = JOB_QUEUED;
+    j.info.queued_us = esp_timer_get_time();
+    j.fn = fn;
+    j.arg = arg;
+    unlock();
+    // Cannot be full: it holds at most the JOB_HISTORY pending ids
+    xQueueSend(g_queue, &id, 0);
+    return id;
+}
+
+void job_progress(uint8_t percent) {
+    lock();
+    if (g_running) slot(g_running).info.progress = percent > 100 ? 100 : percent;
+    unlock();
+}
+
+bool job_get(uint32_t id, JobInfo& out) {
+    if (!g_lock || !id) return false;
+    lock();
+    const Job& j = slot(id);
+    bool found = j.info.id == id;
+    if (found) out = j.info;
+    unlock();
+    return found;
+}
+
+size_t job_list(JobInfo* out, size_t max) {
+    if (!g_lock) return 0;
+    size_t n = 0;
+    lock();
+    uint32_t first = g_next_id > JOB_HISTORY ? g_next_id - JOB_HISTORY : 1;
+    for (uint32_t id = first; id < g_next_id && n < max; id++) {
+        if (slot(id).info.id == id) out[n++] = slot(id).info;
+    }
+    unlock();
+    return n;
+}
+
+const char* job_state_name(JobState s) {
+    switch (s) {
+        case JOB_QUEUED:  return "queued";
+        case JOB_RUNNING: return "running";
+        case JOB_DONE:    return "done";
+        default:          return "failed";
+    }
+}
@@ -0,0 +1,58 @@
+#ifndef JOBS_H
+#define JOBS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ==========================================
+// BACKGROUND JOBS
+// ==========================================
+// Work a web request starts that is too slow for, or must not run on, the
+// web server's task: committing a restore (renames, then waiting for loop()
+// to reload the profiles, since only it may touch what the grid shows),
+// adding or deleting a profile. The handler queues a job
+// and answers 202 with its id; one worker task runs the jobs in order, and
+// GET /api/jobs reports their state, progress, result and timing. The last
+// JOB_HISTORY jobs are remembered; a job still queued or running is never
+// overwritten, so at most JOB_HISTORY can be pending.
+
+#define JOB_HISTORY    8
+#define JOB_NAME_LEN   16
+#define JOB_RESULT_LEN 96
+
+enum JobState : uint8_t { JOB_QUEUED, JOB_RUNNING, JOB_DONE, JOB_FAILED };
+
+struct JobInfo {
+    uint32_t id;              // 0: unused
+    char name[JOB_NAME_LEN];
+    JobState state;
+    uint8_t progress;         // percent, set by the job
+    char result[JOB_RESULT_LEN];
+    int64_t queued_us;        // esp_timer_get_time()
+    int64_t started_us;       // 0 while queued
+    int64_t finished_us;      // 0 until done
+};
+
+// Runs on the job task. Writes a short message into `result` (the error
+// when it fails) and owns `arg`.
+typedef bool (*job_fn)(void* arg, char* result, size_t result_len);
+
+// Starts the worker task
+void jobs_begin();
+
+// Queues `fn(arg)`; returns the job id, 0 if JOB_HISTORY jobs are pending
+// (then `arg` is still the caller's)
+uint32_t job_submit(const char* name, job_fn fn, void* arg);
+
+// Progress of the running job, from inside it
+void job_progress(uint8_t percent);
+
+// false if `id` is unknown or already forgotten
+bool job_get(uint32_t id, JobInfo& out);
+
+// Remembered jobs, oldest first; returns how many were written
+size_t job_list(JobInfo* out, size_t max);
+
+const char* job_state_name(JobState s);
+
+#endif // JOBS_H
@@ -0,0 +1,197 @@
+#include "json_reader.h"
+#include <stdlib.h>
+#include <string.h>
+
+static bool is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+bool JsonReader::fail(const char* msg) {
+    if (state_ != ST_ERROR) error_ = msg;
+    state_ = ST_ERROR;
+    return false;
+}
+
+// Keys are kept whole in buf_ (cut when too long); values are flushed when it fills
+bool JsonReader::append(char c) {
+    size_t cap = in_key_ ? JSON_READER_KEY - 1 : sizeof(buf_);
+    if (len_ == cap) {
+        if (in_key_) return true;
+        if (!h_.on_string(buf_, len_, false)) return fail("rejected");
+        len_ = 0;
+    }
+    buf_[len_++] = c;
+    return true;
+}
+
+bool JsonReader::append_utf8(uint32_t cp) {
+    if (cp < 0x80) return append((char)cp);
+    if (cp < 0x800) return append((char)(0xC0 | (cp >> 6))) && append((char)(0x80 | (cp & 0x3F)));
+    if (cp < 0x10000) {
+        return append((char)(0xE0 | (cp >> 12))) && append((char)(0x80 | ((cp >> 6) & 0x3F))) &&
+               append((char)(0x80 | (cp & 0x3F)));
+    }
+    return append((char)(0xF0 | (cp >> 18))) && append((char)(0x80 | ((cp >> 12) & 0x3F))) &&
+           append((char)(0x80 | ((cp >> 6) & 0x3F))) && append((char)(0x80 | (cp & 0x3F)));
+}
+
+bool JsonReader::value_done() {
+    state_ = depth_ == 0 ? ST_DONE : ST_AFTER;
+    return true;
+}
+
+bool JsonReader::close(bool array) {
+    if (depth_ == 0 || ((arrays_ >> depth_) & 1) != (array ? 1 : 0)) return fail("mismatched bracket");
+    depth_--;
+    if (!h_.on_end(array)) return fail("rejected");
+    return value_done();
+}
+
+bool JsonReader::end_number() {
+    buf_[len_] = 0;
+    char* end = nullptr;
+    double v = strtod(buf_, &end);
+    if (len_ == 0 || *end != 0) return fail("bad number");
+    if (!h_.on_number(v)) return fail("rejected");
+    return value_done();
+}
+
+bool JsonReader::begin_value(char c) {
+    if (c == '{' || c == '[') {
+        bool array = c == '[';
+        if (depth_ == JSON_READER_DEPTH - 1) return fail("nested too deep");
+        depth_++;
+        if (array) arrays_ |= 1u << depth_;
+        else arrays_ &= ~(1u << depth_);
+        if (!h_.on_begin(array)) return fail("rejected");
+        state_ = array ? ST_VALUE_OR_END : ST_KEY_OR_END;
+        return true;
+    }
+    if (c == '"') {
+        in_key_ = false;
+        len_ = 0;
+        state_ = ST_STRING;
+        return true;
+    }
+    if (c == '-' || (c >= '0' && c <= '9')) {
+        len_ = 0;
+        buf_[len_++] = c;
+        state_ = ST_NUMBER;
+        return true;
+    }
+    if (c == 't') literal_ = "true";
+    else if (c == 'f') literal_ = "false";
+    else if (c == 'n') literal_ = "null";
+    else return fail("unexpected character");
+    lit_pos_ = 1;
+    state_ = ST_LITERAL;
+    return true;
+}
+
+bool JsonReader::step(char c) {
+    switch (state_) {
+        case ST_VALUE_OR_END:
+            if (c == ']') return close(true);
+            // fall through
+        case ST_VALUE:
+            if (is_space(c)) return true;
+            return begin_value(c);
+        case ST_AFTER:
+            if (is_space(c)) return true;
+            if (c == ',') { state_ = ((arrays_ >> depth_) & 1) ? ST_VALUE : ST_KEY; return true; }
+            if (c == '}' || c == ']') return close(c == ']');
+            return fail("expected , or closing bracket");
+        case ST_KEY_OR_END:
+            if (c == '}') return close(false);
+            // fall through
+        case ST_KEY:
+            if (is_space(c)) return true;
+            if (c != '"') return fail("expected member name");
+            in_key_ = true;
+            len_ = 0;
+            state_ = ST_STRING;
+            return true;
+        case ST_COLON:
+            if (is_space(c)) return true;
+            if (c != ':') return fail("expected :");
+            state_ = ST_VALUE;
+            return true;
+        case ST_STRING:
+            if (c == '"') {
+                if (in_key_) {
+                    buf_[len_] = 0;
+                    if (!h_.on_key(buf_)) return fail("rejected");
+                    state_ = ST_COLON;
+                    return true;
+                }
+                if (!h_.on_string(buf_, len_, true)) return fail("rejected");
+                return value_done();
+            }
+            if (c == '\\') { state_ = ST_ESCAPE; return true; }
+            if ((unsigned char)c < 0x20) return fail("control character in string");
+            return append(c);
+        case ST_ESCAPE: {
+            state_ = ST_STRING;
+            switch (c) {
+                case '"': case '\\': case '/': return append(c);
+                case 'b': return append('\b');
+                case 'f': return append('\f');
+                case 'n': return append('\n');
+                case 'r': return append('\r');
+                case 't': return append('\t');
+                case 'u': unicode_ = 0; unicode_n_ = 0; state_ = ST_UNICODE; return true;
+            }
+            return fail("bad escape");
+        }
+        case ST_UNICODE: {
+            int d = (c >= '0' && c <= '9') ? c - '0' : (c >= 'a' && c <= 'f') ? c - 'a' + 10 : (c >= 'A' && c <= 'F') ? c - 'A' + 10 : -1;
+            if (d < 0) return fail("bad \\u escape");
+            unicode_ = (unicode_ << 4) | d;
+            if (++unicode_n_ < 4) return true;
+            state_ = ST_STRING;
+            if (unicode_ >= 0xD800 && unicode_ < 0xDC00) { high_ = unicode_; return true; }
+            if (unicode_ >= 0xDC00 && unicode_ < 0xE000 && high_) {
+                uint32_t cp = 0x10000 + ((uint32_t)(high_ - 0xD800) << 10) + (unicode_ - 0xDC00);
+                high_ = 0;
+                return append_utf8(cp);
+            }
+            high_ = 0;
+            return append_utf8(unicode_);
+        }
+        case ST_NUMBER:
+            if ((c >= '0' && c <= '9') || c == '.' || c == 'e' || c == 'E' || c == '+' || c == '-') {
+                if (len_ >= 31) return fail("number too long");
+                buf_[len_++] = c;
+                return true;
+            }
+            // The character after a number belongs to what follows
+            return end_number() && step(c);
+        case ST_LITERAL:
+            if (c != literal_[lit_pos_]) return fail("bad literal");
+            if (literal_[++lit_pos_]) return true;
+            if (!h_.on_literal(literal_[0])) return fail("rejected");
+            return value_done();
+        case ST_DONE:
+            if (is_space(c)) return true;
+            return fail("data after the end");
+        case ST_ERROR:
+            return false;
+    }
+    return false;
+}
+
+bool JsonReader::feed(const char* data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        if (state_ == ST_ERROR) return false;
+        offset_++;
+        if (!step(data[i])) return false;
+    }
+    return state_ != ST_ERROR;
+}
+
+bool JsonReader::finish() {
+    if (state_ == ST_NUMBER && depth_ == 0) end_number();
+    if (state_ == ST_ERROR) return false;
+    if (state_ != ST_DONE) return fail("unexpected end");
+    return true;
+}
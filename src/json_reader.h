@@ -0,0 +1,81 @@
+#ifndef JSON_READER_H
+#define JSON_READER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ==========================================
+// STREAMING JSON READER
+// ==========================================
+// Push parser, the reading side of JsonWriter: feed() takes the document in
+// pieces of any size (an HTTP body as it arrives) and reports what it finds
+// to a JsonHandler as it goes, so nothing but a few small fixed buffers is
+// held whatever the size of the document.
+//
+// Member names are passed whole (cut at JSON_READER_KEY - 1 bytes). String
+// values can be any length and arrive in pieces of up to JSON_READER_CHUNK
+// bytes, escapes already decoded; `done` marks the last one. A handler
+// returning false stops the parse (failed() then reports "rejected").
+
+#define JSON_READER_DEPTH 16
+#define JSON_READER_KEY   48
+#define JSON_READER_CHUNK 128
+
+class JsonHandler {
+public:
+    virtual ~JsonHandler() {}
+    // Containers and values inside an object follow the on_key() of their member
+    virtual bool on_begin(bool array) = 0;
+    virtual bool on_end(bool array) = 0;
+    virtual bool on_key(const char* key) = 0;
+    virtual bool on_string(const char* s, size_t n, bool done) = 0;
+    virtual bool on_number(double v) = 0;
+    virtual bool on_literal(char c) = 0; // 't', 'f' or 'n'
+};
+
+class JsonReader {
+public:
+    explicit JsonReader(JsonHandler& h) : h_(h) {}
+
+    // false once the input is invalid or the handler stopped; later calls do nothing
+    bool feed(const char* data, size_t len);
+    // true if the input was exactly one complete value
+    bool finish();
+
+    bool failed() const { return state_ == ST_ERROR; }
+    const char* error() const { return error_; }
+    size_t offset() const { return offset_; } // bytes consumed, the bad one included
+    uint8_t depth() const { return depth_; }
+
+private:
+    enum State : uint8_t {
+        ST_VALUE, ST_VALUE_OR_END, ST_AFTER, ST_KEY_OR_END, ST_KEY, ST_COLON,
+        ST_STRING, ST_ESCAPE, ST_UNICODE, ST_NUMBER, ST_LITERAL, ST_DONE, ST_ERROR
+    };
+
+    bool step(char c);
+    bool begin_value(char c);
+    bool value_done();
+    bool close(bool array);
+    bool end_number();
+    bool append(char c);
+    bool append_utf8(uint32_t cp);
+    bool fail(const char* msg);
+
+    JsonHandler& h_;
+    State state_ = ST_VALUE;
+    const char* error_ = nullptr;
+    size_t offset_ = 0;
+    uint8_t depth_ = 0;
+    uint16_t arrays_ = 0;     // bit per depth: the container is an array
+    bool in_key_ = false;
+    char buf_[JSON_READER_CHUNK];
+    size_t len_ = 0;
+    const char* literal_ = nullptr;
+    uint8_t lit_pos_ = 0;
+    uint32_t unicode_ = 0;
+    uint8_t unicode_n_ = 0;
+    uint16_t high_ = 0;       // pending high surrogate
+};
+
+#endif // JSON_READER_H
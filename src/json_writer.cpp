@@ -0,0 +1,124 @@
+#include "json_writer.h"
+#include <stdio.h>
+#include <string.h>
+
+void JsonWriter::put(char c) {
+    if (len_ < cap_) buf_[len_++] = c;
+    else overflow_ = true;
+}
+
+void JsonWriter::put(const char* s, size_t n) {
+    if (n > cap_ - len_) {
+        n = cap_ - len_;
+        overflow_ = true;
+    }
+    memcpy(buf_ + len_, s, n);
+    len_ += n;
+}
+
+void JsonWriter::quoted(const char* s) {
+    put('"');
+    // Runs of plain characters are copied at once
+    const char* run = s;
+    for (; *s; s++) {
+        unsigned char c = (unsigned char)*s;
+        if (c >= 0x20 && c != '"' && c != '\\') continue;
+        put(run, s - run);
+        run = s + 1;
+        switch (c) {
+            case '"':  put("\\\"", 2); break;
+            case '\\': put("\\\\", 2); break;
+            case '\n': put("\\n", 2); break;
+            case '\r': put("\\r", 2); break;
+            case '\t': put("\\t", 2); break;
+            default: {
+                char esc[7];
+                snprintf(esc, sizeof(esc), "\\u%04x", c);
+                put(esc, 6);
+            }
+        }
+    }
+    put(run, s - run);
+    put('"');
+}
+
+void JsonWriter::member(const char* key) {
+    uint16_t bit = 1u << depth_;
+    if (has_items_ & bit) put(',');
+    has_items_ |= bit;
+    if (key) {
+        quoted(key);
+        put(':');
+    }
+}
+
+JsonWriter& JsonWriter::begin_object(const char* key) {
+    if (depth_ > 0) member(key);
+    put('{');
+    if (depth_ < JSON_WRITER_DEPTH - 1) depth_++;
+    has_items_ &= ~(1u << depth_);
+    return *this;
+}
+
+JsonWriter& JsonWriter::end_object() {
+    if (depth_ > 0) depth_--;
+    put('}');
+    return *this;
+}
+
+JsonWriter& JsonWriter::begin_array(const char* key) {
+    if (depth_ > 0) member(key);
+    put('[');
+    if (depth_ < JSON_WRITER_DEPTH - 1) depth_++;
+    has_items_ &= ~(1u << depth_);
+    return *this;
+}
+
+JsonWriter& JsonWriter::end_array() {
+    if (depth_ > 0) depth_--;
+    put(']');
+    return *this;
+}
+
+JsonWriter& JsonWriter::str(const char* key, const char* value) {
+    member(key);
+    quoted(value ? value : "");
+    return *this;
+}
+
+JsonWriter& JsonWriter::num(const char* key, int32_t value) {
+    member(key);
+    char tmp[12];
+    put(tmp, snprintf(tmp, sizeof(tmp), "%ld", (long)value));
+    return *this;
+}
+
+JsonWriter& JsonWriter::hex(const char* key, uint32_t value) {
+    member(key);
+    char tmp[11];
+    put(tmp, snprintf(tmp, sizeof(tmp), "\"%lx\"", (unsigned long)value));
+    return *this;
+}
+
+JsonWriter& JsonWriter::boolean(const char* key, bool value) {
+    member(key);
+    if (value) put("true", 4);
+    else put("false", 5);
+    return *this;
+}
+
+JsonWriter& JsonWriter::begin_str(const char* key) {
+    member(key);
+    put('"');
+    return *this;
+}
+
+JsonWriter& JsonWriter::raw(const char* s, size_t n) {
+    put(s, n);
+    return *this;
+}
+
+JsonWriter& JsonWriter::end_str() {
+    put('"');
+    return *this;
+}
@@ -0,0 +1,60 @@
+#ifndef JSON_WRITER_H
+#define JSON_WRITER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ==========================================
+// STREAMING JSON WRITER
+// ==========================================
+// Writes JSON into a caller-provided fixed buffer: no String, no heap. A
+// large document is produced piece by piece: write a part, hand data()/size()
+// to the consumer, clear() and continue. clear() drops the text only; the
+// nesting and comma state carry over to the next part.
+//
+// `key` is the member name inside an object and nullptr for array elements.
+// A part that does not fit is cut short and overflowed() stays true.
+
+#define JSON_WRITER_DEPTH 16
+
+class JsonWriter {
+public:
+    JsonWriter(char* buf, size_t cap) : buf_(buf), cap_(cap) {}
+
+    void clear() { len_ = 0; }
+    const char* data() const { return buf_; }
+    size_t size() const { return len_; }
+    bool overflowed() const { return overflow_; }
+
+    JsonWriter& begin_object(const char* key = nullptr);
+    JsonWriter& end_object();
+    JsonWriter& begin_array(const char* key = nullptr);
+    JsonWriter& end_array();
+
+    JsonWriter& str(const char* key, const char* value);
+    JsonWriter& num(const char* key, int32_t value);
+    JsonWriter& hex(const char* key, uint32_t value); // quoted, lower case, no padding: "ff00"
+    JsonWriter& boolean(const char* key, bool value);
+
+    // A string value written in pieces: begin_str(), raw() as often as
+    // needed, end_str(). raw() copies as is; the caller keeps it valid JSON
+    // string content (base64, hex).
+    JsonWriter& begin_str(const char* key);
+    JsonWriter& raw(const char* s, size_t n);
+    JsonWriter& end_str();
+
+private:
+    void member(const char* key); // separator + "key":
+    void put(char c);
+    void put(const char* s, size_t n);
+    void quoted(const char* s);
+
+    char* buf_;
+    size_t cap_;
+    size_t len_ = 0;
+    bool overflow_ = false;
+    uint8_t depth_ = 0;
+    uint16_t has_items_ = 0; // bit per depth: the container already holds a value
+};
+
+#endif // JSON_WRITER_H
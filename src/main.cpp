@@ -1,19 +1,27 @@
 #include "pt/pt_display.h"
 #include "streamdeck.h"
+#include "boot.h"
 
 void setup()
 {
-  // Safety delay to allow USB to enumerate and Serial to connect
   pinMode(21, OUTPUT); digitalWrite(21, 0); 
-  delay(3000);
-  
-  // Enable Serial for debugging
+
+  boot_phase_start(BOOT_SERIAL);
   Serial.begin(115200);
-  delay(1000);
+#ifdef PANDA_DEBUG_BOOT
+  // Debug builds: give USB time to enumerate and a monitor time to attach
+  delay(3000);
+#endif
   Serial.println("\n\n=== PandaTouch StreamDeck Starting ===");
-  
-  pt_setup_display(PT_LVGL_RENDER_FULL_1);
+  boot_phase_end(BOOT_SERIAL);
+
+  StreamDeckApp::early_setup();
+
+  boot_phase_start(BOOT_PANEL);
+  pt_setup_display(PT_LVGL_RENDER_FULL_1, StreamDeckApp::draw_splash);
   pt_set_backlight(50, true);
+  boot_phase_end(BOOT_PANEL);
+
   StreamDeckApp::setup();
 }
 
@@ -21,8 +29,12 @@ void set_brightness(uint8_t val) {
   pt_set_backlight(val, true);
 }
 
+uint16_t* panel_framebuffer() {
+  return pt_gfx.getFramebuffer();
+}
+
 void loop()
 {
   pt_loop_display();
   StreamDeckApp::loop();
-}
\ No newline at end of file
+}
@@ -0,0 +1,289 @@
+#include "persist.h"
+#include "crc32.h"
+#include <Arduino.h>
+#include <Preferences.h>
+#include <esp_heap_caps.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/semphr.h>
+#include <vector>
+
+#define PERSIST_MAX_KEYS 12
+#define PERSIST_VALUE_LEN 64 // longest string value (wpass) incl. terminator
+
+enum NvsType : uint8_t { NVS_U8, NVS_U32, NVS_STR, NVS_BYTES };
+
+struct NvsEntry {
+    char key[16];                     // NVS keys are at most 15 chars
+    uint8_t type;
+    uint8_t len;
+    uint8_t nvs_len;
+    bool known;                       // nvs_value holds what NVS has
+    uint8_t value[PERSIST_VALUE_LEN]; // staged
+    uint8_t nvs_value[PERSIST_VALUE_LEN];
+};
+
+static NvsEntry g_keys[PERSIST_MAX_KEYS];
+static uint8_t g_key_count = 0;
+
+static const Deck* g_deck_src = nullptr;
+static char g_deck_path[32] = "";
+static uint32_t* g_record_crc = nullptr; // per record, as in the file
+static uint16_t g_file_pages = 0;        // pages the file replays to, 0: unknown (rewrite it)
+static bool g_deck_dirty = false;
+
+static PersistStats g_stats = {};
+static SemaphoreHandle_t g_lock = nullptr;
+static TaskHandle_t g_task = nullptr;
+static volatile uint32_t g_sync_req = 0;  // persist_sync() calls
+static volatile uint32_t g_sync_done = 0; // g_sync_req as of the last flush start
+static portMUX_TYPE g_sync_mux = portMUX_INITIALIZER_UNLOCKED; // not g_lock: held during flushes
+
+static void lock() {
+    if (!g_lock) g_lock = xSemaphoreCreateMutex();
+    xSemaphoreTake(g_lock, portMAX_DELAY);
+}
+
+static void unlock() {
+    xSemaphoreGive(g_lock);
+}
+
+static bool entry_dirty(const NvsEntry& e) {
+    return !e.known || e.len != e.nvs_len || memcmp(e.value, e.nvs_value, e.len) != 0;
+}
+
+static void stage(const char* key, uint8_t type, const void* data, size_t len, bool stored) {
+    if (len > PERSIST_VALUE_LEN) len = PERSIST_VALUE_LEN;
+    lock();
+    NvsEntry* e = nullptr;
+    for (uint8_t i = 0; i < g_key_count && !e; i++) {
+        if (strcmp(g_keys[i].key, key) == 0) e = &g_keys[i];
+    }
+    if (!e && g_key_count < PERSIST_MAX_KEYS) {
+        e = &g_keys[g_key_count++];
+        memset(e, 0, sizeof(NvsEntry));
+        strncpy(e->key, key, sizeof(e->key) - 1);
+        e->type = type;
+    }
+    if (e) {
+        memcpy(e->value, data, len);
+        e->len = (uint8_t)len;
+        if (stored) {
+            memcpy(e->nvs_value, data, len);
+            e->nvs_len = (uint8_t)len;
+            e->known = true;
+        }
+    } else {
+        Serial.printf("PERSIST: no slot for key %s\n", key);
+    }
+    unlock();
+}
+
+void persist_nvs_u8(const char* key, uint8_t value, bool stored) {
+    stage(key, NVS_U8, &value, sizeof(value), stored);
+}
+
+void persist_nvs_u32(const char* key, uint32_t value, bool stored) {
+    stage(key, NVS_U32, &value, sizeof(value), stored);
+}
+
+void persist_nvs_str(const char* key, const char* value, bool stored) {
+    // Terminator included so the staged bytes can be passed to putString()
+    stage(key, NVS_STR, value, strnlen(value, PERSIST_VALUE_LEN - 1) + 1, stored);
+}
+
+void persist_nvs_bytes(const char* key, const void* data, size_t len, bool stored) {
+    stage(key, NVS_BYTES, data, len, stored);
+}
+
+// Content, not pointers: an interned string may move to another arena on reload
+static uint32_t record_crc(const Button& b) {
+    uint32_t crc = crc32_update(0, &b.color, sizeof(b.color));
+    crc = crc32_update(crc, &b.type, sizeof(b.type));
+    crc = crc32_update(crc, b.label, strlen(b.label) + 1);
+    crc = crc32_update(crc, b.value, strlen(b.value) + 1);
+    crc = crc32_update(crc, b.icon, strlen(b.icon) + 1);
+    return crc32_update(crc, b.imgPath, strlen(b.imgPath) + 1);
+}
+
+static void bind_deck(const Deck& d, const char* path) {
+    if (!g_record_crc) {
+        size_t size = sizeof(uint32_t) * DECK_MAX_PAGES * DECK_PAGE_SLOTS;
+        g_record_crc = (uint32_t*)heap_caps_malloc(size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        if (!g_record_crc) g_record_crc = (uint32_t*)malloc(size);
+    }
+    g_deck_src = &d;
+    strncpy(g_deck_path, path, sizeof(g_deck_path) - 1);
+}
+
+static void remember_records(const Deck& d) {
+    if (!g_record_crc) return;
+    for (size_t i = 0; i < (size_t)d.page_count * DECK_PAGE_SLOTS; i++) g_record_crc[i] = record_crc(d.buttons[i]);
+}
+
+void persist_deck_loaded(const Deck& d, const char* path) {
+    lock();
+    bind_deck(d, path);
+    remember_records(d);
+    g_file_pages = d.page_count;
+    g_deck_dirty = false;
+    unlock();
+}
+
+void persist_deck_changed(const Deck& d, const char* path) {
+    lock();
+    if (g_deck_src != &d || strcmp(g_deck_path, path) != 0) {
+        // Nothing known about what this file holds
+        bind_deck(d, path);
+        g_file_pages = 0;
+    }
+    g_deck_dirty = true;
+    unlock();
+}
+
+static void flush_nvs() {
+    bool any = false;
+    for (uint8_t i = 0; i < g_key_count && !any; i++) any = entry_dirty(g_keys[i]);
+    if (!any) return;
+
+    Preferences prefs;
+    if (!prefs.begin(PERSIST_NVS_NAMESPACE, false)) return;
+    for (uint8_t i = 0; i < g_key_count; i++) {
+        NvsEntry& e = g_keys[i];
+        if (!entry_dirty(e)) continue;
+        size_t written = 0;
+        switch (e.type) {
+            case NVS_U8:  written = prefs.putUChar(e.key, e.value[0]); break;
+            case NVS_U32: { uint32_t v; memcpy(&v, e.value, sizeof(v)); written = prefs.putUInt(e.key, v); break; }
+            case NVS_STR: written = prefs.putString(e.key, (const char*)e.value); break;
+            case NVS_BYTES: written = prefs.putBytes(e.key, e.value, e.len); break;
+        }
+        // putString() returns the length without terminator: 0 for "" is fine
+        if (written == 0 && e.type != NVS_STR) continue;
+        memcpy(e.nvs_value, e.value, e.len);
+        e.nvs_len = e.len;
+        e.known = true;
+        g_stats.nvs_keys++;
+        g_stats.nvs_bytes += e.len;
+    }
+    prefs.end();
+}
+
+static void flush_deck() {
+    if (!g_deck_dirty || !g_deck_src) return;
+    const Deck& d = *g_deck_src;
+    size_t count = (size_t)d.page_count * DECK_PAGE_SLOTS;
+
+    if (g_file_pages == 0 || !g_record_crc) {
+        size_t written = 0;
+        if (!deck_save(d, g_deck_path, &written)) {
+            Serial.printf("STORAGE ERROR: Failed to write %s\n", g_deck_path);
+            return;
+        }
+        remember_records(d);
+        g_file_pages = d.page_count;
+        g_stats.full_writes++;
+        g_stats.file_bytes += written;
+        g_deck_dirty = false;
+        return;
+    }
+
+    // Pages added since the file was written replay as defaults
+    if (d.page_count > g_file_pages) {
+        Button def;
+        deck_default_button(def);
+        uint32_t def_crc = record_crc(def);
+        for (size_t i = (size_t)g_file_pages * DECK_PAGE_SLOTS; i < count; i++) g_record_crc[i] = def_crc;
+    }
+
+    // CRCs are taken before writing: a record edited meanwhile differs next time
+    std::vector<uint16_t> changed;
+    std::vector<uint32_t> crcs;
+    for (size_t i = 0; i < count; i++) {
+        uint32_t crc = record_crc(d.buttons[i]);
+        if (crc == g_record_crc[i]) continue;
+        changed.push_back((uint16_t)i);
+        crcs.push_back(crc);
+    }
+    if (!changed.empty() || d.page_count != g_file_pages) {
+        size_t written = 0;
+        if (!deck_append(d, g_deck_path, changed.data(), changed.size(), &written)) {
+            Serial.printf("STORAGE ERROR: Failed to update %s\n", g_deck_path);
+            g_file_pages = 0; // Unknown state: rewrite it whole next time
+            return;
+        }
+        for (size_t i = 0; i < changed.size(); i++) g_record_crc[changed[i]] = crcs[i];
+        g_file_pages = d.page_count;
+        g_stats.records += changed.size();
+        g_stats.file_bytes += written;
+    }
+    g_deck_dirty = false;
+}
+
+void persist_flush() {
+    lock();
+    PersistStats before = g_stats;
+    uint32_t t0 = millis();
+    flush_nvs();
+    flush_deck();
+    if (g_stats.nvs_keys != before.nvs_keys || g_stats.file_bytes != before.file_bytes) {
+        g_stats.flushes++;
+        g_stats.last_flush_ms = millis() - t0;
+        Serial.printf("PERSIST: %u keys (%u B), %u records, %u full (%u B) in %u ms\n",
+                      g_stats.nvs_keys - before.nvs_keys, g_stats.nvs_bytes - before.nvs_bytes,
+                      g_stats.records - before.records, g_stats.full_writes - before.full_writes,
+                      g_stats.file_bytes - before.file_bytes, g_stats.last_flush_ms);
+    }
+    unlock();
+}
+
+static void persist_task(void*) {
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        // Quiet period: every further request restarts it, a waiting persist_sync() ends it
+        while (g_sync_done == g_sync_req && ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(PERSIST_DELAY_MS)) > 0) {}
+        uint32_t req = g_sync_req; // Staged before this flush: covered by it
+        persist_flush();
+        g_sync_done = req;
+    }
+}
+
+void persist_begin() {
+    if (!g_lock) g_lock = xSemaphoreCreateMutex();
+    if (!g_task) xTaskCreate(persist_task, "persist", 4096, NULL, 1, &g_task);
+}
+
+void persist_request() {
+    lock();
+    g_stats.requests++;
+    unlock();
+    if (g_task) xTaskNotifyGive(g_task);
+    else persist_flush();
+}
+
+bool persist_sync(uint32_t timeout_ms) {
+    if (!g_task) {
+        persist_flush();
+        return true;
+    }
+    portENTER_CRITICAL(&g_sync_mux);
+    uint32_t want = ++g_sync_req;
+    portEXIT_CRITICAL(&g_sync_mux);
+    xTaskNotifyGive(g_task);
+    uint32_t t0 = millis();
+    while ((int32_t)(g_sync_done - want) < 0) {
+        if (millis() - t0 >= timeout_ms) {
+            Serial.printf("PERSIST: flush not done after %u ms\n", (unsigned)timeout_ms);
+            return false;
+        }
+        vTaskDelay(pdMS_TO_TICKS(5));
+    }
+    return true;
+}
+
+PersistStats persist_stats() {
+    lock();
+    PersistStats s = g_stats;
+    unlock();
+    return s;
+}
@@ -0,0 +1,65 @@
+#ifndef PERSIST_H
+#define PERSIST_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "deck.h"
+
+// ==========================================
+// WRITE-COALESCING PERSISTENCE
+// ==========================================
+// Settings and button edits are staged in RAM and written by a background
+// task once no new change has arrived for PERSIST_DELAY_MS, so a burst of
+// edits (a dashboard save, dragging a color slider) costs one flush.
+//
+// NVS keys are compared with the value last read from or written to NVS and
+// only differing keys are written. Deck records are compared by CRC with what
+// the file holds and only changed buttons are appended to the deck log
+// (deck_append()); a full deck_save() happens only when the file's content is
+// unknown.
+
+#define PERSIST_NVS_NAMESPACE "deck"
+#define PERSIST_DELAY_MS      1500
+#define PERSIST_SYNC_MS       3000 // longest persist_sync() wait
+
+// Starts the flush task. Values staged before that are flushed on the first change.
+void persist_begin();
+
+// Stage an NVS value. `stored` = the value was just read from NVS (nothing to write).
+void persist_nvs_u8(const char* key, uint8_t value, bool stored = false);
+void persist_nvs_u32(const char* key, uint32_t value, bool stored = false);
+void persist_nvs_str(const char* key, const char* value, bool stored = false);
+void persist_nvs_bytes(const char* key, const void* data, size_t len, bool stored = false); // len <= 64
+
+// `d` was just loaded from (or saved to) `path`: records match the file
+void persist_deck_loaded(const Deck& d, const char* path);
+
+// Buttons or page count of `d` changed; they belong in `path`
+void persist_deck_changed(const Deck& d, const char* path);
+
+// Schedules a delayed flush of everything staged
+void persist_request();
+
+// Writes everything staged now, from any task. Call before reading the files
+// or keys back, before writing deck files directly and before a restart.
+void persist_flush();
+
+// Same, but the flush task writes (skipping the quiet period) while the caller
+// waits for it, up to `timeout_ms`: for tasks that must not do flash writes
+// themselves (async_tcp). false: not written yet, the caller should give up.
+bool persist_sync(uint32_t timeout_ms = PERSIST_SYNC_MS);
+
+struct PersistStats {
+    uint32_t requests;      // persist_request() calls
+    uint32_t flushes;       // flushes that wrote something
+    uint32_t nvs_keys;      // NVS keys written
+    uint32_t nvs_bytes;     // payload bytes of those keys
+    uint32_t records;       // button records appended
+    uint32_t full_writes;   // whole deck files written (compactions inside appends excluded)
+    uint32_t file_bytes;    // bytes written to deck files
+    uint32_t last_flush_ms; // duration of the last flush
+};
+
+PersistStats persist_stats();
+
+#endif // PERSIST_H
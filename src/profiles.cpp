@@ -0,0 +1,178 @@
+#include "profiles.h"
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <ArduinoJson.h>
+
+static Profile* g_profiles[PROFILE_MAX] = { nullptr };
+static uint8_t g_count = 0;
+
+static Profile* new_profile(const char* name, const char* path, uint8_t os) {
+    Profile* p = new Profile();
+    strncpy(p->name, name, PROFILE_NAME_LEN - 1);
+    strncpy(p->path, path, PROFILE_PATH_LEN - 1);
+    p->os = os;
+    return p;
+}
+
+bool profile_write_list(const ProfileEntry* list, size_t count) {
+    JsonDocument doc;
+    JsonArray arr = doc.to<JsonArray>();
+    for (size_t i = 0; i < count; i++) {
+        JsonObject o = arr.add<JsonObject>();
+        o["name"] = list[i].name;
+        o["file"] = list[i].path;
+        o["os"] = list[i].os;
+    }
+    File f = LittleFS.open(PROFILE_LIST_FILE, "w");
+    bool ok = f && serializeJson(doc, f) > 0;
+    if (f) f.close();
+    if (!ok) Serial.printf("STORAGE ERROR: Failed to write %s\n", PROFILE_LIST_FILE);
+    return ok;
+}
+
+size_t profile_list(ProfileEntry* out, size_t max) {
+    size_t n = 0;
+    for (; n < g_count && n < max; n++) {
+        memcpy(out[n].name, g_profiles[n]->name, PROFILE_NAME_LEN);
+        memcpy(out[n].path, g_profiles[n]->path, PROFILE_PATH_LEN);
+        out[n].os = g_profiles[n]->os;
+    }
+    return n;
+}
+
+static void save_list() {
+    ProfileEntry list[PROFILE_MAX];
+    profile_write_list(list, profile_list(list, PROFILE_MAX));
+}
+
+void profile_new_path(const ProfileEntry* list, size_t count, char* out, size_t len) {
+    for (int n = 0;; n++) {
+        snprintf(out, len, "/prof_%d.bin", n);
+        bool used = false;
+        for (size_t i = 0; i < count && !used; i++) used = strcmp(list[i].path, out) == 0;
+        if (!used && !LittleFS.exists(out)) return;
+    }
+}
+
+// Matches an entry of the list to a resident profile by file, so reloading
+// keeps the Profile (and its Deck) of files that are still listed
+static Profile* take_resident(Profile** old, uint8_t old_count, const char* path) {
+    for (uint8_t i = 0; i < old_count; i++) {
+        if (old[i] && strcmp(old[i]->path, path) == 0) {
+            Profile* p = old[i];
+            old[i] = nullptr;
+            return p;
+        }
+    }
+    return nullptr;
+}
+
+void profiles_load() {
+    uint32_t t0 = millis();
+    Profile* old[PROFILE_MAX];
+    uint8_t old_count = g_count;
+    memcpy(old, g_profiles, sizeof(old));
+    g_count = 0;
+
+    auto add = [&](const char* name, const char* path, uint8_t os) {
+        if (g_count >= PROFILE_MAX || !path || path[0] != '/') return;
+        Profile* p = take_resident(old, old_count, path);
+        if (p) {
+            strncpy(p->name, name, PROFILE_NAME_LEN - 1);
+            p->os = os;
+        } else {
+            p = new_profile(name, path, os);
+        }
+        g_profiles[g_count++] = p;
+    };
+
+    // Built-ins always come first, whatever the list says about them
+    add("Windows", "/win_btns.bin", 0);
+    add("macOS", "/mac_btns.bin", 1);
+    File f = LittleFS.open(PROFILE_LIST_FILE, "r");
+    if (f) {
+        JsonDocument doc;
+        if (!deserializeJson(doc, f)) {
+            JsonArray arr = doc.as<JsonArray>();
+            for (size_t i = 0; i < arr.size(); i++) {
+                const char* path = arr[i]["file"] | "";
+                if (i < PROFILE_BUILTIN) {
+                    // Built-ins keep their file, only the name may differ
+                    if (strcmp(path, g_profiles[i]->path) == 0) {
+                        strncpy(g_profiles[i]->name, arr[i]["name"] | (const char*)g_profiles[i]->name, PROFILE_NAME_LEN - 1);
+                    }
+                    continue;
+                }
+                add(arr[i]["name"] | "Profile", path, arr[i]["os"] | 0);
+            }
+        }
+        f.close();
+    }
+    // Profiles gone from the list
+    for (uint8_t i = 0; i < old_count; i++) {
+        if (!old[i]) continue;
+        deck_free(old[i]->deck);
+        delete old[i];
+    }
+
+    uint16_t buttons = 0;
+    for (uint8_t i = 0; i < g_count; i++) {
+        Profile* p = g_profiles[i];
+        if (!deck_load(p->deck, p->path)) {
+            if (LittleFS.exists(p->path)) Serial.printf("STORAGE ERROR: %s is not a deck\n", p->path);
+            deck_init(p->deck, 1);
+        }
+        buttons += p->deck.page_count * DECK_PAGE_SLOTS;
+    }
+    Serial.printf("PROFILE: %u profiles (%u buttons) resident in %lu ms\n", g_count, buttons, millis() - t0);
+}
+
+uint8_t profile_count() {
+    return g_count;
+}
+
+Profile* profile_get(uint8_t id) {
+    return id < g_count ? g_profiles[id] : nullptr;
+}
+
+int profile_find_os(uint8_t os) {
+    for (uint8_t i = 0; i < g_count; i++) {
+        if (g_profiles[i]->os == os) return i;
+    }
+    return -1;
+}
+
+int profile_add(const char* name, uint8_t os, const Deck* copy) {
+    if (g_count >= PROFILE_MAX) return -1;
+    ProfileEntry list[PROFILE_MAX];
+    char path[PROFILE_PATH_LEN];
+    profile_new_path(list, profile_list(list, PROFILE_MAX), path, sizeof(path));
+
+    Profile* p = new_profile(name[0] ? name : "Profile", path, os > 1 ? 0 : os);
+    bool ok = deck_init(p->deck, copy ? copy->page_count : 1);
+    for (size_t i = 0; ok && copy && i < (size_t)copy->page_count * DECK_PAGE_SLOTS; i++) {
+        ButtonConfig b;
+        deck_get(*copy, i, b);
+        ok = deck_set(p->deck, i, b);
+    }
+    if (!ok || !deck_save(p->deck, path)) {
+        deck_free(p->deck);
+        delete p;
+        return -1;
+    }
+    g_profiles[g_count++] = p;
+    save_list();
+    return g_count - 1;
+}
+
+bool profile_remove(uint8_t id) {
+    if (id < PROFILE_BUILTIN || id >= g_count) return false;
+    Profile* p = g_profiles[id];
+    LittleFS.remove(p->path);
+    deck_free(p->deck);
+    delete p;
+    memmove(&g_profiles[id], &g_profiles[id + 1], (g_count - id - 1) * sizeof(Profile*));
+    g_profiles[--g_count] = nullptr;
+    save_list();
+    return true;
+}
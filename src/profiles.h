@@ -0,0 +1,70 @@
+#ifndef PROFILES_H
+#define PROFILES_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "deck.h"
+
+// ==========================================
+// RESIDENT PROFILES
+// ==========================================
+// Every profile's deck stays loaded in PSRAM, so switching profiles is a
+// pointer swap: no NVS, no file read, no migration checks. With packed
+// buttons a one-page profile costs about 27 KB.
+//
+// The list (name, deck file, target OS) is kept in PROFILE_LIST_FILE. The
+// first two profiles are the original Windows and macOS decks and cannot be
+// removed; when there is no list they are all there is.
+
+#define PROFILE_MAX       8
+#define PROFILE_NAME_LEN  16
+#define PROFILE_PATH_LEN  24
+#define PROFILE_BUILTIN   2
+#define PROFILE_LIST_FILE "/profiles.json"
+
+struct Profile {
+    char name[PROFILE_NAME_LEN];
+    char path[PROFILE_PATH_LEN];
+    uint8_t os; // key sequences: 0 Windows, 1 macOS
+    Deck deck;
+};
+
+// An entry of PROFILE_LIST_FILE
+struct ProfileEntry {
+    char name[PROFILE_NAME_LEN];
+    char path[PROFILE_PATH_LEN];
+    uint8_t os;
+};
+
+// (Re)reads the list and every deck from LittleFS. Decks are reloaded in
+// place: a Deck* taken before stays valid.
+void profiles_load();
+
+uint8_t profile_count();
+
+// nullptr when out of range. Profiles never move while they exist.
+Profile* profile_get(uint8_t id);
+
+// First profile targeting `os`, -1 if none
+int profile_find_os(uint8_t os);
+
+// New profile with its own deck file; `copy` (optional) seeds its buttons.
+// Returns the id, -1 when the list is full or the file cannot be written.
+int profile_add(const char* name, uint8_t os, const Deck* copy = nullptr);
+
+// Deletes a profile and its file. Built-in profiles cannot be removed; the
+// caller must not have `id` active. Ids above `id` shift down by one.
+bool profile_remove(uint8_t id);
+
+// Restores edit the list as a file and leave the resident profiles alone
+// until profiles_load(). The list as it is resident (built-ins first):
+size_t profile_list(ProfileEntry* out, size_t max);
+
+// Deck file for a new profile: the first "/prof_N.bin" neither in `list`
+// nor on LittleFS
+void profile_new_path(const ProfileEntry* list, size_t count, char* out, size_t len);
+
+// Writes PROFILE_LIST_FILE; `list` starts with the built-ins
+bool profile_write_list(const ProfileEntry* list, size_t count);
+
+#endif // PROFILES_H
@@ -29,6 +29,9 @@
 // Function pointer type for scheduling work on the LVGL thread
 typedef void (*pt_ui_fn_t)(void *arg);
 
+// Fills the panel framebuffer before LVGL draws anything; false = leave it black
+typedef bool (*pt_panel_fill_fn_t)(uint16_t *fb, uint16_t w, uint16_t h);
+
 // Render method enum (mirrors board Kconfig options)
 typedef enum
 {
@@ -277,8 +280,13 @@ inline void pt_touchpad_read(lv_indev_t *indev, lv_indev_data_t *data)
  * @brief Sets up the display.
  *
  * This function initializes the display settings and prepares it for use.
+ *
+ * @param mode LVGL render method.
+ * @param fill Optional: draws the first image into the panel framebuffer
+ *             right after the panel starts (instead of black).
  */
-inline void pt_setup_display(PT_LVGL_render_method_t mode = (PT_LVGL_render_method_t)PT_LVGL_RENDER_METHOD)
+inline void pt_setup_display(PT_LVGL_render_method_t mode = (PT_LVGL_render_method_t)PT_LVGL_RENDER_METHOD,
+                             pt_panel_fill_fn_t fill = NULL)
 {
   uint32_t screenWidth;
   uint32_t screenHeight;
@@ -298,7 +306,8 @@ inline void pt_setup_display(PT_LVGL_render_method_t mode = (PT_LVGL_render_meth
 
   // Panel bring-up
   pt_gfx.begin();
-  pt_gfx.fillScreen(0x000000);
+  if (!fill || !fill(pt_gfx.getFramebuffer(), pt_gfx.width(), pt_gfx.height()))
+    pt_gfx.fillScreen(0x000000);
 
   // Touch
   pt_touchpanel.begin();
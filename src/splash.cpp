@@ -0,0 +1,165 @@
+#include "splash.h"
+#include "crc32.h"
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <esp_heap_caps.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#define SPLASH_TMP_FILE "/.splash.tmp"
+#define SPLASH_READ_CHUNK 4096
+
+static uint32_t g_saved_crc = 0; // payload crc of the file, 0: none known
+static volatile bool g_writing = false;
+static SplashStats g_stats = {};
+
+bool splash_draw(uint16_t* fb, uint16_t width, uint16_t height) {
+    int64_t t0 = esp_timer_get_time();
+    File f = LittleFS.open(SPLASH_FILE, "r");
+    if (!f) return false;
+    SplashHeader h;
+    if (f.read((uint8_t*)&h, sizeof(h)) != sizeof(h) || h.magic != SPLASH_MAGIC || h.version != SPLASH_VERSION ||
+        h.width != width || h.height != height || h.payload_len > SPLASH_MAX_BYTES) {
+        f.close();
+        return false;
+    }
+
+    uint8_t* chunk = (uint8_t*)malloc(SPLASH_READ_CHUNK);
+    if (!chunk) { f.close(); return false; }
+
+    // Control bytes and pixels may straddle chunks: decode byte by byte
+    const size_t total = (size_t)width * height;
+    size_t px = 0, left = h.payload_len;
+    uint32_t crc = 0;
+    int ctrl = -1;        // control byte being served
+    uint16_t count = 0;   // pixels it still covers
+    uint8_t lo = 0;
+    bool have_lo = false;
+    bool ok = true;
+    while (left > 0 && ok) {
+        size_t n = f.read(chunk, left < SPLASH_READ_CHUNK ? left : SPLASH_READ_CHUNK);
+        if (n == 0) { ok = false; break; }
+        crc = crc32_update(crc, chunk, n);
+        left -= n;
+        for (size_t i = 0; i < n && ok; i++) {
+            uint8_t b = chunk[i];
+            if (ctrl < 0) {
+                ctrl = b;
+                count = b < 128 ? b + 1 : b - 126;
+                continue;
+            }
+            if (!have_lo) { lo = b; have_lo = true; continue; }
+            have_lo = false;
+            uint16_t pixel = lo | (b << 8);
+            if (ctrl < 128) {
+                if (px >= total) { ok = false; break; }
+                fb[px++] = pixel;
+                if (--count == 0) ctrl = -1;
+            } else {
+                if (px + count > total) { ok = false; break; }
+                for (uint16_t k = 0; k < count; k++) fb[px++] = pixel;
+                ctrl = -1;
+            }
+        }
+    }
+    free(chunk);
+    f.close();
+    if (!ok || px != total || ctrl >= 0 || crc != h.crc) return false;
+
+    g_saved_crc = h.crc;
+    g_stats.bytes = h.payload_len;
+    g_stats.draw_us = (uint32_t)(esp_timer_get_time() - t0);
+    return true;
+}
+
+// Worst case is one control byte per 128 literal pixels; stops at `cap`
+static size_t encode(const uint16_t* px, size_t total, uint8_t* out, size_t cap) {
+    size_t o = 0, i = 0;
+    while (i < total) {
+        size_t run = 1;
+        while (i + run < total && run < 129 && px[i + run] == px[i]) run++;
+        if (run >= 2) {
+            if (o + 3 > cap) return 0;
+            out[o++] = (uint8_t)(run + 126);
+            out[o++] = px[i] & 0xFF;
+            out[o++] = px[i] >> 8;
+            i += run;
+            continue;
+        }
+        // Literals up to the next pair of equal pixels
+        size_t lit = 1;
+        while (i + lit < total && lit < 128 && !(i + lit + 1 < total && px[i + lit] == px[i + lit + 1])) lit++;
+        if (o + 1 + lit * 2 > cap) return 0;
+        out[o++] = (uint8_t)(lit - 1);
+        for (size_t k = 0; k < lit; k++) {
+            out[o++] = px[i + k] & 0xFF;
+            out[o++] = px[i + k] >> 8;
+        }
+        i += lit;
+    }
+    return o;
+}
+
+struct SplashJob {
+    SplashHeader header;
+    uint8_t* payload;
+};
+
+static void write_task(void* arg) {
+    SplashJob* job = (SplashJob*)arg;
+    File f = LittleFS.open(SPLASH_TMP_FILE, "w");
+    bool ok = f && f.write((const uint8_t*)&job->header, sizeof(job->header)) == sizeof(job->header) &&
+              f.write(job->payload, job->header.payload_len) == job->header.payload_len;
+    if (f) f.close();
+    if (ok && LittleFS.rename(SPLASH_TMP_FILE, SPLASH_FILE)) {
+        g_saved_crc = job->header.crc;
+        g_stats.bytes = job->header.payload_len;
+        g_stats.captures++;
+        Serial.printf("BOOT: splash saved (%u B, encoded in %u ms)\n", (unsigned)job->header.payload_len,
+                      (unsigned)(g_stats.encode_us / 1000));
+    } else {
+        LittleFS.remove(SPLASH_TMP_FILE);
+        Serial.println("STORAGE ERROR: Failed to write " SPLASH_FILE);
+    }
+    heap_caps_free(job->payload);
+    delete job;
+    g_writing = false;
+    vTaskDelete(NULL);
+}
+
+bool splash_capture(const uint16_t* fb, uint16_t width, uint16_t height) {
+    if (!fb || g_writing) return false;
+    int64_t t0 = esp_timer_get_time();
+    uint8_t* buf = (uint8_t*)heap_caps_malloc(SPLASH_MAX_BYTES, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!buf) return false;
+    size_t len = encode(fb, (size_t)width * height, buf, SPLASH_MAX_BYTES);
+    g_stats.encode_us = (uint32_t)(esp_timer_get_time() - t0);
+    uint32_t crc = len ? crc32_update(0, buf, len) : 0;
+    if (len == 0 || crc == g_saved_crc) {
+        if (len) g_stats.unchanged++;
+        heap_caps_free(buf);
+        return false;
+    }
+
+    SplashJob* job = new SplashJob();
+    job->header = {SPLASH_MAGIC, SPLASH_VERSION, width, height, 0, (uint32_t)len, crc};
+    job->payload = (uint8_t*)heap_caps_realloc(buf, len, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!job->payload) job->payload = buf;
+    g_writing = true;
+    if (xTaskCreate(write_task, "splash", 4096, job, 1, NULL) != pdPASS) {
+        g_writing = false;
+        heap_caps_free(job->payload);
+        delete job;
+        return false;
+    }
+    return true;
+}
+
+bool splash_busy() {
+    return g_writing;
+}
+
+SplashStats splash_stats() {
+    return g_stats;
+}
@@ -0,0 +1,58 @@
+#ifndef SPLASH_H
+#define SPLASH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ==========================================
+// BOOT SPLASH (LAST MAIN SCREEN)
+// ==========================================
+// The panel framebuffer is saved to LittleFS once the main screen has settled
+// after a change, and written straight back into the framebuffer at the next
+// power-on, right after the panel starts. The deck is visible while LVGL,
+// the config and the grid come up; LVGL's first full frame replaces it.
+//
+// File (little endian): SplashHeader | payload. The payload is the frame as
+// RGB565 pixels in row order, run-length coded in control bytes:
+//   0..127   n + 1 literal pixels follow
+//   128..255 the next pixel repeats n - 126 times (2..129)
+
+#define SPLASH_FILE       "/.splash.bin"
+#define SPLASH_MAGIC      0x31505350u // "PSP1"
+#define SPLASH_VERSION    1
+#define SPLASH_MAX_BYTES  (192 * 1024) // busier screens are not worth reading at boot
+#define SPLASH_SETTLE_MS  2000         // no render and no touch for this long
+
+struct SplashHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t width;
+    uint16_t height;
+    uint16_t reserved;
+    uint32_t payload_len;
+    uint32_t crc; // crc32 of the payload
+};
+
+// Decodes the saved screen into `fb` (width * height RGB565). false (and `fb`
+// possibly half written) if there is none, it has another size or is damaged.
+bool splash_draw(uint16_t* fb, uint16_t width, uint16_t height);
+
+// Encodes `fb` and writes it from a background task unless it matches the
+// saved screen. false if skipped (unchanged, too large, a write still running).
+// Call where nothing draws into `fb` meanwhile (the LVGL thread).
+bool splash_capture(const uint16_t* fb, uint16_t width, uint16_t height);
+
+// A capture is still being written
+bool splash_busy();
+
+struct SplashStats {
+    uint32_t bytes;      // saved payload
+    uint32_t draw_us;    // boot: file read + decode into the framebuffer
+    uint32_t encode_us;  // last capture
+    uint32_t captures;   // files written since boot
+    uint32_t unchanged;  // captures skipped because the screen matched
+};
+
+SplashStats splash_stats();
+
+#endif // SPLASH_H
@@ -0,0 +1,128 @@
+#include "str_arena.h"
+#include <esp_heap_caps.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <string.h>
+#include <stdlib.h>
+
+struct ArenaChunk {
+    ArenaChunk* next;
+    uint32_t used;
+    uint32_t size;
+    char data[1];
+};
+
+struct StrArena {
+    ArenaChunk* chunks;     // newest first
+    const char** table;     // open addressing, power-of-two capacity
+    uint32_t capacity;
+    StrArenaStats stats;
+};
+
+static SemaphoreHandle_t g_lock = xSemaphoreCreateMutex(); // every arena: interning is rare
+
+static void* arena_alloc(size_t size) {
+    void* p = heap_caps_malloc(size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    return p ? p : malloc(size);
+}
+
+// FNV-1a
+static uint32_t hash(const char* s, size_t len) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; i++) h = (h ^ (uint8_t)s[i]) * 16777619u;
+    return h;
+}
+
+static bool same(const char* stored, const char* s, size_t len) {
+    return strncmp(stored, s, len) == 0 && stored[len] == '\0';
+}
+
+static bool grow_table(StrArena* a) {
+    uint32_t capacity = a->capacity ? a->capacity * 2 : 64;
+    const char** table = (const char**)arena_alloc(capacity * sizeof(const char*));
+    if (!table) return false;
+    memset(table, 0, capacity * sizeof(const char*));
+    for (uint32_t i = 0; i < a->capacity; i++) {
+        const char* s = a->table[i];
+        if (!s) continue;
+        uint32_t j = hash(s, strlen(s)) & (capacity - 1);
+        while (table[j]) j = (j + 1) & (capacity - 1);
+        table[j] = s;
+    }
+    heap_caps_free(a->table);
+    a->table = table;
+    a->capacity = capacity;
+    a->stats.table = capacity * sizeof(const char*);
+    return true;
+}
+
+static char* store(StrArena* a, const char* s, size_t len) {
+    ArenaChunk* c = a->chunks;
+    if (!c || c->size - c->used < len + 1) {
+        size_t size = len + 1 > STR_ARENA_CHUNK ? len + 1 : STR_ARENA_CHUNK;
+        c = (ArenaChunk*)arena_alloc(sizeof(ArenaChunk) + size);
+        if (!c) return nullptr;
+        c->next = a->chunks;
+        c->used = 0;
+        c->size = size;
+        a->chunks = c;
+        a->stats.reserved += sizeof(ArenaChunk) + size;
+    }
+    char* out = c->data + c->used;
+    memcpy(out, s, len);
+    out[len] = '\0';
+    c->used += len + 1;
+    a->stats.used += len + 1;
+    a->stats.strings++;
+    return out;
+}
+
+StrArena* str_arena_create() {
+    StrArena* a = (StrArena*)arena_alloc(sizeof(StrArena));
+    if (a) memset(a, 0, sizeof(StrArena));
+    return a;
+}
+
+void str_arena_destroy(StrArena* a) {
+    if (!a) return;
+    while (a->chunks) {
+        ArenaChunk* next = a->chunks->next;
+        heap_caps_free(a->chunks);
+        a->chunks = next;
+    }
+    heap_caps_free(a->table);
+    heap_caps_free(a);
+}
+
+static const char* intern(StrArena* a, const char* s, size_t len) {
+    a->stats.lookups++;
+    // Keep the load factor under 3/4
+    if ((a->stats.strings + 1) * 4 > a->capacity * 3 && !grow_table(a)) return nullptr;
+
+    uint32_t i = hash(s, len) & (a->capacity - 1);
+    while (a->table[i]) {
+        if (same(a->table[i], s, len)) {
+            a->stats.hits++;
+            return a->table[i];
+        }
+        i = (i + 1) & (a->capacity - 1);
+    }
+    char* stored = store(a, s, len);
+    if (stored) a->table[i] = stored;
+    return stored;
+}
+
+const char* str_arena_intern(StrArena* a, const char* s, size_t len) {
+    static const char empty[] = "";
+    if (len == 0) return empty;
+    xSemaphoreTake(g_lock, portMAX_DELAY);
+    const char* out = intern(a, s, len);
+    xSemaphoreGive(g_lock);
+    return out;
+}
+
+StrArenaStats str_arena_stats(const StrArena* a) {
+    StrArenaStats s = {};
+    if (a) s = a->stats;
+    return s;
+}
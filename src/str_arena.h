@@ -0,0 +1,40 @@
+#ifndef STR_ARENA_H
+#define STR_ARENA_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ==========================================
+// INTERNED STRING ARENA
+// ==========================================
+// Bump allocator for the strings of one profile. Equal strings are stored
+// once and share a pointer, so "MUTE" on twenty buttons costs five bytes.
+// Chunks never move: a returned pointer stays valid until the arena is
+// destroyed. Nothing is freed individually; a replaced string stays in its
+// chunk until the profile is reloaded.
+//
+// Interning takes a lock: the web server and the LVGL loop both edit decks,
+// and growing the table frees the one the other task may be probing.
+
+#define STR_ARENA_CHUNK 4096
+
+struct StrArena;
+
+StrArena* str_arena_create();
+void str_arena_destroy(StrArena* a);
+
+// Interned copy of s[0..len). "" is a shared static string.
+const char* str_arena_intern(StrArena* a, const char* s, size_t len);
+
+struct StrArenaStats {
+    uint32_t strings;  // distinct strings stored
+    uint32_t used;     // bytes taken by them (terminators included)
+    uint32_t reserved; // chunk bytes allocated
+    uint32_t table;    // bytes of the lookup table
+    uint32_t lookups;
+    uint32_t hits;     // lookups answered by an existing string
+};
+
+StrArenaStats str_arena_stats(const StrArena* a);
+
+#endif // STR_ARENA_H
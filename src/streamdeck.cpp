@@ -1,4 +1,23 @@
 #include "streamdeck.h"
+#include "asset_store.h"
+#include "icon_atlas.h"
+#include "style_pool.h"
+#include "button_cache.h"
+#include "crc32.h"
+#include "deck.h"
+#include "persist.h"
+#include "profiles.h"
+#include "boot.h"
+#include "splash.h"
+#include "wifi_mgr.h"
+#include "json_writer.h"
+#include "gzip_stream.h"
+#include "web_ui.h"
+#include "backup.h"
+#include "jobs.h"
+#include "upload.h"
+#include "bundle.h"
+#include "firmware.h"
 #include <BleKeyboard.h>
 #include <BLEDevice.h>
 #include <BLESecurity.h>
@@ -7,16 +26,18 @@
 #include <ESPAsyncWebServer.h>
 #include <LittleFS.h>
 #include <ArduinoOTA.h>
-#include <Update.h>
-#include <ArduinoJson.h>
-#include <base64.h>
-#include <esp_task_wdt.h>
 #include <esp_ipc.h>
+#include <esp_timer.h>
+#include <esp_heap_caps.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/event_groups.h>
 #include <vector>
 #include <string>
+#include <memory>
 
 
 extern void set_brightness(uint8_t val);
+extern uint16_t* panel_framebuffer();
 
 // ==========================================
 // LOCALIZATION (L10N)
@@ -79,10 +100,25 @@ struct L10n {
     const char* color_title;
     const char* icon_title;
     const char* image_title;
+    const char* page_label;
+    const char* add_page;
+    const char* remove_page;
+    const char* add_profile;
+    const char* remove_profile;
+    const char* profile_name;
+    const char* wifi_networks;
+    const char* wifi_scanning;
+    const char* wifi_connecting;
+    const char* wifi_waiting_ip;
+    const char* wifi_connected;
+    const char* wifi_failed;
+    const char* wifi_bad_pass;
+    const char* wifi_no_ap;
+    const char* wifi_open;
 };
 
 static const L10n g_l10n_en = {
-    "🎨 PandaDeck Dash", "Keyboard:", "OS:", "Grid:", "Background:",
+    "🎨 PandaDeck Dash", "Keyboard:", "Profile:", "Grid:", "Background:",
     "Button Configuration", "Name", "Command",
     "App (Win+R / Cmd+Space)", "Media Key", "Basic Combo (Ctrl/Cmd + Key)", "Advanced Combo",
     "Save Changes", "Library", "Upload",
@@ -92,19 +128,23 @@ static const L10n g_l10n_en = {
     "Restore Complete!", "Configuration saved!", "Delete ",
     "Update firmware? The device will restart.",
     "Settings - Customization", "Global Background Color", "Grid Layout Size",
-    "Target OS (Win/Mac)", "WiFi Setup", "Keyboard Language (US/ES)",
+    "Profile (Win/Mac/...)", "WiFi Setup", "Keyboard Language (US/ES)",
     "Back", "Cancel", "Save", "Editing Button ", "Editing Global Background",
     "Label:", "Icon:", "Action:", "Cmd/Key:", "Custom Image:",
     "SSID:", "Password:", "Save & Connect",
-    "Select Grid Layout", "Select Target OS", "Select Keyboard Language",
+    "Select Grid Layout", "Select Profile", "Select Keyboard Language",
     "None", "Basic combination uses Ctrl (Win) or Cmd (Mac) plus one key.",
     "Button", "- Key -",
     {"None", "OK", "Close", "Copy", "Paste", "Cut", "Play", "Pause", "PlayPause", "Mute", "Settings", "Home", "Save", "Edit", "File", "Dir", "Plus", "Prev", "Next", "Stop"},
-    "Background Color", "Icon", "Custom Image"
+    "Background Color", "Icon", "Custom Image",
+    "Page", "Add Page", "Remove Last Page",
+    "New Profile", "Delete Profile", "Profile name:",
+    "Networks", "Scanning...", "Connecting to %s...", "Joined (ch %u), getting IP...",
+    "Connected: %s (%u ms)", "Failed (%s), retry in %u s", "wrong password?", "network not found", "open"
 };
 
 static const L10n g_l10n_es = {
-    "🎨 PandaDeck Dash", "Teclado:", "SO:", "Cuadrícula:", "Fondo:",
+    "🎨 PandaDeck Dash", "Teclado:", "Perfil:", "Cuadrícula:", "Fondo:",
     "Configuración de Botones", "Nombre", "Comando",
     "App (Win+R / Cmd+Space)", "Multimedia", "Combo Básico (Ctrl/Cmd + Tecla)", "Combo Avanzado",
     "Guardar Cambios", "Librería", "Subir",
@@ -114,29 +154,24 @@ static const L10n g_l10n_es = {
     "¡Restauración completada!", "¡Configuración guardada!", "¿Borrar ",
     "¿Deseas actualizar el firmware? El dispositivo se reiniciará.",
     "Ajustes - Personalización", "Color de Fondo Global", "Tamaño de Cuadrícula",
-    "SO de Destino (Win/Mac)", "Configurar WiFi", "Idioma de Teclado (US/ES)",
+    "Perfil (Win/Mac/...)", "Configurar WiFi", "Idioma de Teclado (US/ES)",
     "Atrás", "Cancelar", "Guardar", "Editando Botón ", "Editando Fondo Global",
     "Etiqueta:", "Icono:", "Acción:", "Comando/Tecla:", "Imagen Custom:",
     "SSID:", "Contraseña:", "Guardar y Conectar",
-    "Seleccionar Cuadrícula", "Seleccionar SO", "Seleccionar Idioma",
+    "Seleccionar Cuadrícula", "Seleccionar Perfil", "Seleccionar Idioma",
     "Ninguno", "La combinación básica usa Ctrl (Windows) o Cmd (Mac) más una tecla.",
     "Botón", "- Tecla -",
     {"Ninguno", "Aceptar", "Cerrar", "Copiar", "Pegar", "Cortar", "Reproducir", "Pausa", "Play/Pausa", "Silencio", "Ajustes", "Inicio", "Guardar", "Editar", "Archivo", "Carpeta", "Más", "Anterior", "Siguiente", "Parar"},
-    "Color de Fondo", "Icono", "Imagen Personalizada"
+    "Color de Fondo", "Icono", "Imagen Personalizada",
+    "Página", "Añadir Página", "Quitar Última Página",
+    "Nuevo Perfil", "Borrar Perfil", "Nombre del perfil:",
+    "Redes", "Buscando...", "Conectando a %s...", "Asociado (canal %u), obteniendo IP...",
+    "Conectado: %s (%u ms)", "Error (%s), reintento en %u s", "¿contraseña incorrecta?", "red no encontrada", "abierta"
 };
 
 // ==========================================
 // CONFIGURATION & STRUCTURES
 // ==========================================
-struct ButtonConfig {
-    char label[16];
-    char value[256];
-    uint8_t type; // 0: App, 1: Media, 2: Basic, 3: Adv
-    uint32_t color;
-    char icon[8];
-    char imgPath[32];
-};
-
 struct LegacyButtonConfig {
     char label[16];
     char value[128];
@@ -146,14 +181,54 @@ struct LegacyButtonConfig {
     char imgPath[32];
 };
 
-static ButtonConfig g_configs[20];
+static Deck* g_deck = nullptr;             // All pages of the active profile (resident)
+static uint8_t g_profile = 0;              // Its id in the profile list
+
+// A profile switch swaps g_deck at once (any task); the LVGL loop then
+// updates only the cells that look different and times the first frame
+struct ProfileSwitch {
+    const Deck* from;   // deck the widgets on screen were built from, nullptr: unknown
+    uint16_t from_page;
+    int64_t t0;         // tap or request time (esp_timer_get_time)
+};
+static ProfileSwitch g_switch = {};
+static volatile bool g_pending_switch = false;
+
+struct SwitchStats {
+    uint32_t count;
+    uint32_t last_us; // tap to first rendered frame
+    uint16_t cells;   // cells on screen
+    uint16_t rebuilt; // cells rebuilt (all of them when the grid was recreated)
+};
+static SwitchStats g_switch_stats = {};
+static uint16_t g_page = 0;                // Page shown on the grid
+static Button* g_configs = nullptr;        // Buttons of g_page (DECK_PAGE_SLOTS)
 static uint32_t g_bg_color = 0x000000;
 static uint8_t g_rows = 3;
 static uint8_t g_cols = 3;
+
+// Grid layouts offered on the device and in the dashboard
+struct GridSize { uint8_t cols, rows; };
+static const GridSize g_grid_sizes[] = {
+    {2, 2}, {3, 2}, {3, 3}, {4, 3}, {5, 3}, {6, 4}, {8, 4}, {8, 5}, {10, 5}, {10, 6},
+};
+#define GRID_SIZE_COUNT (sizeof(g_grid_sizes) / sizeof(g_grid_sizes[0]))
+#define GRID_MAX_COLS 10
+#define GRID_MAX_ROWS 6
+static_assert(GRID_MAX_COLS * GRID_MAX_ROWS <= DECK_PAGE_SLOTS, "largest grid must fit one deck page");
+
+static bool grid_size_supported(int cols, int rows) {
+    for (size_t i = 0; i < GRID_SIZE_COUNT; i++) {
+        if (g_grid_sizes[i].cols == cols && g_grid_sizes[i].rows == rows) return true;
+    }
+    return false;
+}
 static uint8_t g_target_os = 0; // 0: Windows, 1: macOS
 static char g_wifi_ssid[32] = "";
 static char g_wifi_pass[64] = "";
 static uint8_t g_kb_lang = 0; // 0: US, 1: Spanish
+static uint32_t g_config_gen = 0; // see config_changed()
+static uint32_t g_boot_id = 0;
 static String g_wifi_status = "Disconnected";
 static String g_ip_addr = "0.0.0.0";
 
@@ -187,6 +262,22 @@ static lv_obj_t* g_update_label = nullptr;
 static lv_obj_t* g_update_pct_label = nullptr;
 static volatile int g_ota_pct = -2; // -2: Idle, -1: Indeterminate, 0-100: Progress
 static String g_ota_msg = "";
+static volatile bool g_atlas_dirty = true; // Referenced images or library changed
+static bool g_atlas_enabled = true;        // Draw button images from the icon atlas
+static bool g_style_pool_enabled = true;   // Share interned styles between grid cells
+static bool g_prerender_enabled = true;    // Show unchanged cells as cached snapshots
+static volatile bool g_prerender_stale = true; // Image files changed: snapshots may be outdated
+static volatile bool g_pending_bench = false;
+static volatile uint32_t g_restart_at = 0; // millis() of a pending restart, 0: none
+static volatile bool g_restore_busy = false; // a restore job is queued or running
+static volatile bool g_profile_busy = false; // a profile add/delete job is queued or running
+// Jobs hand what changes the decks to loop(), where the grid reads them
+static void (*volatile g_loop_fn)(void*) = nullptr;
+static void* g_loop_arg = nullptr;
+static SemaphoreHandle_t g_loop_done = nullptr; // given by loop() once g_loop_fn ran
+static uint8_t g_bench_cols = 0, g_bench_rows = 0; // Benchmark grid override, 0: current grid
+static bool g_bench_all = false;                   // Benchmark every supported grid size
+static String g_bench_json = "{}";
 
 // Forward Declarations
 static void show_update_screen();
@@ -232,6 +323,18 @@ static int get_index_by_symbol(const char* sym) {
     return 0;
 }
 
+// Profile files and dot-files (atlas cache, etc.) are internal: not listed,
+// not selectable as images, not deletable and not part of the asset backup.
+static bool is_system_file(String name) {
+    if (name.startsWith("/")) name = name.substring(1);
+    return name == "win_btns.bin" || name == "mac_btns.bin" || name == "profiles.json" ||
+           name.startsWith("prof_") || name.startsWith(".");
+}
+
+static bool bundle_allowed(const char* path) {
+    return !is_system_file(path);
+}
+
 // ==========================================
 // KEYBOARD WRITING LOGIC
 // ==========================================
@@ -382,13 +485,21 @@ static void create_main_ui();
 static void create_settings_ui();
 static void create_edit_ui(uint8_t idx);
 static void create_wifi_ui();
+static void wifi_ui_tick();
+static void wifi_ui_event(const WifiEvent& ev);
 static void load_settings();
 static void save_settings(bool saveButtons = true);
+static void config_changed();
 static void show_update_screen();
 static void check_bluetooth_internal();
 static void check_wifi_internal();
 static void init_webserver(); // Start Asset & Config Server
+static void run_grid_bench();
+static bool select_profile(uint8_t id, int64_t t0);
+static void apply_profile_switch();
 static void btn_event_cb(lv_event_t *e);
+static void page_nav_cb(lv_event_t *e);
+static void page_gesture_cb(lv_event_t *e);
 static void slider_event_cb(lv_event_t *e);
 static void settings_btn_cb(lv_event_t *e);
 static void settings_wifi_btn_cb(lv_event_t* e);
@@ -409,12 +520,20 @@ static int get_index_by_symbol(const char* sym);
 // STORAGE LOGIC
 // ==========================================
 static void load_settings() {
-    preferences.begin("deck", false);
+    persist_flush(); // Staged edits first: they may belong to the file read below
+    config_changed();
+    preferences.begin(PERSIST_NVS_NAMESPACE, false);
     g_rows = preferences.getUChar("rows", 3);
     g_cols = preferences.getUChar("cols", 3);
+    persist_nvs_u8("rows", g_rows, true);
+    persist_nvs_u8("cols", g_cols, true);
+    if (!grid_size_supported(g_cols, g_rows)) { g_cols = 3; g_rows = 3; }
     g_target_os = preferences.getUChar("os", 0);
     g_kb_lang = preferences.getUChar("lang", 0);
     g_bg_color = preferences.getUInt("bg", 0x121212);
+    persist_nvs_u8("os", g_target_os, true);
+    persist_nvs_u8("lang", g_kb_lang, true);
+    persist_nvs_u32("bg", g_bg_color, true);
     
     // Safety check: if bg_color is pure black, default to dark grey to avoid "black screen" confusion
     if (g_bg_color == 0x000000) g_bg_color = 0x121212;
@@ -464,152 +583,237 @@ static void load_settings() {
     if (!preferences.getBool("init_os_v4", false)) {
         Serial.println("Initial Profile Setup (v4 LittleFS): Migrating...");
         
-        auto set_defaults = []() {
-            for(int i=0; i<20; i++) {
-                memset(&g_configs[i], 0, sizeof(ButtonConfig));
-                g_configs[i].color = 0x333333;
-                strncpy(g_configs[i].label, "Button", 15);
-            }
+        // NVS blobs hold fixed ButtonConfig records: read them into an edit buffer
+        std::vector<ButtonConfig> tmp(20);
+        auto set_defaults = [&]() {
+            for (ButtonConfig& b : tmp) deck_default_button(b);
+        };
+        auto save_profile = [&](const char* path) {
+            Deck deck;
+            deck_init(deck, 1);
+            for (int i = 0; i < 20; i++) deck_set(deck, i, tmp[i]);
+            deck_save(deck, path);
+            deck_free(deck);
         };
 
         // Migrate Windows Settings to File
         set_defaults();
-        if (preferences.getBytes("w_pA", &g_configs[0], 10 * sizeof(ButtonConfig)) > 0) {
-            preferences.getBytes("w_pB", &g_configs[10], 10 * sizeof(ButtonConfig));
+        if (preferences.getBytes("w_pA", &tmp[0], 10 * sizeof(ButtonConfig)) > 0) {
+            preferences.getBytes("w_pB", &tmp[10], 10 * sizeof(ButtonConfig));
         } else {
             for(int i=0; i<20; i++) {
                 char k1[8], k2[8];
                 sprintf(k1, "b%d", i); sprintf(k2, "wb%d", i);
-                if (preferences.getBytes(k2, &g_configs[i], sizeof(ButtonConfig)) == 0)
-                    preferences.getBytes(k1, &g_configs[i], sizeof(ButtonConfig));
+                if (preferences.getBytes(k2, &tmp[i], sizeof(ButtonConfig)) == 0)
+                    preferences.getBytes(k1, &tmp[i], sizeof(ButtonConfig));
             }
         }
-        File f = LittleFS.open(win_file, "w");
-        if (f) { f.write((uint8_t*)g_configs, sizeof(g_configs)); f.close(); }
+        save_profile(win_file);
 
         // Migrate Mac Settings to File
         set_defaults();
-        if (preferences.getBytes("m_pA", &g_configs[0], 10 * sizeof(ButtonConfig)) > 0) {
-            preferences.getBytes("m_pB", &g_configs[10], 10 * sizeof(ButtonConfig));
+        if (preferences.getBytes("m_pA", &tmp[0], 10 * sizeof(ButtonConfig)) > 0) {
+            preferences.getBytes("m_pB", &tmp[10], 10 * sizeof(ButtonConfig));
         } else {
             for(int i=0; i<20; i++) {
                 char k3[8]; sprintf(k3, "mb%d", i);
-                preferences.getBytes(k3, &g_configs[i], sizeof(ButtonConfig));
+                preferences.getBytes(k3, &tmp[i], sizeof(ButtonConfig));
             }
         }
-        f = LittleFS.open(mac_file, "w");
-        if (f) { f.write((uint8_t*)g_configs, sizeof(g_configs)); f.close(); }
+        save_profile(mac_file);
 
         preferences.putBool("init_os_v4", true);
         Serial.println("STORAGE: Migration to LittleFS files complete.");
     }
 
-    // Load Buttons for current OS
-    const char* active_file = (g_target_os == 0 ? win_file : mac_file);
-    // Serial.printf("STORAGE: Loading file: %s... ", active_file);
-    File f = LittleFS.open(active_file, "r");
-    if (f) {
-        size_t read = f.read((uint8_t*)g_configs, sizeof(g_configs));
-        f.close();
-        if (read == sizeof(g_configs)) {
-            Serial.println("OK");
-        } else {
-            Serial.println("FAIL (size mismatch)");
-            goto load_defaults;
-        }
-    } else {
-        Serial.println("NOT FOUND");
-        load_defaults:
-        for(int i=0; i<20; i++) {
-            memset(&g_configs[i], 0, sizeof(ButtonConfig));
-            g_configs[i].color = 0x333333;
-            strncpy(g_configs[i].label, "Button", 15);
-        }
-    }
+    // Every profile stays resident; before profiles existed the OS picked the deck
+    profiles_load();
+    g_profile = preferences.getUChar("prof", g_target_os);
+    if (g_profile >= profile_count()) g_profile = 0;
+    persist_nvs_u8("prof", g_profile, true);
+    Profile* active = profile_get(g_profile);
+    g_deck = &active->deck;
+    g_target_os = active->os;
+    persist_deck_loaded(*g_deck, active->path);
+    if (g_page >= g_deck->page_count) g_page = g_deck->page_count - 1;
+    g_configs = deck_page(*g_deck, g_page);
 
     preferences.getString("wssid", g_wifi_ssid, 31);
     preferences.getString("wpass", g_wifi_pass, 63);
     preferences.end();
+    persist_nvs_str("wssid", g_wifi_ssid, true);
+    persist_nvs_str("wpass", g_wifi_pass, true);
+    g_atlas_dirty = true;
     
-    if (strlen(g_wifi_ssid) > 0) {
-        WiFi.begin(g_wifi_ssid, g_wifi_pass);
-    }
+    wifi_mgr_connect(g_wifi_ssid, g_wifi_pass);
 }
 
+// Stages the settings (and the active deck); the persist task writes what
+// actually changed once edits stop arriving
 static void save_settings(bool saveButtons) {
+    config_changed();
     // Serial.printf("Saving settings (buttons=%s)...\n", saveButtons ? "YES" : "NO");
-    preferences.begin("deck", false);
-    preferences.putUInt("bg", g_bg_color);
-    preferences.putUChar("rows", g_rows);
-    preferences.putUChar("cols", g_cols);
-    preferences.putUChar("os", g_target_os);
-    preferences.putUChar("lang", g_kb_lang);
-    preferences.putString("wssid", g_wifi_ssid);
-    preferences.putString("wpass", g_wifi_pass);
-    preferences.end();
+    persist_nvs_u32("bg", g_bg_color);
+    persist_nvs_u8("rows", g_rows);
+    persist_nvs_u8("cols", g_cols);
+    persist_nvs_u8("os", g_target_os);
+    persist_nvs_u8("prof", g_profile);
+    persist_nvs_u8("lang", g_kb_lang);
+    persist_nvs_str("wssid", g_wifi_ssid);
+    persist_nvs_str("wpass", g_wifi_pass);
 
     if (saveButtons) {
-        const char* active_file = (g_target_os == 0 ? "/win_btns.bin" : "/mac_btns.bin");
-        File f = LittleFS.open(active_file, "w");
-        if (f) {
-            f.write((uint8_t*)g_configs, sizeof(g_configs));
-            f.close();
-            // Serial.printf("STORAGE: Buttons saved to %s\n", active_file);
-        } else {
-            Serial.printf("STORAGE ERROR: Failed to open %s for writing\n", active_file);
-        }
+        g_atlas_dirty = true;
+        persist_deck_changed(*g_deck, profile_get(g_profile)->path);
+    }
+    persist_request();
+}
+
+// Footprint of a profile as fixed ButtonConfig records vs packed buttons
+static String footprint_json(const DeckFootprint& f) {
+    return "{\"slots\":" + String(f.slots) + ",\"custom\":" + String(f.custom) +
+           ",\"strings\":" + String(f.strings) + ",\"ram_fixed\":" + String(f.ram_fixed) +
+           ",\"ram_packed\":" + String(f.ram_packed) + ",\"flash_fixed\":" + String(f.flash_fixed) +
+           ",\"flash_packed\":" + String(f.flash_packed) + "}";
+}
+
+// A plausible profile of `count` customized buttons: shortcuts, media keys,
+// app launches and URLs, with the repetition real decks have
+static bool build_sample_deck(Deck& d, uint16_t count) {
+    static const char* labels[] = { "Mute", "Vol+", "Vol-", "Play", "Next", "Prev", "Copy", "Paste",
+                                    "Cut", "Undo", "Save", "Chrome", "Terminal", "Slack", "Mail", "OBS",
+                                    "Scene 1", "Scene 2", "Record", "Lock" };
+    static const char* values[] = { "MUTE", "VOL_UP", "VOL_DOWN", "PLAY_PAUSE", "NEXT", "PREV", "CTRL+C", "CTRL+V",
+                                    "CTRL+X", "CTRL+Z", "CTRL+S", "chrome", "wt", "slack", "outlook",
+                                    "https://github.com/Disttrack/PandaTouch_streamDeck", "CTRL+SHIFT+F1",
+                                    "CTRL+SHIFT+F2", "CTRL+SHIFT+R", "GUI+L" };
+    uint16_t pages = (count + DECK_PAGE_SLOTS - 1) / DECK_PAGE_SLOTS;
+    if (pages > DECK_MAX_PAGES) pages = DECK_MAX_PAGES;
+    if (!deck_init(d, pages)) return false;
+    for (uint16_t i = 0; i < count && i < (size_t)pages * DECK_PAGE_SLOTS; i++) {
+        ButtonConfig b;
+        deck_default_button(b);
+        uint8_t k = i % 20;
+        strncpy(b.label, labels[k], sizeof(b.label) - 1);
+        strncpy(b.value, values[k], sizeof(b.value) - 1);
+        b.type = k % 4;
+        b.color = 0x202020 + (i % 6) * 0x101010;
+        strncpy(b.icon, g_sym_codes[k], sizeof(b.icon) - 1);
+        if (i % 4 == 0) snprintf(b.imgPath, sizeof(b.imgPath), "/icon_%u.png", (unsigned)(i % 12));
+        if (!deck_set(d, i, b)) return false;
     }
+    return true;
 }
 
 // ==========================================
 // PUBLIC API IMPLEMENTATION
 // ==========================================
+// Main screen as last shown, saved for the next boot (see splash.h)
+static uint32_t g_main_render_ms = 0;
+static bool g_splash_dirty = false;
+
+static void main_render_cb(lv_event_t* e) {
+    if (lv_scr_act() != g_main_screen) return;
+    g_main_render_ms = millis();
+    g_splash_dirty = true;
+}
+
+static void update_splash() {
+    if (!g_splash_dirty || lv_scr_act() != g_main_screen || splash_busy()) return;
+    if (millis() - g_main_render_ms < SPLASH_SETTLE_MS) return;
+    if (lv_display_get_inactive_time(NULL) < SPLASH_SETTLE_MS) return; // A pressed button would be saved pressed
+    g_splash_dirty = false;
+    splash_capture(panel_framebuffer(), lv_display_get_horizontal_resolution(NULL),
+                   lv_display_get_vertical_resolution(NULL));
+}
+
+// Filesystem, then BLE, on core 0 while the panel comes up on core 1
+#define BOOT_FS_READY  (1 << 0)
+#define BOOT_SPLASH_WAIT_MS 300 // a first-boot format takes longer: no splash then
+static EventGroupHandle_t g_boot_events = nullptr;
+
+static void init_ble() {
+    // Security NONE: no pairing, avoids the SMP errors with Windows
+    BLEDevice::init("PandaTouch Deck");
+    BLESecurity *pSecurity = new BLESecurity();
+    pSecurity->setAuthenticationMode(ESP_LE_AUTH_NO_BOND);
+    pSecurity->setCapability(ESP_IO_CAP_NONE);
+    pSecurity->setInitEncryptionKey(ESP_BLE_ENC_KEY_MASK | ESP_BLE_ID_KEY_MASK);
+    bleKeyboard.begin();
+    Serial.println("BLE Keyboard advertising as PandaTouch Deck (no pairing required)");
+}
+
+static void boot_task(void*) {
+    boot_phase_start(BOOT_FS);
+    if (!LittleFS.begin(true)) Serial.println("LittleFS Mount Failed");
+    boot_phase_end(BOOT_FS);
+    xEventGroupSetBits(g_boot_events, BOOT_FS_READY);
+
+    boot_phase_start(BOOT_BLE);
+    init_ble();
+    boot_phase_end(BOOT_BLE);
+    vTaskDelete(NULL);
+}
+
+void StreamDeckApp::early_setup() {
+    if (g_boot_events) return;
+    // WiFi mode first: it sets up the TCP/IP stack the web server relies on
+    wifi_mgr_begin();
+
+    // Credentials only: association runs while the rest boots
+    preferences.begin(PERSIST_NVS_NAMESPACE, true);
+    preferences.getString("wssid", g_wifi_ssid, 31);
+    preferences.getString("wpass", g_wifi_pass, 63);
+    preferences.end();
+    wifi_mgr_connect(g_wifi_ssid, g_wifi_pass);
+
+    g_boot_events = xEventGroupCreate();
+    xTaskCreatePinnedToCore(boot_task, "boot", 8192, NULL, 2, NULL, 0);
+}
+
+bool StreamDeckApp::draw_splash(uint16_t* fb, uint16_t w, uint16_t h) {
+    if (!g_boot_events) return false;
+    EventBits_t bits = xEventGroupWaitBits(g_boot_events, BOOT_FS_READY, pdFALSE, pdTRUE, pdMS_TO_TICKS(BOOT_SPLASH_WAIT_MS));
+    if (!(bits & BOOT_FS_READY) || !splash_draw(fb, w, h)) return false;
+    Serial.printf("BOOT: splash drawn in %u ms\n", (unsigned)(splash_stats().draw_us / 1000));
+    return true;
+}
+
 void StreamDeckApp::setup() {
-    // CRITICAL: Initialize WiFi mode FIRST to set up TCP/IP stack
-    // This must happen before AsyncWebServer (global variable) tries to use it
-    WiFi.mode(WIFI_STA);
-    
-    // 0. LittleFS
-    if(!LittleFS.begin(true)){
-        Serial.println("LittleFS Mount Failed");
-    } else {
-        Serial.println("LittleFS Mounted Successfully. Files:");
-        File root = LittleFS.open("/");
-        File file = root.openNextFile();
-        while(file){
-            // Serial.printf(" - %s (%d bytes)\n", file.name(), file.size());
-            file = root.openNextFile();
-        }
+    early_setup();
+
+    // 0. LittleFS (mounted by the boot task)
+    xEventGroupWaitBits(g_boot_events, BOOT_FS_READY, pdFALSE, pdTRUE, portMAX_DELAY);
+
+    // Optional raw "assets" partition: icons drawn straight from mapped flash
+    if (asset_store_begin()) {
+        Serial.printf("Asset partition mapped: %u images\n", asset_store_count());
     }
 
     // 1. Storage & Config
+    g_boot_id = esp_random();
+    boot_phase_start(BOOT_CONFIG);
+    persist_begin();
+    jobs_begin();
+    upload_begin();
     load_settings();
+    boot_phase_end(BOOT_CONFIG);
 
     // 2. Init UI
+    boot_phase_start(BOOT_UI);
     g_main_screen = lv_scr_act();
+    lv_obj_add_event_cb(g_main_screen, page_gesture_cb, LV_EVENT_GESTURE, NULL);
     create_main_ui();
+    boot_phase_end(BOOT_UI);
 
-    Serial.println("StreamDeckApp::setup() - Starting BLE initialization");
-    
-    // 2. Configure BLE security - disable to avoid Windows SMP issues
-    delay(500); // Give system time to stabilize
-    Serial.println("Setting BLE security to NONE...");
-    
-    // Set security to open (no pairing required)
-    // This fixes the SMP errors with Windows
-    BLEDevice::init("PandaTouch Deck");
-    BLESecurity *pSecurity = new BLESecurity();
-    pSecurity->setAuthenticationMode(ESP_LE_AUTH_NO_BOND);
-    pSecurity->setCapability(ESP_IO_CAP_NONE);
-    pSecurity->setInitEncryptionKey(ESP_BLE_ENC_KEY_MASK | ESP_BLE_ID_KEY_MASK);
-    
-    // 3. Start BLE Keyboard
-    Serial.println("Calling bleKeyboard.begin()...");
-    bleKeyboard.begin();
-    Serial.println("bleKeyboard.begin() completed");
-    Serial.println("BLE Keyboard initialized. Device name: PandaTouch Deck");
-    Serial.println("Security: NO PAIRING REQUIRED");
-    Serial.println("Waiting for Bluetooth connection...");
+    lv_display_add_event_cb(lv_display_get_default(), main_render_cb, LV_EVENT_RENDER_READY, NULL);
+
+    boot_phase_start(BOOT_FIRST_FRAME);
+    lv_refr_now(NULL);
+    boot_phase_end(BOOT_FIRST_FRAME);
+    boot_mark_usable();
+
+    // 3. BLE Keyboard: started by the boot task, may still be coming up
 
     // 4. Init OTA
     ArduinoOTA.onStart([]() {
@@ -646,8 +850,27 @@ void StreamDeckApp::loop() {
         lv_scr_load(g_main_screen);
         create_main_ui();
     }
+    if (g_loop_fn) {
+        void (*fn)(void*) = g_loop_fn;
+        g_loop_fn = nullptr;
+        fn(g_loop_arg);
+        xSemaphoreGive(g_loop_done);
+    }
+    apply_profile_switch();
+    update_splash();
+
+    if (g_pending_bench) {
+        g_pending_bench = false;
+        run_grid_bench();
+    }
     
     ArduinoOTA.handle();
+
+    if (g_restart_at && (int32_t)(millis() - g_restart_at) >= 0) {
+        persist_flush();
+        Serial.flush();
+        ESP.restart();
+    }
     
     // Small delay to prevent watchdog timeout
     delay(1);
@@ -659,8 +882,8 @@ void StreamDeckApp::handle_button(uint8_t idx) {
         return;
     }
 
-    if (idx >= 20) return;
-    ButtonConfig &cfg = g_configs[idx];
+    if (idx >= DECK_PAGE_SLOTS) return;
+    const Button &cfg = g_configs[idx];
     // Serial.printf("Executing Button %d: %s (Type: %d)\n", idx, cfg.label, cfg.type);
 
     if (cfg.type == 0) { // Command (Win+R / Cmd+Space)
@@ -714,14 +937,19 @@ void StreamDeckApp::handle_button(uint8_t idx) {
 // ==========================================
 static void check_wifi_internal() {
     static bool was_connected = false;
-    static unsigned long last_wifi_check = 0;
-    
-    if (millis() - last_wifi_check < 2000) return;
-    last_wifi_check = millis();
 
-    bool is_connected = (WiFi.status() == WL_CONNECTED);
-    
-    if (is_connected != was_connected) {
+    wifi_mgr_loop();
+    wifi_ui_tick();
+
+    WifiEvent ev;
+    while (wifi_mgr_poll_event(ev)) {
+        if (g_wifi_screen && lv_scr_act() == g_wifi_screen) wifi_ui_event(ev);
+
+        bool is_connected = was_connected;
+        if (ev.kind == WIFI_EV_GOT_IP) is_connected = true;
+        else if (ev.kind == WIFI_EV_DISCONNECTED || ev.kind == WIFI_EV_CONNECTING) is_connected = false;
+        if (is_connected == was_connected) continue;
+
         if (is_connected) {
             g_wifi_status = "Connected";
             g_ip_addr = WiFi.localIP().toString();
@@ -743,83 +971,514 @@ static void check_wifi_internal() {
     }
 }
 
+// ==========================================
+// /api/config STREAM
+// ==========================================
+// Bumped whenever something /api/config reports may have changed; with a
+// per-boot id it forms the ETag, so an unchanged config costs a 304
+static void config_changed() {
+    g_config_gen++;
+}
+
+static String config_etag(uint16_t page, bool gzip) {
+    char tag[40];
+    snprintf(tag, sizeof(tag), "\"%08x-%u-%u%s\"", (unsigned)g_boot_id, (unsigned)g_config_gen, page, gzip ? "-gz" : "");
+    return tag;
+}
+
+#define CONFIG_PART_MAX 2048 // one button with every field escaped as \u00XX still fits
+
+// The response is produced one part (header, a profile, a button, footer)
+// at a time, straight into the TCP send buffer, optionally gzipped
+struct ConfigStream {
+    AsyncClient* client;
+    uint16_t page;
+    uint32_t gen;
+    uint16_t part = 0;
+    bool done = false;
+    char text[CONFIG_PART_MAX];
+    JsonWriter w{text, sizeof(text)};
+    GzipStream* gz = nullptr;
+    uint8_t* zbuf = nullptr;   // GZIP_BOUND(CONFIG_PART_MAX) + GZIP_TRAILER_MAX
+    const uint8_t* out = nullptr;
+    size_t out_len = 0;
+
+    ~ConfigStream() {
+        if (gz) gzip_destroy(gz);
+        free(zbuf);
+    }
+
+    void write_part() {
+        uint8_t profiles = profile_count();
+        uint16_t first_button = 2 + profiles;
+        w.clear();
+        if (part == 0) {
+            w.begin_object();
+            w.hex("bg", g_bg_color).num("rows", g_rows).num("cols", g_cols).num("os", g_target_os).num("lang", g_kb_lang);
+            w.num("page", page).num("pages", g_deck->page_count).num("profile", g_profile);
+            w.begin_array("profiles");
+        } else if (part <= profiles) {
+            const Profile* p = profile_get(part - 1);
+            w.begin_object().str("name", p->name).num("os", p->os).end_object();
+        } else if (part == 1 + profiles) {
+            w.end_array().begin_array("buttons");
+        } else if (part < first_button + DECK_PAGE_SLOTS) {
+            const Button& b = deck_page(*g_deck, page)[part - first_button];
+            const char* icon = "None";
+            for (int j = 0; j < 20 && b.icon[0]; j++) {
+                if (strcmp(b.icon, g_sym_codes[j]) == 0) { icon = g_sym_names[j]; break; }
+            }
+            w.begin_object().str("label", b.label).str("value", b.value).num("type", b.type);
+            w.hex("color", b.color).str("icon", icon).str("img", b.imgPath).end_object();
+        } else {
+            w.end_array().end_object();
+            done = true;
+        }
+        part++;
+    }
+
+    // Next piece of output; false once everything was handed out
+    bool produce() {
+        if (done) return false;
+        // Edited, reloaded or switched meanwhile: rather than mix two configs or end a
+        // truncated body normally, drop the connection so the fetch fails and is retried.
+        // abort() only queues the disconnect, the request outlives this call.
+        if (gen != g_config_gen) {
+            Serial.println("API: config changed while it was sent, connection dropped");
+            client->abort();
+            done = true;
+            return false;
+        }
+        write_part();
+        if (!gz) {
+            out = (const uint8_t*)w.data();
+            out_len = w.size();
+            return true;
+        }
+        out_len = gzip_write(gz, w.data(), w.size(), zbuf);
+        if (done) out_len += gzip_finish(gz, zbuf + out_len);
+        out = zbuf;
+        return true;
+    }
+
+    size_t fill(uint8_t* buf, size_t max) {
+        size_t n = 0;
+        while (n < max) {
+            if (out_len == 0) {
+                if (!produce()) break;
+                continue;
+            }
+            size_t k = out_len < max - n ? out_len : max - n;
+            memcpy(buf + n, out, k);
+            n += k;
+            out += k;
+            out_len -= k;
+        }
+        return n;
+    }
+};
+
+// /api/ui: dashboard texts in the UI language plus what the page needs from
+// the firmware. Only changes with the firmware, so it is built once per
+// language and revalidated by ETag.
+#define UI_JSON_MAX 6144
+
+static const char* ui_json(uint8_t lang, size_t* len) {
+    static char* cache[2] = { nullptr, nullptr };
+    static size_t cache_len[2] = { 0, 0 };
+    if (lang > 1) lang = 0;
+    if (cache[lang]) { *len = cache_len[lang]; return cache[lang]; }
+
+    char* buf = (char*)heap_caps_malloc(UI_JSON_MAX, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!buf) return nullptr;
+    const L10n* l = (lang == 1) ? &g_l10n_es : &g_l10n_en;
+    JsonWriter w(buf, UI_JSON_MAX);
+    w.begin_object();
+    w.str("version", PANDA_VERSION);
+    w.num("lang", lang);
+    w.num("slots", DECK_PAGE_SLOTS);
+    w.num("builtin", PROFILE_BUILTIN);
+    w.begin_array("grids");
+    for (size_t g = 0; g < GRID_SIZE_COUNT; g++) {
+        char v[8];
+        snprintf(v, sizeof(v), "%ux%u", g_grid_sizes[g].cols, g_grid_sizes[g].rows);
+        w.str(nullptr, v);
+    }
+    w.end_array();
+    w.begin_object("symbols");
+    for (int j = 0; j < 20; j++) w.str(g_sym_names[j], g_sym_codes[j]);
+    w.end_object();
+    w.begin_object("text");
+#define UI_TEXT(f) w.str(#f, l->f)
+    UI_TEXT(dash_title); UI_TEXT(kb_label); UI_TEXT(os_label); UI_TEXT(add_profile); UI_TEXT(remove_profile);
+    UI_TEXT(grid_label); UI_TEXT(bg_label); UI_TEXT(btn_config); UI_TEXT(page_label); UI_TEXT(add_page);
+    UI_TEXT(remove_page); UI_TEXT(save_changes); UI_TEXT(backup_title); UI_TEXT(backup_btn); UI_TEXT(restore_btn);
+    UI_TEXT(firmware_title); UI_TEXT(firmware_info); UI_TEXT(update_btn); UI_TEXT(library); UI_TEXT(upload);
+    UI_TEXT(button_label); UI_TEXT(btn_name_ph); UI_TEXT(btn_cmd_ph); UI_TEXT(type_app); UI_TEXT(type_media);
+    UI_TEXT(type_basic); UI_TEXT(type_adv); UI_TEXT(basic_combo_desc); UI_TEXT(color_title); UI_TEXT(icon_title);
+    UI_TEXT(image_title); UI_TEXT(profile_name); UI_TEXT(delete_file_confirm); UI_TEXT(none); UI_TEXT(select_key_ph);
+    UI_TEXT(config_saved); UI_TEXT(confirm_restore); UI_TEXT(restore_ok); UI_TEXT(update_firmware_confirm);
+#undef UI_TEXT
+    w.end_object();
+    w.end_object();
+    if (w.overflowed()) {
+        Serial.println("API: /api/ui does not fit UI_JSON_MAX");
+        heap_caps_free(buf);
+        return nullptr;
+    }
+    cache[lang] = buf;
+    cache_len[lang] = w.size();
+    *len = w.size();
+    return buf;
+}
+
+static String ui_etag(uint8_t lang) {
+    // Texts are compiled in: the build time tells firmwares with one version apart
+    static const char build[] = __DATE__ " " __TIME__;
+    char tag[48];
+    snprintf(tag, sizeof(tag), "\"%s-%u-%08x\"", PANDA_VERSION, lang, (unsigned)crc32_update(0, build, sizeof(build)));
+    return tag;
+}
+
+static String escape_json(String s) {
+    s.replace("\\", "\\\\");
+    s.replace("\"", "\\\"");
+    s.replace("\n", "\\n");
+    s.replace("\r", "\\r");
+    s.replace("\t", "\\t");
+    return s;
+}
+
+// `base` (taken over): a differential archive against that manifest
+static void send_backup(AsyncWebServerRequest *request, BackupFormat format, BackupBase* base = nullptr) {
+    // Files below must include the latest edits; the flush task writes them
+    if (!persist_sync()) {
+        backup_base_destroy(base);
+        request->send(503, "text/plain", "Busy: settings are still being written");
+        return;
+    }
+    BackupSettings s = { g_bg_color, g_rows, g_cols, g_target_os, g_profile, g_kb_lang, g_wifi_ssid };
+    std::shared_ptr<BackupStream> bs(backup_create(s, [](const char* name) { return is_system_file(name); }, format, base),
+                                     backup_destroy);
+    if (!bs) { request->send(503, "text/plain", "Out of memory"); return; }
+    uint32_t gen = g_config_gen;
+    AsyncWebServerResponse *response = request->beginChunkedResponse(format == BACKUP_BIN ? "application/octet-stream" : "application/json",
+        [bs, gen](uint8_t *buf, size_t maxLen, size_t index) -> size_t {
+            // Reloaded or a profile removed meanwhile: cut it short, a truncated backup fails to restore
+            if (gen != g_config_gen) return 0;
+            return backup_read(bs.get(), buf, maxLen);
+        });
+    if (format == BACKUP_JSON) response->addHeader("Content-Disposition", "attachment; filename=\"pandadeck_backup.json\"");
+    else if (format == BACKUP_BIN) response->addHeader("Content-Disposition", base ? "attachment; filename=\"pandadeck_diff.pdbak\""
+                                                                               : "attachment; filename=\"pandadeck_backup.pdbak\"");
+    response->addHeader("Cache-Control", "no-store");
+    request->send(response);
+}
+
+// Body handler of POST /api/backup.bin: the manifest of the previous backup
+static void backup_body(AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
+    static BackupBase* base = nullptr;
+    static bool base_failed = false;
+    if (index == 0) {
+        backup_base_destroy(base); // An earlier upload that never finished
+        base = backup_base_create();
+        base_failed = !base;
+    }
+    if (!base_failed && !backup_base_feed(base, data, len)) base_failed = true;
+    if (index + len != total) return;
+
+    if (!base) {
+        request->send(503, "text/plain", "Out of memory");
+        return;
+    }
+    if (base_failed || !backup_base_finish(base)) {
+        request->send(400, "text/plain", String("Invalid manifest: ") + backup_base_error(base));
+        backup_base_destroy(base);
+        base = nullptr;
+        return;
+    }
+    BackupBase* b = base;
+    base = nullptr;
+    send_backup(request, BACKUP_BIN, b);
+}
+
+// Job task: runs `fn(arg)` on loop() and waits for it
+static void run_on_loop(void (*fn)(void*), void* arg) {
+    if (!g_loop_done) g_loop_done = xSemaphoreCreateBinary(); // Only the job task gets here
+    g_loop_arg = arg;
+    g_loop_fn = fn;
+    xSemaphoreTake(g_loop_done, portMAX_DELAY);
+}
+
+// Jobs queued to rebuild decks: edits from the web would race them
+static bool decks_busy(AsyncWebServerRequest* request) {
+    if (!g_restore_busy && !g_profile_busy) return false;
+    request->send(409, "text/plain", g_restore_busy ? "Restore in progress" : "Profile change in progress");
+    return true;
+}
+
+// The job only does the flash work; the decks are freed and reloaded by
+// loop() while the job waits for it
+struct RestoreApply {
+    RestoreStream* rs;
+    RestoreSettings st;
+};
+
+// loop(): reloads the profiles as the restored list has them
+static void apply_restore(void* arg) {
+    RestoreStream* rs = ((RestoreApply*)arg)->rs;
+    const RestoreSettings& st = ((RestoreApply*)arg)->st;
+    persist_flush(); // Edits made on the device meanwhile are bound to the old decks
+    restore_destroy(rs);
+    // Removed profiles shift the ids: the active one is found again by file
+    char active[PROFILE_PATH_LEN];
+    strcpy(active, profile_get(g_profile)->path);
+    g_switch.from = nullptr; // Its deck may not survive the reload
+
+    if (st.has_bg) g_bg_color = st.bg;
+    uint8_t rows = st.rows ? st.rows : g_rows, cols = st.cols ? st.cols : g_cols;
+    if (grid_size_supported(cols, rows)) {
+        g_rows = rows;
+        g_cols = cols;
+    }
+    if (st.has_lang) g_kb_lang = st.lang;
+    if (st.has_ssid) strncpy(g_wifi_ssid, st.wifi_ssid, 31);
+    if (st.has_pass) strncpy(g_wifi_pass, st.wifi_pass, 63);
+
+    // Backups from before named profiles only know the OS
+    if (st.has_profile) g_profile = st.profile;
+    else if (st.has_os) g_profile = st.os == 1 ? 1 : 0;
+
+    save_settings(false); // Save globals
+    load_settings();     // Reload every resident profile
+    if (!st.has_profile && !st.has_os) {
+        for (uint8_t id = 0; id < profile_count(); id++) {
+            if (!strcmp(profile_get(id)->path, active)) select_profile(id, esp_timer_get_time());
+        }
+    }
+    g_atlas_dirty = true;
+    g_prerender_stale = true;
+    g_pending_ui_update = true;
+}
+
+// Job: everything a restore does once the upload is complete and parsed
+static bool restore_job(void* arg, char* result, size_t result_len) {
+    RestoreStream* rs = (RestoreStream*)arg;
+    RestoreSettings st;
+    persist_flush(); // Pending edits must not land on top of the restored files
+    job_progress(10);
+    if (!restore_commit(rs, st)) {
+        snprintf(result, result_len, "Invalid backup: %s", restore_error(rs));
+        Serial.printf("RESTORE: %s\n", result);
+        restore_destroy(rs);
+        g_restore_busy = false;
+        return false;
+    }
+    icon_atlas_invalidate(); // Restored assets may keep their names and sizes
+    job_progress(50);
+
+    RestoreApply apply = { rs, st };
+    run_on_loop(apply_restore, &apply);
+    g_restore_busy = false;
+    snprintf(result, result_len, "Restore OK");
+    return true;
+}
+
+// POST /api/profiles, run by a job
+struct ProfileOp {
+    bool remove;
+    uint8_t id;                  // remove: the profile
+    char name[PROFILE_NAME_LEN]; // add
+    uint8_t os;
+    bool copy;                   // add: seeded with the active profile's buttons
+    int result;                  // add: the new id, -1 on failure
+};
+
+// loop(): changes the list while nothing draws a deck
+static void apply_profile_op(void* arg) {
+    ProfileOp* op = (ProfileOp*)arg;
+    if (!op->remove) {
+        op->result = profile_add(op->name, op->os, op->copy ? g_deck : nullptr);
+        if (op->result >= 0) {
+            config_changed();
+            g_atlas_dirty = true;
+        }
+        return;
+    }
+    Profile* p = profile_get(op->id);
+    if (!p || op->id < PROFILE_BUILTIN) {
+        op->result = -1;
+        return;
+    }
+    if (op->id == g_profile) select_profile(0, esp_timer_get_time());
+    // Widgets on screen may still be the deleted deck's: rebuild them whole
+    if (g_switch.from == &p->deck) g_switch.from = nullptr;
+    uint8_t active = g_profile;
+    profile_remove(op->id);
+    if (active > op->id) g_profile = active - 1;
+    save_settings(false);
+    g_atlas_dirty = true; // Drops the deleted deck's icons
+    op->result = 0;
+}
+
+static bool profile_job(void* arg, char* result, size_t result_len) {
+    ProfileOp* op = (ProfileOp*)arg;
+    run_on_loop(apply_profile_op, op);
+    bool ok = op->result >= 0;
+    if (op->remove) snprintf(result, result_len, ok ? "Deleted" : "Built-in or unknown profile");
+    else if (ok) snprintf(result, result_len, "%d", op->result); // The new id
+    else snprintf(result, result_len, "Profile list full or storage error");
+    free(op);
+    g_profile_busy = false;
+    return ok;
+}
+
+// Body handler of /api/restore and /api/restore.bin. The upload is parsed
+// here as it arrives; committing it is a job (202 + id, see /api/jobs).
+static void restore_body(AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total, bool binary) {
+    static RestoreStream* rs = nullptr;
+    static bool rs_failed = false;
+    if (index == 0) {
+        restore_destroy(rs); // An earlier upload that never finished
+        rs = nullptr;
+        // Starting another would delete the temporary files of the one being committed
+        if (!g_restore_busy) rs = restore_create(binary);
+        rs_failed = !rs;
+    }
+    if (!rs_failed && !restore_feed(rs, data, len)) rs_failed = true;
+    if (index + len != total) return;
+
+    if (!rs) {
+        if (g_restore_busy) request->send(409, "text/plain", "Restore in progress");
+        else request->send(503, "text/plain", "Out of memory");
+        return;
+    }
+    if (rs_failed) {
+        String msg = String("Invalid backup: ") + restore_error(rs);
+        Serial.printf("RESTORE: %s\n", msg.c_str());
+        restore_destroy(rs);
+        rs = nullptr;
+        request->send(400, "text/plain", msg);
+        return;
+    }
+    g_restore_busy = true;
+    uint32_t job = job_submit("restore", restore_job, rs);
+    if (!job) {
+        g_restore_busy = false;
+        restore_destroy(rs);
+        rs = nullptr;
+        request->send(503, "text/plain", "Too many jobs pending");
+        return;
+    }
+    rs = nullptr;
+    request->send(202, "application/json", "{\"job\":" + String(job) + "}");
+}
+
+static String job_json(const JobInfo& j) {
+    int64_t now = esp_timer_get_time();
+    uint32_t wait_ms = ((j.started_us ? j.started_us : now) - j.queued_us) / 1000;
+    uint32_t run_ms = j.started_us ? ((j.finished_us ? j.finished_us : now) - j.started_us) / 1000 : 0;
+    return "{\"id\":" + String(j.id) + ",\"name\":\"" + String(j.name) + "\",\"state\":\"" +
+           job_state_name(j.state) + "\",\"progress\":" + String(j.progress) + ",\"result\":\"" +
+           escape_json(j.result) + "\",\"queued_ms\":" + String(wait_ms) + ",\"run_ms\":" + String(run_ms) + "}";
+}
+
 static void init_webserver() {
     static bool started = false;
     if (started) return;
     
     // API: Get current config
     server.on("/api/config", HTTP_GET, [](AsyncWebServerRequest *request){
-        auto escape_json = [](String s) -> String {
-            s.replace("\\", "\\\\");
-            s.replace("\"", "\\\"");
-            s.replace("\n", "\\n");
-            s.replace("\r", "\\r");
-            s.replace("\t", "\\t");
-            return s;
-        };
-
-        auto find_name = [&](const char* code) -> String {
-            if (!code || code[0] == '\0') return "None";
-            for(int j=0; j<20; j++) {
-                if(strcmp(code, g_sym_codes[j]) == 0) return g_sym_names[j];
-            }
-            return "None";
-        };
+        // ?page=N selects the page to edit, default is the one on screen
+        uint16_t page = g_page;
+        if (request->hasParam("page")) page = request->getParam("page")->value().toInt();
+        if (page >= g_deck->page_count) page = g_deck->page_count - 1;
+
+        // gzip when the client takes it, unless ?gzip=0
+        bool gzip = request->hasHeader("Accept-Encoding") && request->getHeader("Accept-Encoding")->value().indexOf("gzip") >= 0;
+        if (request->hasParam("gzip") && request->getParam("gzip")->value() == "0") gzip = false;
+
+        String etag = config_etag(page, gzip);
+        if (request->hasHeader("If-None-Match") && request->getHeader("If-None-Match")->value() == etag) {
+            AsyncWebServerResponse *response = request->beginResponse(304);
+            response->addHeader("ETag", etag);
+            request->send(response);
+            return;
+        }
 
-        String json = "{\"bg\":\"" + String(g_bg_color, HEX) + "\",\"rows\":" + String(g_rows) + ",\"cols\":" + String(g_cols) + ",\"os\":" + String(g_target_os) + ",\"lang\":" + String(g_kb_lang) + ",\"buttons\":[";
-        for(int i=0; i<20; i++) {
-            json += "{\"label\":\"" + escape_json(String(g_configs[i].label)) + "\",";
-            json += "\"value\":\"" + escape_json(String(g_configs[i].value)) + "\",";
-            json += "\"type\":" + String(g_configs[i].type) + ",";
-            json += "\"color\":\"" + String(g_configs[i].color, HEX) + "\",";
-            json += "\"icon\":\"" + find_name(g_configs[i].icon) + "\",";
-            json += "\"img\":\"" + escape_json(String(g_configs[i].imgPath)) + "\"}";
-            if(i < 19) json += ",";
+        std::shared_ptr<ConfigStream> cs(new (std::nothrow) ConfigStream());
+        if (!cs) { request->send(503, "text/plain", "Out of memory"); return; }
+        cs->client = request->client();
+        cs->page = page;
+        cs->gen = g_config_gen;
+        if (gzip) {
+            cs->gz = gzip_create();
+            cs->zbuf = (uint8_t*)malloc(GZIP_BOUND(CONFIG_PART_MAX) + GZIP_TRAILER_MAX);
+            if (!cs->gz || !cs->zbuf) { request->send(503, "text/plain", "Out of memory"); return; }
         }
-        json += "]}";
-        request->send(200, "application/json", json);
+        AsyncWebServerResponse *response = request->beginChunkedResponse("application/json",
+            [cs](uint8_t *buf, size_t maxLen, size_t index) -> size_t { return cs->fill(buf, maxLen); });
+        if (gzip) response->addHeader("Content-Encoding", "gzip");
+        response->addHeader("ETag", etag);
+        response->addHeader("Cache-Control", "no-cache"); // Revalidate: 304 while unchanged
+        request->send(response);
     });
 
     // API: Update config (Simple params)
     server.on("/api/save", HTTP_POST, [](AsyncWebServerRequest *request){
+        if(decks_busy(request)) return;
         auto parse_color = [](String hex) -> uint32_t {
             if(hex.startsWith("#")) hex = hex.substring(1);
             return strtol(hex.c_str(), NULL, 16);
         };
 
         if(request->hasParam("bg", true)) g_bg_color = parse_color(request->getParam("bg", true)->value());
-        if(request->hasParam("rows", true)) g_rows = request->getParam("rows", true)->value().toInt();
-        if(request->hasParam("cols", true)) g_cols = request->getParam("cols", true)->value().toInt();
-        if(request->hasParam("os", true)) g_target_os = request->getParam("os", true)->value().toInt();
+        int rows = request->hasParam("rows", true) ? request->getParam("rows", true)->value().toInt() : g_rows;
+        int cols = request->hasParam("cols", true) ? request->getParam("cols", true)->value().toInt() : g_cols;
+        if(grid_size_supported(cols, rows)) { g_rows = rows; g_cols = cols; }
+        // "profile" selects a profile; "os" (older dashboards) the first one for that OS
+        int target = -1;
+        if(request->hasParam("profile", true)) target = request->getParam("profile", true)->value().toInt();
+        else if(request->hasParam("os", true) && request->getParam("os", true)->value().toInt() != g_target_os)
+            target = profile_find_os(request->getParam("os", true)->value().toInt());
         if(request->hasParam("lang", true)) g_kb_lang = request->getParam("lang", true)->value().toInt();
+        if(request->hasParam("pages", true)) deck_resize(*g_deck, request->getParam("pages", true)->value().toInt());
 
-        for(int i=0; i<20; i++) {
+        uint16_t page = g_page;
+        if(request->hasParam("page", true)) page = request->getParam("page", true)->value().toInt();
+        if(page >= g_deck->page_count) page = g_deck->page_count - 1;
+        int lost = 0; // buttons the profile's string arena had no memory for
+        for(int i=0; i<DECK_PAGE_SLOTS; i++) {
             String p = "b" + String(i);
+            // Only buttons present in the form are replaced (OS/lang/page requests carry none)
+            if(!request->hasParam(p + "l", true)) continue;
+            ButtonConfig cfg;
+            deck_get(*g_deck, (size_t)page * DECK_PAGE_SLOTS + i, cfg);
             
             // Clear all fields before copying new data
-            memset(g_configs[i].label, 0, 16);
-            memset(g_configs[i].value, 0, 256);
-            memset(g_configs[i].icon, 0, 8);
-            memset(g_configs[i].imgPath, 0, 32);
+            memset(cfg.label, 0, 16);
+            memset(cfg.value, 0, 256);
+            memset(cfg.icon, 0, 8);
+            memset(cfg.imgPath, 0, 32);
             
             if(request->hasParam(p + "l", true)) {
                 String label = request->getParam(p + "l", true)->value();
-                strncpy(g_configs[i].label, label.c_str(), 15);
-                g_configs[i].label[15] = '\0';
+                strncpy(cfg.label, label.c_str(), 15);
+                cfg.label[15] = '\0';
             }
             
             if(request->hasParam(p + "v", true)) {
                 String value = request->getParam(p + "v", true)->value();
-                strncpy(g_configs[i].value, value.c_str(), 255);
-                g_configs[i].value[255] = '\0';
+                strncpy(cfg.value, value.c_str(), 255);
+                cfg.value[255] = '\0';
             }
             
             if(request->hasParam(p + "t", true)) {
-                g_configs[i].type = request->getParam(p + "t", true)->value().toInt();
+                cfg.type = request->getParam(p + "t", true)->value().toInt();
             }
             
             if(request->hasParam(p + "c", true)) {
-                g_configs[i].color = parse_color(request->getParam(p + "c", true)->value());
+                cfg.color = parse_color(request->getParam(p + "c", true)->value());
             }
             
             if(request->hasParam(p + "icon", true)) {
@@ -831,11 +1490,11 @@ static void init_webserver() {
                         const char* sym = g_sym_codes[j];
                         size_t sym_len = strlen(sym);
                         if (sym_len > 0 && sym_len < 8) {
-                            strncpy(g_configs[i].icon, sym, sym_len);
-                            g_configs[i].icon[sym_len] = '\0';
+                            strncpy(cfg.icon, sym, sym_len);
+                            cfg.icon[sym_len] = '\0';
                         } else if (sym_len == 0) {
                             // Handle "None" - explicitly set to empty
-                            g_configs[i].icon[0] = '\0';
+                            cfg.icon[0] = '\0';
                         }
                         found = true;
                         break;
@@ -843,7 +1502,7 @@ static void init_webserver() {
                 }
                 if (!found) {
                     // If icon name not found, clear it
-                    g_configs[i].icon[0] = '\0';
+                    cfg.icon[0] = '\0';
                 }
             }
 
@@ -852,212 +1511,200 @@ static void init_webserver() {
                 String val = request->getParam(p + "i", true)->value();
                 if (val.length() > 0 && val != String(l->none)) {
                     if (!val.startsWith("/")) val = "/" + val;
-                    strncpy(g_configs[i].imgPath, val.c_str(), 31);
-                    g_configs[i].imgPath[31] = '\0';
+                    strncpy(cfg.imgPath, val.c_str(), 31);
+                    cfg.imgPath[31] = '\0';
                 }
             }
             
             // Log the saved button configuration
             // Serial.printf("WEB API: Button %d saved: label='%s', type=%d, icon='%s' (len=%d), img='%s', color=0x%06X\n",
-            //     i, g_configs[i].label, g_configs[i].type, g_configs[i].icon, (int)strlen(g_configs[i].icon),
-            //     g_configs[i].imgPath, g_configs[i].color);
+            //     i, cfg.label, cfg.type, cfg.icon, (int)strlen(cfg.icon),
+            //     cfg.imgPath, cfg.color);
+            if(!deck_set(*g_deck, (size_t)page * DECK_PAGE_SLOTS + i, cfg)) lost++;
         }
         
-        bool isOSSwitch = (request->hasParam("os", true) && request->params() <= 2); 
-        // Note: request->params() includes duplicates or internal ones, but usually if we only send OS, we don't want to save current buttons to the new OS file.
-        // Actually, let's be more explicit: if the request has OS, we save global prefs and then load buttons.
-        
-        save_settings(!isOSSwitch); 
-        load_settings(); 
-        g_pending_ui_update = true;
+        // Buttons in the form belong to the profile that was active when it was sent
+        save_settings(!request->hasParam("profile", true) && !request->hasParam("os", true));
+        if (g_page >= g_deck->page_count) g_page = g_deck->page_count - 1;
+        g_configs = deck_page(*g_deck, g_page);
+        // A profile switch applies its own widget diff in the loop
+        if (target < 0 || !select_profile(target, esp_timer_get_time())) g_pending_ui_update = true;
+        if (target >= 0 && target != g_profile && profile_get(target)) {
+            request->send(503, "text/plain", "Busy: settings are still being written, profile not switched");
+            return;
+        }
         
+        if (lost) {
+            Serial.printf("WEB API: %d buttons not saved, out of memory\n", lost);
+            request->send(507, "text/plain", "Out of memory: " + String(lost) + " buttons not saved");
+            return;
+        }
         Serial.println("WEB API: Configuration saved successfully");
         request->send(200, "text/plain", "OK");
     });
 
-    // API: Full Backup (JSON)
-    server.on("/api/backup", HTTP_GET, [](AsyncWebServerRequest *request){
-        JsonDocument doc;
-        doc["bg"] = String(g_bg_color, HEX);
-        doc["rows"] = g_rows;
-        doc["cols"] = g_cols;
-        doc["os"] = g_target_os;
-        doc["lang"] = g_kb_lang;
-        doc["wifi_ssid"] = g_wifi_ssid;
-        
-        // Load Windows Buttons
-        ButtonConfig win_btns[20];
-        File f = LittleFS.open("/win_btns.bin", "r");
-        if (f) { f.read((uint8_t*)win_btns, sizeof(win_btns)); f.close(); }
-        JsonArray winArr = doc["win_btns"].to<JsonArray>();
-        for(int i=0; i<20; i++) {
-            JsonObject b = winArr.add<JsonObject>();
-            b["label"] = win_btns[i].label;
-            b["value"] = win_btns[i].value;
-            b["type"] = win_btns[i].type;
-            b["color"] = String(win_btns[i].color, HEX);
-            b["icon"] = win_btns[i].icon;
-            b["img"] = win_btns[i].imgPath;
-        }
+    // API: Full Backup, JSON or the binary archive (see backup.h)
+    server.on("/api/backup", HTTP_GET, [](AsyncWebServerRequest *request){ send_backup(request, BACKUP_JSON); });
+    server.on("/api/backup.bin", HTTP_GET, [](AsyncWebServerRequest *request){ send_backup(request, BACKUP_BIN); });
+    server.on("/api/manifest", HTTP_GET, [](AsyncWebServerRequest *request){ send_backup(request, BACKUP_MANIFEST); });
+    // With an earlier manifest as the body: only what changed since (a differential archive)
+    server.on("/api/backup.bin", HTTP_POST, [](AsyncWebServerRequest *request){
+        if (request->contentLength() == 0) send_backup(request, BACKUP_BIN); // No manifest: everything
+    }, NULL, backup_body);
 
-        // Load Mac Buttons
-        ButtonConfig mac_btns[20];
-        f = LittleFS.open("/mac_btns.bin", "r");
-        if (f) { f.read((uint8_t*)mac_btns, sizeof(mac_btns)); f.close(); }
-        JsonArray macArr = doc["mac_btns"].to<JsonArray>();
-        for(int i=0; i<20; i++) {
-            JsonObject b = macArr.add<JsonObject>();
-            b["label"] = mac_btns[i].label;
-            b["value"] = mac_btns[i].value;
-            b["type"] = mac_btns[i].type;
-            b["color"] = String(mac_btns[i].color, HEX);
-            b["icon"] = mac_btns[i].icon;
-            b["img"] = mac_btns[i].imgPath;
-        }
+    // API: Restore, parsed as it arrives; see backup.h
+    server.on("/api/restore", HTTP_POST, [](AsyncWebServerRequest *request){
+        // Request handling will be done in the body handler below
+    }, NULL, [](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total){
+        restore_body(request, data, len, index, total, false);
+    });
+    server.on("/api/restore.bin", HTTP_POST, [](AsyncWebServerRequest *request){
+        // Request handling will be done in the body handler below
+    }, NULL, [](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total){
+        restore_body(request, data, len, index, total, true);
+    });
 
-        // Add assets from LittleFS
-        JsonObject assets = doc["assets"].to<JsonObject>();
-        File root = LittleFS.open("/");
-        if (root) {
-            File assetFile = root.openNextFile();
-            while (assetFile) {
-                String name = String(assetFile.name());
-                if (!assetFile.isDirectory() && 
-                    name != "win_btns.bin" && 
-                    name != "mac_btns.bin" && 
-                    !name.startsWith("._")) {
-                    
-                    size_t size = assetFile.size();
-                    uint8_t* buf = (uint8_t*)malloc(size);
-                    if (buf) {
-                        assetFile.read(buf, size);
-                        assets[name] = base64::encode(buf, size);
-                        free(buf);
-                    }
-                }
-                assetFile = root.openNextFile();
+    // Background jobs: ?id=N for one, otherwise the last JOB_HISTORY
+    server.on("/api/jobs", HTTP_GET, [](AsyncWebServerRequest *request){
+        if (request->hasParam("id")) {
+            JobInfo j;
+            if (!job_get(request->getParam("id")->value().toInt(), j)) {
+                request->send(404, "text/plain", "Unknown job");
+                return;
             }
+            request->send(200, "application/json", job_json(j));
+            return;
         }
-
-        String output;
-        serializeJson(doc, output);
-        request->send(200, "application/json", output);
+        JobInfo jobs[JOB_HISTORY];
+        size_t n = job_list(jobs, JOB_HISTORY);
+        String json = "[";
+        for (size_t i = 0; i < n; i++) {
+            if (i) json += ",";
+            json += job_json(jobs[i]);
+        }
+        request->send(200, "application/json", json + "]");
     });
 
-    // API: Restore (JSON)
-    server.on("/api/restore", HTTP_POST, [](AsyncWebServerRequest *request){
-        // Request handling will be done in the body handler below
-    }, NULL, [](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total){
-        static String body = "";
-        if (index == 0) body = "";
-        body += String((char*)data, len);
-        
-        if (index + len == total) {
-            JsonDocument doc;
-            DeserializationError error = deserializeJson(doc, body);
-            if (error) {
-                request->send(400, "text/plain", "JSON Parse Error");
+    // Grid render benchmark (per-file images vs icon atlas)
+    server.on("/api/bench", HTTP_POST, [](AsyncWebServerRequest *request){
+        int c = 0, r = 0;
+        bool all = false;
+        if (request->hasParam("grid")) {
+            String grid = request->getParam("grid")->value();
+            all = grid == "all";
+            if (!all && (sscanf(grid.c_str(), "%dx%d", &c, &r) != 2 || !grid_size_supported(c, r))) {
+                request->send(400, "text/plain", "Invalid grid");
                 return;
             }
+        }
+        g_bench_all = all;
+        g_bench_cols = c;
+        g_bench_rows = r;
+        g_pending_bench = true;
+        request->send(202, "text/plain", "Benchmark queued");
+    });
 
-            auto parse_color = [](String hex) -> uint32_t {
-                if(hex.startsWith("#")) hex = hex.substring(1);
-                return strtol(hex.c_str(), NULL, 16);
-            };
-        if(error){
-            Serial.println("JSON Parse Error");
-            request->send(400);
-            return;
+    server.on("/api/bench", HTTP_GET, [](AsyncWebServerRequest *request){
+        request->send(200, "application/json", g_bench_json);
+    });
+
+    // Flash writes done by the persistence layer since boot
+    server.on("/api/persist", HTTP_GET, [](AsyncWebServerRequest *request){
+        PersistStats p = persist_stats();
+        String json = "{\"requests\":" + String(p.requests) + ",\"flushes\":" + String(p.flushes) +
+                      ",\"nvs_keys\":" + String(p.nvs_keys) + ",\"nvs_bytes\":" + String(p.nvs_bytes) +
+                      ",\"records\":" + String(p.records) + ",\"full_writes\":" + String(p.full_writes) +
+                      ",\"file_bytes\":" + String(p.file_bytes) + ",\"last_flush_ms\":" + String(p.last_flush_ms) + "}";
+        request->send(200, "application/json", json);
+    });
+
+    // Boot phases (start/end in us since reset, end 0: still running)
+    server.on("/api/boot", HTTP_GET, [](AsyncWebServerRequest *request){
+        String json = "{\"usable_us\":" + String(boot_usable_us()) + ",\"target_us\":" + String(BOOT_TARGET_US) + ",\"phases\":[";
+        for(uint8_t i=0; i<BOOT_PHASES; i++) {
+            BootPhaseTime t = boot_phase_time((BootPhase)i);
+            if(i) json += ",";
+            json += "{\"name\":\"" + String(boot_phase_name((BootPhase)i)) + "\",\"start_us\":" + String(t.start_us) +
+                    ",\"end_us\":" + String(t.end_us) + ",\"us\":" + String(t.end_us ? t.end_us - t.start_us : 0) + "}";
         }
-        
-        if(!doc["bg"].isNull()) g_bg_color = parse_color(doc["bg"]);
-        if(!doc["rows"].isNull()) g_rows = doc["rows"];
-        if(!doc["cols"].isNull()) g_cols = doc["cols"];
-        if(!doc["os"].isNull()) g_target_os = doc["os"];
-        if(!doc["lang"].isNull()) g_kb_lang = doc["lang"];
-        if(!doc["wifi_ssid"].isNull()) strncpy(g_wifi_ssid, doc["wifi_ssid"], 31);
-        if(!doc["wifi_pass"].isNull()) strncpy(g_wifi_pass, doc["wifi_pass"], 63);
-            auto restore_btns = [&](JsonArray arr, const char* path) {
-                ButtonConfig btns[20];
-                memset(btns, 0, sizeof(btns));
-                for(int i=0; i<20 && i<arr.size(); i++) {
-                    JsonObject b = arr[i];
-                    strncpy(btns[i].label, b["label"] | "Button", 15);
-                    strncpy(btns[i].value, b["value"] | "", 255);
-                    btns[i].type = b["type"] | 0;
-                    btns[i].color = parse_color(b["color"] | "333333");
-                    strncpy(btns[i].icon, b["icon"] | "", 7);
-                    strncpy(btns[i].imgPath, b["img"] | "", 31);
-                }
-                File f = LittleFS.open(path, "w");
-                if (f) { f.write((uint8_t*)btns, sizeof(btns)); f.close(); }
-            };
-         // Check for specific button array updates
-        if(!doc["win_btns"].isNull()) restore_btns(doc["win_btns"].as<JsonArray>(), "/win_btns.bin");
-        if(!doc["mac_btns"].isNull()) restore_btns(doc["mac_btns"].as<JsonArray>(), "/mac_btns.bin");
-
-        // Restore Assets
-        if (!doc["assets"].isNull()) {
-            JsonObject assets = doc["assets"].as<JsonObject>();
-            for (JsonPair kv : assets) {
-                String filename = kv.key().c_str();
-                if (!filename.startsWith("/")) filename = "/" + filename;
-                String b64 = kv.value().as<String>();
-                
-                // Robust Base64 decode
-                auto decode = [](String input) -> std::vector<uint8_t> {
-                    std::vector<uint8_t> ret;
-                    int i = 0;
-                    uint8_t char_array_4[4], char_array_3[3];
-                    auto b64_decode = [](char c) -> int {
-                        if (c >= 'A' && c <= 'Z') return c - 'A';
-                        if (c >= 'a' && c <= 'z') return c - 'a' + 26;
-                        if (c >= '0' && c <= '9') return c - '0' + 52;
-                        if (c == '+') return 62;
-                        if (c == '/') return 63;
-                        return -1;
-                    };
-                    for (size_t in_ = 0; in_ < input.length(); in_++) {
-                        char c = input[in_];
-                        if (c == '=') break;
-                        int val = b64_decode(c);
-                        if (val == -1) continue;
-                        char_array_4[i++] = (uint8_t)val;
-                        if (i == 4) {
-                            char_array_3[0] = (char_array_4[0] << 2) + ((char_array_4[1] & 0x30) >> 4);
-                            char_array_3[1] = ((char_array_4[1] & 0xf) << 4) + ((char_array_4[2] & 0x3c) >> 2);
-                            char_array_3[2] = ((char_array_4[2] & 0x3) << 6) + char_array_4[3];
-                            for (i = 0; i < 3; i++) ret.push_back(char_array_3[i]);
-                            i = 0;
-                        }
-                    }
-                    if (i) {
-                        for (int j = i; j < 4; j++) char_array_4[j] = 0;
-                        char_array_3[0] = (char_array_4[0] << 2) + ((char_array_4[1] & 0x30) >> 4);
-                        char_array_3[1] = ((char_array_4[1] & 0xf) << 4) + ((char_array_4[2] & 0x3c) >> 2);
-                        char_array_3[2] = ((char_array_4[2] & 0x3) << 6) + char_array_4[3];
-                        for (int j = 0; j < i - 1; j++) ret.push_back(char_array_3[j]);
-                    }
-                    return ret;
-                };
-
-                std::vector<uint8_t> decoded = decode(b64);
-                if (decoded.size() > 0) {
-                    File f = LittleFS.open(filename, "w");
-                    if (f) {
-                        f.write(decoded.data(), decoded.size());
-                        f.close();
-                        // Serial.printf("RESTORE: Asset %s saved\n", filename.c_str());
-                    }
-                }
-            }
+        SplashStats sp = splash_stats();
+        json += "],\"splash\":{\"bytes\":" + String(sp.bytes) + ",\"draw_us\":" + String(sp.draw_us) +
+                ",\"encode_us\":" + String(sp.encode_us) + ",\"captures\":" + String(sp.captures) +
+                ",\"unchanged\":" + String(sp.unchanged) + "}}";
+        request->send(200, "application/json", json);
+    });
+
+    // Connection state and time to IP of the last cold (scan + DHCP) and warm (cached AP, no scan) attempt
+    server.on("/api/wifi", HTTP_GET, [](AsyncWebServerRequest *request){
+        static const char* const states[] = {"idle", "connecting", "connected", "backoff"};
+        WifiStats w = wifi_mgr_stats();
+        String json = "{\"state\":\"" + String(states[wifi_mgr_state()]) + "\",\"ip\":\"" + g_ip_addr +
+                      "\",\"channel\":" + String(w.channel) + ",\"cached\":" + String(w.cached ? "true" : "false") +
+                      ",\"last_us\":" + String(w.last_us) + ",\"last_warm\":" + String(w.last_warm ? "true" : "false") +
+                      ",\"cold_us\":" + String(w.cold_us) + ",\"warm_us\":" + String(w.warm_us) +
+                      ",\"attempts\":" + String(w.attempts) + ",\"connects\":" + String(w.connects) +
+                      ",\"drops\":" + String(w.drops) + ",\"warm_fails\":" + String(w.warm_fails) +
+                      ",\"backoff_ms\":" + String(w.backoff_ms) + ",\"last_reason\":" + String(w.last_reason) + "}";
+        request->send(200, "application/json", json);
+    });
+
+    // Resident profiles and the last switch (tap to first frame)
+    server.on("/api/profiles", HTTP_GET, [](AsyncWebServerRequest *request){
+        String json = "{\"active\":" + String(g_profile) + ",\"profiles\":[";
+        for(uint8_t i=0; i<profile_count(); i++) {
+            const Profile* p = profile_get(i);
+            if(i) json += ",";
+            json += "{\"name\":\"" + escape_json(String(p->name)) + "\",\"os\":" + String(p->os) +
+                    ",\"pages\":" + String(p->deck.page_count) + "}";
         }
+        json += "],\"switches\":" + String(g_switch_stats.count) + ",\"last_switch_us\":" + String(g_switch_stats.last_us) +
+                ",\"cells\":" + String(g_switch_stats.cells) + ",\"rebuilt\":" + String(g_switch_stats.rebuilt) + "}";
+        request->send(200, "application/json", json);
+    });
 
-            save_settings(false); // Save globals
-            load_settings();     // Reload current active buttons
-            g_pending_ui_update = true;
-            request->send(200, "text/plain", "Restore OK");
+    // name=&os=[&copy=1] adds a profile (copy: starts from the active one's buttons); delete=<id> removes one
+    // Adding or deleting is a job (202 + id, see /api/jobs): the list and
+    // the decks change on loop(), which may be drawing them
+    server.on("/api/profiles", HTTP_POST, [](AsyncWebServerRequest *request){
+        if(decks_busy(request)) return;
+        ProfileOp* op = (ProfileOp*)calloc(1, sizeof(ProfileOp));
+        if(!op) { request->send(503, "text/plain", "Out of memory"); return; }
+        if(request->hasParam("delete", true)) {
+            int id = request->getParam("delete", true)->value().toInt();
+            if(!profile_get(id) || id < PROFILE_BUILTIN) {
+                free(op);
+                request->send(400, "text/plain", "Built-in or unknown profile");
+                return;
+            }
+            op->remove = true;
+            op->id = id;
+        } else {
+            String name = request->hasParam("name", true) ? request->getParam("name", true)->value() : String("Profile");
+            strncpy(op->name, name.c_str(), PROFILE_NAME_LEN - 1);
+            op->os = request->hasParam("os", true) ? request->getParam("os", true)->value().toInt() : g_target_os;
+            op->copy = request->hasParam("copy", true) && request->getParam("copy", true)->value() == "1";
         }
+        g_profile_busy = true;
+        uint32_t job = job_submit("profile", profile_job, op);
+        if(!job) {
+            g_profile_busy = false;
+            free(op);
+            request->send(503, "text/plain", "Too many jobs pending");
+            return;
+        }
+        request->send(202, "application/json", "{\"job\":" + String(job) + "}");
+    });
+
+    // RAM/flash of the active profile and of a synthetic one (?sample=N buttons)
+    server.on("/api/footprint", HTTP_GET, [](AsyncWebServerRequest *request){
+        uint16_t count = request->hasParam("sample") ? request->getParam("sample")->value().toInt() : 120;
+        Deck sample;
+        String sample_json = build_sample_deck(sample, count) ? footprint_json(deck_footprint(sample)) : "null";
+        deck_free(sample);
+        DeckFootprint f = deck_footprint(*g_deck);
+        Serial.printf("DECK: %u custom buttons, RAM %u -> %u B, flash %u -> %u B\n", f.custom,
+                      f.ram_fixed, f.ram_packed, f.flash_fixed, f.flash_packed);
+        request->send(200, "application/json", "{\"profile\":" + footprint_json(f) + ",\"sample\":" + sample_json + "}");
     });
 
     // List files
@@ -1070,13 +1717,21 @@ static void init_webserver() {
             while(file){
                 String name = String(file.name());
                 // Hide system config files
-                if (name != "win_btns.bin" && name != "mac_btns.bin") {
+                if (!is_system_file(name)) {
                     if(!first) json += ",";
                     json += "{\"name\":\"" + name + "\",\"size\":" + String(file.size()) + "}";
                     first = false;
                 }
                 file = root.openNextFile();
             }
+            // Read-only images from the assets partition
+            for (uint16_t a = 0; a < asset_store_count(); a++) {
+                const AssetPackEntry* e = asset_store_entry(a);
+                if (LittleFS.exists(e->name)) continue;
+                if(!first) json += ",";
+                json += "{\"name\":\"" + String(e->name + 1) + "\",\"size\":" + String(e->size) + ",\"ro\":true}";
+                first = false;
+            }
         }
         json += "]";
         request->send(200, "application/json", json);
@@ -1089,12 +1744,16 @@ static void init_webserver() {
             if(!fname.startsWith("/")) fname = "/" + fname;
             
             // Protect system config files
-            if (fname == "/win_btns.bin" || fname == "/mac_btns.bin") {
+            if (is_system_file(fname)) {
                 request->send(403, "text/plain", "Forbidden: System File");
                 return;
             }
 
             if(LittleFS.remove(fname)) {
+                backup_file_changed(fname.c_str());
+                icon_atlas_invalidate();
+                g_atlas_dirty = true;
+                g_prerender_stale = true;
                 // Serial.printf("API: Deleted %s\n", fname.c_str());
                 request->send(200, "text/plain", "OK");
             } else {
@@ -1105,500 +1764,228 @@ static void init_webserver() {
         }
     });
 
-    // Firmware Update Handler
-    // Global flags to track OTA state and error messages
-    static bool g_ota_success = false;
-    static bool g_ota_failed = false;
-    static size_t g_ota_total_size = 0;
-    static size_t g_ota_expected_size = 0;  // Track expected size for validation
-    static String g_ota_error_msg = "";
-    static bool g_ota_in_progress = false;  // Flag to pause LVGL during OTA
-
+    // Firmware update through the buffered writer (firmware.h). The image is
+    // verified before the reply; the main loop restarts once it has gone out.
+    // ?sha256=<hex> makes the update fail unless the image hashes to it.
+    struct FirmwareUpload { UploadResult result; uint32_t id; bool done; bool ok; UploadStats st; };
     server.on("/api/update", HTTP_POST, [](AsyncWebServerRequest *request){
-        // This callback is called when the upload is complete
-        bool shouldRestart = g_ota_success && !Update.hasError() && !g_ota_failed;
-        
-        // Serial.printf("OTA: Final status - Success: %d, Failed: %d, Update.hasError: %d\n", 
-        //     g_ota_success, g_ota_failed, Update.hasError());
-        
-        String response_msg;
-        int response_code = 200;
-        
-        if(shouldRestart) {
-            response_msg = "Update OK. Restarting...";
-        } else if(g_ota_failed) {
-            response_msg = "Update Failed: " + g_ota_error_msg;
-            response_code = 500;
-        } else if(Update.hasError()) {
-            response_msg = "Update Error";
-            response_code = 500;
+        FirmwareUpload* u = (FirmwareUpload*)request->_tempObject;
+        int code = 200;
+        String msg;
+        if (!u || !u->done) {
+            code = 400;
+            msg = "No firmware image";
+        } else if (u->result != UPLOAD_OK) {
+            code = u->result == UPLOAD_BUSY ? 409 : u->result == UPLOAD_INVALID ? 400 : 500;
+            msg = String("Update Failed: ") + firmware_error();
+        } else if (!u->ok) {
+            code = 500;
+            msg = String("Update Failed: ") + firmware_error();
         } else {
-            response_msg = "Update incomplete";
-            response_code = 500;
+            msg = "{\"bytes\":" + String(u->st.bytes) + ",\"ms\":" + String(u->st.ms) + ",\"kbps\":" +
+                  String(u->st.kbps) + ",\"sha256\":\"" + firmware_sha256() + "\"}";
         }
-        
-        AsyncWebServerResponse *response = request->beginResponse(response_code, "text/plain", response_msg);
+        AsyncWebServerResponse *response = request->beginResponse(code, code == 200 ? "application/json" : "text/plain", msg);
         response->addHeader("Connection", "close");
         request->send(response);
-        
-        if(shouldRestart) {
-            Serial.println("OTA: SUCCESS - Sending restart command");
-            delay(1000);
-            Serial.flush();
-            delay(500);
-            ESP.restart();
-            delay(5000); // Should not reach here
-        } else {
-            g_ota_success = false;
-            g_ota_failed = false;
+        if (code == 200) {
+            Serial.println("OTA: SUCCESS - Restarting");
+            g_restart_at = millis() + 1000;
         }
     }, [](AsyncWebServerRequest *request, String filename, size_t index, uint8_t *data, size_t len, bool final){
-        // This callback is called as data arrives
-        if(!index){
-            g_ota_success = false;
-            g_ota_failed = false;
-            g_ota_total_size = 0;
-            g_ota_error_msg = "";
-            g_ota_in_progress = true;
-            
-            // Disable watchdog completely during OTA
-            esp_task_wdt_deinit();
-            
-            // Note: When using multipart/form-data, contentLength() includes boundary headers
-            // The actual file size will be less. We'll validate after receiving all data.
-            // For now, we just use a generous upper limit check
-            size_t content_length = request->contentLength();
-            
-            Serial.println("OTA: Starting firmware update via web interface...");
-            Serial.printf("OTA: Request Content-Length: %zu bytes (includes multipart headers)\n", content_length);
-            Serial.printf("OTA: Filename from upload: %s\n", filename.c_str());
-            
-            // The Update API will handle writing only the actual file data, skipping multipart boundaries
-            // We'll validate the final size during finalization
-            // Maximum check: 4MB (leave margin for multipart overhead)
-            if(content_length > 4*1024*1024) {
-                g_ota_error_msg = String("Invalid size: ") + String((float)content_length / (1024.0*1024.0), 2) + "MB";
-                g_ota_failed = true;
-                g_ota_in_progress = false;
-                Serial.printf("OTA: ERROR - Content too large: %zu bytes\n", content_length);
-                
-                // Re-enable watchdog with default timeout
-                esp_task_wdt_init(5, true);
-                
-                delay(2000);
+        FirmwareUpload* u = (FirmwareUpload*)request->_tempObject;
+        if (!index && !u) {
+            // Freed with the request
+            u = (FirmwareUpload*)calloc(1, sizeof(FirmwareUpload));
+            request->_tempObject = u;
+            if (!u) return;
+            const char* sha = request->hasParam("sha256") ? request->getParam("sha256")->value().c_str() : nullptr;
+            Serial.printf("OTA: Receiving %s (%u bytes with form data)\n", filename.c_str(), (unsigned)request->contentLength());
+            u->result = firmware_start(request->contentLength(), sha, request->client(), &u->id);
+            if (u->result != UPLOAD_OK) {
+                Serial.printf("OTA: Refused: %s\n", firmware_error());
+                u->done = true;
                 return;
             }
-            
-            // Start update - Update API will parse multipart automatically
-            if(!Update.begin(UPDATE_SIZE_UNKNOWN)){
-                g_ota_error_msg = "Cannot begin update";
-                g_ota_failed = true;
-                g_ota_in_progress = false;
-                Serial.print("OTA: Update.begin() failed: ");
-                Update.printError(Serial);
-                
-                // Re-enable watchdog with default timeout
-                esp_task_wdt_init(5, true);
-                
-                delay(2000);
-                return;
-            }
-            
-            Serial.println("OTA: Update.begin() successful (size unknown - multipart)");
+            uint32_t id = u->id;
+            request->onDisconnect([id]() { upload_abort(id); });
         }
-        
-        if(len){
-            if(g_ota_failed) {
-                Serial.println("OTA: Skipping write, already failed");
-                return;
-            }
-            
-            size_t written = Update.write(data, len);
-            g_ota_total_size += written;
-            
-            if(written != len){
-                g_ota_error_msg = "Write error";
-                g_ota_failed = true;
-                g_ota_in_progress = false;
-                Serial.printf("OTA: Write mismatch - Expected: %u, Written: %u\n", len, written);
-                Update.printError(Serial);
-                // update_ota_progress(0, (g_kb_lang == 1 ? "Error: Fallo en escritura" : "Error: Write failed"));
-                
-                // Re-enable watchdog with default timeout
-                esp_task_wdt_init(5, true);
-                
-                delay(2000);
-                return;
-            }
-            
-            // NO UI UPDATE during OTA - prevents LVGL rendering
-            // update_ota_progress(-1, (g_kb_lang == 1 ? "Recibiendo firmware..." : "Receiving firmware..."));
-                // Serial.printf("OTA: Received %u bytes (total: %u)\n", len, g_ota_total_size);
-            
-            // CRITICAL: Give the SPI/flash controller time to complete write
-            // The Update.write() function queues data but may not complete immediately
-            // We need multiple yields to allow the flash writing to progress
-            // This prevents the "premature end" error
-            for(int i = 0; i < 200; i++) {
-                yield();
-                delayMicroseconds(100);  // Small delay per yield - total ~20ms per chunk
-            }
-        }
-        
-        if(final){
-            if(g_ota_failed) {
-                Serial.println("OTA: Final called but already failed");
-                return;
-            }
-            
-            Serial.printf("OTA: Final chunk received - Total bytes received: %u bytes\n", g_ota_total_size);
-            Serial.printf("OTA: Expected size: %zu bytes\n", g_ota_expected_size);
-            
-            // Calculate how many bytes are still pending (in buffers or being written)
-            size_t bytes_pending = (g_ota_total_size < g_ota_expected_size) ? 
-                                    (g_ota_expected_size - g_ota_total_size) : 0;
-            
-            if(bytes_pending > 0) {
-                Serial.printf("OTA: WARNING - Still missing %zu bytes at final callback (%.2f%% of expected)\n", 
-                    bytes_pending, (float)bytes_pending / g_ota_expected_size * 100);
-                Serial.println("OTA: This is expected with multipart/form-data (boundary overhead).");
-                Serial.println("OTA: The Update API handles this automatically - proceeding with finalization.");
-            }
-            
-            // With UPDATE_SIZE_UNKNOWN, we don't validate size here
-            // The Update API will validate the firmware during end()
-            Serial.printf("OTA: Firmware written: %.2f MB (%u bytes)\n", 
-                (float)g_ota_total_size / (1024.0*1024.0), g_ota_total_size);
-            
-            // Wait a bit but continue yielding to allow straggler packets to arrive
-            // The TCP connection is closing, but we need to ensure all data is written to flash
-            Serial.println("OTA: Flushing remaining data to flash...");
-            for(int i = 0; i < 200; i++) {
-                yield();
-                delayMicroseconds(2000);  // 400ms total - give plenty of time for final writes
-            }
-            delay(2000);  // Final settling time before calling Update.end()
-            
-            // End update WITH verification - let ESP32 validate firmware integrity
-            if(!Update.end(true)){
-                g_ota_error_msg = "Update end failed";
-                g_ota_failed = true;
-                g_ota_in_progress = false;
-                Serial.print("OTA: Update.end() failed: ");
-                Update.printError(Serial);
-                // update_ota_progress(0, (g_kb_lang == 1 ? "Error: Update.end falló" : "Error: Update.end failed"));
-                
-                // Re-enable watchdog with default timeout
-                esp_task_wdt_init(5, true);
-                
-                delay(2000);
-                return;
-            }
-            
-            // Verify update was successful
-            if(Update.hasError()){
-                g_ota_error_msg = "Update error after end";
-                g_ota_failed = true;
-                g_ota_in_progress = false;
-                Serial.print("OTA: Update has error after end: ");
-                Update.printError(Serial);
-                // update_ota_progress(0, (g_kb_lang == 1 ? "Error: Verificación fallida" : "Error: Verification failed"));
-                
-                // Re-enable watchdog with default timeout
-                esp_task_wdt_init(5, true);
-                
-                delay(2000);
-                return;
-            }
-            
-            // Serial.printf("OTA: Update successful - Total: %u bytes\n", g_ota_total_size);
-            // update_ota_progress(100, (g_kb_lang == 1 ? "¡Completado! Reiniciando..." : "Done! Restarting..."));
-            Serial.println("OTA: Update successful! Restarting...");
-            g_ota_success = true;
-            g_ota_in_progress = false;
-            
-            // Re-enable watchdog with default timeout
-            esp_task_wdt_init(5, true);
+        if (!u || u->done) return;
+        if (len) upload_feed(data, len);
+        if (!final) return;
+        u->done = true;
+        u->ok = upload_end(u->st) == UPLOAD_OK;
+        if (u->ok) {
+            Serial.printf("OTA: %u bytes in %u ms (%u KB/s, %u pauses), sha256 %s\n", (unsigned)u->st.bytes,
+                          (unsigned)u->st.ms, (unsigned)u->st.kbps, (unsigned)u->st.pauses, firmware_sha256());
+        } else {
+            Serial.printf("OTA: Failed after %u bytes: %s\n", (unsigned)u->st.bytes, firmware_error());
         }
     });
 
-    // Upload handler with static file handle
-    static File uploadFile;
+    // Asset upload, through the buffered writer (upload.h). State lives in
+    // the request: a second upload at the same time gets 409, not a mix.
+    struct AssetUpload { UploadResult result; uint32_t id; bool done; UploadStats st; };
     server.on("/api/upload", HTTP_POST, [](AsyncWebServerRequest *request){
-        Serial.println("API: Upload complete.");
-        request->send(200, "text/plain", "Upload OK");
+        AssetUpload* u = (AssetUpload*)request->_tempObject;
+        if (!u) {
+            request->send(400, "text/plain", "No file");
+            return;
+        }
+        if (u->result != UPLOAD_OK) {
+            int code = u->result == UPLOAD_BUSY ? 409 : u->result == UPLOAD_NO_SPACE ? 507 : 500;
+            request->send(code, "text/plain", upload_error());
+            return;
+        }
+        request->send(200, "application/json", "{\"bytes\":" + String(u->st.bytes) + ",\"ms\":" + String(u->st.ms) +
+                      ",\"kbps\":" + String(u->st.kbps) + ",\"pauses\":" + String(u->st.pauses) + "}");
     }, [](AsyncWebServerRequest *request, String filename, size_t index, uint8_t *data, size_t len, bool final){
-        if(!index){
-            if(!filename.startsWith("/")) filename = "/" + filename;
-            Serial.printf("API: Receiving file %s\n", filename.c_str());
-            uploadFile = LittleFS.open(filename, "w");
+        AssetUpload* u = (AssetUpload*)request->_tempObject;
+        if (!filename.startsWith("/")) filename = "/" + filename;
+        if (!index && !u) {
+            // Freed with the request
+            u = (AssetUpload*)calloc(1, sizeof(AssetUpload));
+            request->_tempObject = u;
+            if (!u) return;
+            Serial.printf("API: Receiving file %s (%u bytes)\n", filename.c_str(), (unsigned)request->contentLength());
+            u->result = upload_file_start(filename.c_str(), request->contentLength(), request->client(), &u->id);
+            if (u->result != UPLOAD_OK) {
+                Serial.printf("API: Upload refused: %s\n", upload_error());
+                u->done = true;
+                return;
+            }
+            // The temporary file is dropped if the client goes away first
+            uint32_t id = u->id;
+            request->onDisconnect([id]() { upload_abort(id); });
         }
-        if(len && uploadFile) uploadFile.write(data, len);
-        if(final && uploadFile) {
-            uploadFile.close();
-            Serial.println("API: File saved to LittleFS.");
+        if (!u || u->done) return; // Only the first file of a form is taken
+        if (len) upload_feed(data, len);
+        if (!final) return;
+        u->done = true;
+        if (upload_end(u->st) != UPLOAD_OK) {
+            u->result = UPLOAD_FAILED;
+            Serial.printf("API: Upload of %s failed: %s\n", filename.c_str(), upload_error());
+            return;
         }
+        backup_file_changed(filename.c_str());
+        icon_atlas_invalidate();
+        g_atlas_dirty = true;
+        g_prerender_stale = true;
+        Serial.printf("API: %s saved, %u bytes in %u ms (%u KB/s, %u pauses)\n", filename.c_str(),
+                      (unsigned)u->st.bytes, (unsigned)u->st.ms, (unsigned)u->st.kbps, (unsigned)u->st.pauses);
     });
 
-    // Web Dashboard (UTF-8 Header)
-    server.on("/", HTTP_GET, [](AsyncWebServerRequest *request){
-        const L10n* l = get_l10n();
-        String html = "<!DOCTYPE html><html><head><meta charset='UTF-8'><meta name='viewport' content='width=device-width, initial-scale=1.0'><title>" + String(l->dash_title) + "</title>";
-        html += "<link href='https://cdn.jsdelivr.net/npm/bootstrap@5.3.0/dist/css/bootstrap.min.css' rel='stylesheet'>";
-        html += "<link rel='stylesheet' href='https://cdnjs.cloudflare.com/ajax/libs/font-awesome/6.4.2/css/all.min.css'>";
-        html += "<style>body{background:#121212;color:white}.card{background:#1e1e1e;border:1px solid #333;color:white;margin-bottom:15px}.btn-grid{display:grid;grid-template-columns:repeat(auto-fill, minmax(200px, 1fr));gap:15px}.btn-del{padding:0 5px;color:#ff4444;cursor:pointer;border:none;background:none}.hidden-card{display:none} .icon-select{font-family: 'Font Awesome 6 Free', 'FontAwesome', sans-serif; font-weight: 900;} .combo-builder{background:#2a2a2a; border-radius:4px; padding:5px; margin-top:5px; border:1px solid #444;}</style>";
-        html += "</head><body class='container py-4'>";
-        html += "<div class='d-flex justify-content-between align-items-center mb-4'><h2>" + String(l->dash_title);
-        html += " <span class='badge bg-secondary' style='font-size:0.5em'>v";
-        html += PANDA_VERSION;
-        html += "</span></h2>";
-        html += "<div class='d-flex align-items-center gap-3'><div class='d-flex align-items-center gap-2'><label>" + String(l->kb_label) + "</label><select id='langSelect' class='form-select form-select-sm' style='width:105px'><option value='0'>English</option><option value='1'>Español</option></select></div>";
-        html += "<div class='d-flex align-items-center gap-2'><label>" + String(l->os_label) + "</label><select id='osSelect' class='form-select form-select-sm' style='width:105px'><option value='0'>Windows</option><option value='1'>macOS</option></select><input type='hidden' id='osInput' name='os' form='configForm'></div>";
-        html += "<div class='d-flex align-items-center gap-2'><label>" + String(l->grid_label) + "</label><select id='gridSelect' class='form-select form-select-sm' style='width:100px'><option value='2x2'>2x2</option><option value='3x2'>3x2</option><option value='3x3'>3x3</option><option value='4x3'>4x3</option><option value='5x3'>5x3</option></select><input type='hidden' id='rowsInput' name='rows' form='configForm'><input type='hidden' id='colsInput' name='cols' form='configForm'></div>";
-        html += "<div class='d-flex align-items-center gap-2'><label>" + String(l->bg_label) + "</label><input type='color' id='globalBg' name='bg' form='configForm' class='form-control form-control-color' style='height:35px'></div></div></div>";
-        
-        html += "<div class='row'><div class='col-md-9'>";
-        html += "<div class='card p-3 mb-4'><h5>" + String(l->btn_config) + "</h5><form id='configForm'><div class='btn-grid' id='buttonContainer'>";
-        for(int i=0; i<20; i++) {
-            html += "<div class='card p-2 text-center btn-card' id='card"+String(i)+"'>";
-            html += "<b class='mb-2'>" + String(l->button_label) + " " + String(i+1) + "</b>";
-            html += "<input type='text' name='b"+String(i)+"l' class='form-control form-control-sm mb-1' placeholder='" + String(l->btn_name_ph) + "' maxlength='15'>";
-            html += "<input type='text' name='b"+String(i)+"v' id='val"+String(i)+"' class='form-control form-control-sm mb-1 text-uppercase' placeholder='" + String(l->btn_cmd_ph) + "' maxlength='255'>";
-            html += "<select name='b"+String(i)+"t' id='type"+String(i)+"' class='form-select form-select-sm mb-1' onchange='toggleBuilder("+String(i)+")'>";
-            html += "<option value='0'>" + String(l->type_app) + "</option>";
-            html += "<option value='1'>" + String(l->type_media) + "</option>";
-            html += "<option value='2'>" + String(l->type_basic) + "</option>";
-            html += "<option value='3'>" + String(l->type_adv) + "</option></select>";
-            
-            // Helpful text for Basic Combo
-            html += "<div id='basicHint"+String(i)+"' class='small text-secondary mb-1 d-none' style='font-size:10px'>" + String(l->basic_combo_desc) + "</div>";
-
-            // Combo Builder (Hidden by default)
-            html += "<div id='builder"+String(i)+"' class='combo-builder d-none'>";
-            html += "<div class='d-flex flex-wrap justify-content-center gap-1 mb-1'>";
-            html += "<input type='checkbox' class='btn-check' id='c"+String(i)+"' onchange='updC("+String(i)+")'><label class='btn btn-outline-info btn-xs py-0 px-1' style='font-size:10px' for='c"+String(i)+"'>CTRL</label>";
-            html += "<input type='checkbox' class='btn-check' id='s"+String(i)+"' onchange='updC("+String(i)+")'><label class='btn btn-outline-info btn-xs py-0 px-1' style='font-size:10px' for='s"+String(i)+"'>SHFT</label>";
-            html += "<input type='checkbox' class='btn-check' id='a"+String(i)+"' onchange='updC("+String(i)+")'><label class='btn btn-outline-info btn-xs py-0 px-1' style='font-size:10px' for='a"+String(i)+"'>ALT</label>";
-            html += "<input type='checkbox' class='btn-check' id='m"+String(i)+"' onchange='updC("+String(i)+")'><label class='btn btn-outline-info btn-xs py-0 px-1' style='font-size:10px' for='m"+String(i)+"'>META</label>";
-            html += "</div>";
-            html += "<select id='key"+String(i)+"' class='form-select form-select-sm' style='font-size:11px' onchange='updC("+String(i)+")'></select>";
-            html += "</div>";
-
-            html += "<div class='d-flex gap-1 align-items-center mb-1 mt-1'>";
-            html += "<input type='color' name='b"+String(i)+"c' class='form-control form-control-color flex-grow-1' style='height:30px' title='" + String(l->color_title) + "'>";
-            html += "<select name='b"+String(i)+"icon' class='form-select form-select-sm icon-select' title='" + String(l->icon_title) + "'><option value='None'>None</option></select>";
-            html += "</div>";
-            html += "<select name='b"+String(i)+"i' class='form-select form-select-sm asset-select' title='" + String(l->image_title) + "'></select>";
-            html += "</div>";
+    // Asset bundle: a tar extracted while it arrives (bundle.h). Per-file
+    // results; the atlas and prerender are invalidated once for all of them.
+    struct BundleUpload { Bundle* b; UploadResult result; uint32_t id; bool ended; bool ok; UploadStats st; };
+    server.on("/api/bundle", HTTP_POST, [](AsyncWebServerRequest *request){
+        BundleUpload* u = (BundleUpload*)request->_tempObject;
+        if (!u || !u->ended) {
+            request->send(u ? 500 : 400, "text/plain", u ? "Out of memory" : "No bundle");
+            return;
+        }
+        if (!u->b) { // Still being written: the upload task owns the bundle now
+            request->send(503, "text/plain", upload_error());
+            return;
+        }
+        if (u->result != UPLOAD_OK) {
+            int code = u->result == UPLOAD_BUSY ? 409 : u->result == UPLOAD_NO_SPACE ? 507 : 500;
+            request->send(code, "text/plain", upload_error());
+            return;
+        }
+        const char* err = bundle_error(u->b);
+        if (!u->ok && !err[0]) err = upload_error();
+        String json = "{\"ok\":" + String(u->ok ? "true" : "false") + ",\"error\":\"" + escape_json(err) +
+                      "\",\"bytes\":" + String(u->st.bytes) + ",\"ms\":" + String(u->st.ms) +
+                      ",\"kbps\":" + String(u->st.kbps) + ",\"files\":[";
+        for (size_t i = 0; i < bundle_file_count(u->b); i++) {
+            const BundleFile& f = bundle_file(u->b, i);
+            if (i) json += ",";
+            json += "{\"name\":\"" + escape_json(f.name + 1) + "\",\"size\":" + String(f.size) +
+                    (f.error ? ",\"error\":\"" + String(f.error) + "\"}" : String("}"));
+        }
+        json += "]}";
+        bundle_destroy(u->b);
+        u->b = nullptr;
+        request->send(u->ok ? 200 : 400, "application/json", json);
+    }, NULL, [](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total){
+        BundleUpload* u = (BundleUpload*)request->_tempObject;
+        if (index == 0 && !u) {
+            // Freed with the request; the bundle by the reply or the disconnect
+            u = (BundleUpload*)calloc(1, sizeof(BundleUpload));
+            request->_tempObject = u;
+            if (!u) return;
+            u->b = bundle_create(bundle_allowed);
+            if (!u->b) {
+                u->ended = true;
+                u->result = UPLOAD_FAILED;
+                return;
+            }
+            u->result = bundle_start(u->b, total, request->client(), &u->id);
+            request->onDisconnect([request]() {
+                BundleUpload* u = (BundleUpload*)request->_tempObject;
+                if (!u) return;
+                // Otherwise the upload task frees it once it is done with it
+                if (upload_abort(u->id)) bundle_destroy(u->b);
+                u->b = nullptr;
+            });
+            Serial.printf("API: Receiving bundle (%u bytes)\n", (unsigned)total);
+        }
+        if (!u || u->ended || u->result != UPLOAD_OK) {
+            if (u && u->result != UPLOAD_OK) u->ended = true;
+            return;
+        }
+        upload_feed(data, len);
+        if (index + len != total) return;
+        u->ended = true;
+        UploadResult end = upload_end(u->st);
+        u->ok = end == UPLOAD_OK;
+        if (end == UPLOAD_PENDING) {
+            // Files completed so far are in place; which ones is not known here
+            Serial.printf("API: Bundle failed: %s\n", upload_error());
+            u->b = nullptr;
+            icon_atlas_invalidate();
+            g_atlas_dirty = true;
+            g_prerender_stale = true;
+            return;
         }
-        html += "</div><button type='submit' class='btn btn-primary mt-3 w-100'>" + String(l->save_changes) + "</button></form></div></div>";
+        size_t written = 0;
+        for (size_t i = 0; i < bundle_file_count(u->b); i++) {
+            const BundleFile& f = bundle_file(u->b, i);
+            if (f.error) continue;
+            backup_file_changed(f.name);
+            written++;
+        }
+        if (written) {
+            icon_atlas_invalidate();
+            g_atlas_dirty = true;
+            g_prerender_stale = true;
+        }
+        Serial.printf("API: Bundle %s, %u of %u files in %u ms (%u KB/s)\n", u->ok ? "extracted" : "failed",
+                      (unsigned)written, (unsigned)bundle_file_count(u->b), (unsigned)u->st.ms, (unsigned)u->st.kbps);
+    });
 
-        // Right Column: Backup, Firmware, then Library
-        html += "<div class='col-md-3'>";
-        
-        // Backup
-        html += "<div class='card p-3 mb-3'><h5>" + String(l->backup_title) + "</h5>";
-        html += "<button onclick='backup()' class='btn btn-sm btn-info w-100 mb-2'>" + String(l->backup_btn) + "</button>";
-        html += "<input type='file' id='restoreInput' class='form-control form-control-sm mb-2' accept='.json'>";
-        html += "<button onclick='restore()' class='btn btn-sm btn-danger w-100'>" + String(l->restore_btn) + "</button>";
-        html += "</div>";
-
-        // Firmware
-        html += "<div class='card p-3 mb-3'><h5>" + String(l->firmware_title) + "</h5>";
-        html += "<p class='small text-secondary'>" + String(l->firmware_info) + "</p>";
-        html += "<input type='file' id='otaInput' class='form-control form-control-sm mb-2' accept='.bin'>";
-        html += "<button onclick='updateFirmware()' class='btn btn-sm btn-warning w-100'>" + String(l->update_btn) + "</button>";
-        html += "<div style='display:none; margin-top:10px;' id='otaProgressContainer'>";
-        html += "<div class='progress' style='height: 20px;'><div id='otaProgressBar' class='progress-bar progress-bar-striped progress-bar-animated bg-warning' style='width: 0%'></div></div>";
-        html += "<div id='otaProgressStatus' style='text-align:center; margin-top:5px; font-weight:bold; color:#888;'>0%</div>";
-        html += "</div>";
-        html += "</div>";
-
-        // Library (now at bottom)
-        html += "<div class='card p-3'><h5>" + String(l->library) + "</h5>";
-        html += "<input type='file' id='fileInput' class='form-control form-control-sm mb-2'><button onclick='upload()' class='btn btn-sm btn-success w-100 mb-3'>" + String(l->upload) + "</button>";
-        html += "<ul id='fileList' class='list-group list-group-flush small'></ul></div>";
-        
-        html += "</div></div></div>";
-        
-        html += "<script>";
-        html += "const SYMBOLS = {";
-        for(int j=0; j<20; j++) {
-            String name = String(g_sym_names[j]);
-            
-            // Escape special characters in name for JSON
-            name.replace("\\", "\\\\");
-            name.replace("\"", "\\\"");
-            name.replace("\n", "\\n");
-            name.replace("\r", "\\r");
-            
-            // Output: "name": "symbol"
-            html += "\"" + name + "\": \"";
-            
-            // Add the raw UTF-8 bytes directly (they'll be transmitted as UTF-8)
-            html += String(g_sym_codes[j]);
-            
-            html += "\"";
-            if(j < 19) html += ",";
+    server.on("/api/ui", HTTP_GET, [](AsyncWebServerRequest *request){
+        uint8_t lang = g_kb_lang;
+        String etag = ui_etag(lang);
+        if (request->hasHeader("If-None-Match") && request->getHeader("If-None-Match")->value() == etag) {
+            AsyncWebServerResponse *response = request->beginResponse(304);
+            response->addHeader("ETag", etag);
+            request->send(response);
+            return;
         }
-        html += "};";
-        html += "const KEYS = ['', 'A', 'B', 'C', 'D', 'E', 'F', 'G', 'H', 'I', 'J', 'K', 'L', 'M', 'N', 'O', 'P', 'Q', 'R', 'S', 'T', 'U', 'V', 'W', 'X', 'Y', 'Z', '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'F1', 'F2', 'F3', 'F4', 'F5', 'F6', 'F7', 'F8', 'F9', 'F10', 'F11', 'F12', 'ENTER', 'SPACE', 'TAB', 'ESC', 'UP', 'DOWN', 'LEFT', 'RIGHT', 'HOME', 'END', 'PAGE_UP', 'PAGE_DOWN', 'BACKSPACE', 'DELETE', 'PRINT_SCREEN', 'PAUSE'];";
-        html += "function toggleBuilder(i){ const t=document.getElementById('type'+i).value; document.getElementById('builder'+i).classList.toggle('d-none', t!='3'); document.getElementById('basicHint'+i).classList.toggle('d-none', t!='2'); if(t=='3') updC(i); }";
-        html += "function updC(i){ let c=''; if(document.getElementById('c'+i).checked) c+='CTRL+'; if(document.getElementById('s'+i).checked) c+='SHIFT+'; if(document.getElementById('a'+i).checked) c+='ALT+'; if(document.getElementById('m'+i).checked) c+='GUI+'; const k=document.getElementById('key'+i).value; if(k) c+=k; else if(c.endsWith('+')) c=c.slice(0,-1);  document.getElementById('val'+i).value = c; }";
-        html += "function parseC(i,v){ if(!v)return; const p=v.toUpperCase().split('+'); document.getElementById('c'+i).checked=p.includes('CTRL'); document.getElementById('s'+i).checked=p.includes('SHIFT'); document.getElementById('a'+i).checked=p.includes('ALT'); document.getElementById('m'+i).checked=p.includes('GUI')||p.includes('WIN')||p.includes('CMD'); const k=p.find(x=>!['CTRL','SHIFT','ALT','GUI','WIN','CMD'].includes(x))||''; document.getElementById('key'+i).value=k; }";
-        html += "document.getElementById('osSelect').onchange = async (e) => {";
-        html += " document.getElementById('osInput').value = e.target.value;";
-        html += " const fd = new FormData(); fd.append('os', e.target.value);";
-        html += " await fetch('/api/save', {method:'POST', body:fd});";
-        html += " load();";
-        html += "};";
-        html += "document.getElementById('langSelect').onchange = async (e) => {";
-        html += " const fd = new FormData(); fd.append('lang', e.target.value);";
-        html += " await fetch('/api/save', {method:'POST', body:fd});";
-        html += " location.reload();"; // Reload to change UI language
-        html += "};";
-        html += "document.getElementById('gridSelect').onchange = (e) => {";
-        html += " const [c, r] = e.target.value.split('x').map(Number);";
-        html += " document.getElementById('rowsInput').value = r;";
-        html += " document.getElementById('colsInput').value = c;";
-        html += " updateVisibleCards(r, c);";
-        html += "};";
-        html += "function updateVisibleCards(r, c) {";
-        html += " const count = r * c;";
-        html += " for(let i=0; i<20; i++) {";
-        html += "  const card = document.getElementById('card'+i);";
-        html += "  if(card) card.style.display = (i < count) ? 'block' : 'none';";
-        html += " }";
-        html += "}";
-        html += "async function load(){";
-        html += " try {";
-        html += "  const r = await fetch('/api/config'); const d = await r.json();";
-        html += "  const f = await fetch('/api/files'); const files = await f.json();";
-        html += "  document.getElementById('globalBg').value = '#' + d.bg.padStart(6,'0');";
-        html += "  document.getElementById('gridSelect').value = d.cols + 'x' + d.rows;";
-        html += "  document.getElementById('rowsInput').value = d.rows;";
-        html += "  document.getElementById('colsInput').value = d.cols;";
-        html += "  document.getElementById('osSelect').value = d.os;";
-        html += "  document.getElementById('osInput').value = d.os;";
-        html += "  document.getElementById('langSelect').value = d.lang;";
-        html += "  updateVisibleCards(d.rows, d.cols);";
-        html += "  const selects = document.querySelectorAll('.asset-select');";
-        html += "  selects.forEach(s => { s.innerHTML = '<option value=\"\">" + String(l->none) + "</option>'; files.forEach(file => s.innerHTML += `<option value='${file.name}'>${file.name}</option>`); });";
-        html += "  for(let i=0; i<20; i++){ const s=document.getElementById('key'+i); s.innerHTML = KEYS.map(k=>`<option value='${k}'>${k || '" + String(l->select_key_ph) + "'}</option>`).join(''); }";
-        html += "  d.buttons.forEach((b,i) => { ";
-        html += "   const lbl = document.getElementsByName(`b${i}l`)[0]; if(!lbl) return;";
-        html += "   lbl.value = b.label;";
-        html += "   document.getElementsByName(`b${i}v`)[0].value = b.value;";
-        html += "   document.getElementsByName(`b${i}t`)[0].value = b.type;";
-        html += "   document.getElementsByName(`b${i}c`)[0].value = '#' + b.color.padStart(6,'0');";
-        html += "   const sIcon = document.getElementsByName(`b${i}icon`)[0];";
-        html += "   sIcon.innerHTML = '<option value=\"None\">None</option>' + Object.entries(SYMBOLS).map(([name, char]) => `<option value='${name}'>${char ? char + ' ' : ''}${name}</option>`).join('');";
-        html += "   sIcon.value = b.icon || 'None';";
-        html += "   document.getElementsByName(`b${i}i`)[0].value = b.img.startsWith('/') ? b.img.substring(1) : b.img;";
-        html += "   parseC(i, b.value); toggleBuilder(i);";
-        html += "  });";
-        html += "  const fl = document.getElementById('fileList'); fl.innerHTML = '';";
-        html += "  files.forEach(file => fl.innerHTML += `<li class='list-group-item bg-dark text-white d-flex justify-content-between align-items-center px-2' style='border-color:#333'>${file.name} <button onclick=\"del('${file.name}')\" class='btn-del'>×</button></li>`);";
-        html += " } catch(e) { console.error(e); }";
-        html += "}";
-        html += "document.getElementById('configForm').onsubmit = async (e) => { ";
-        html += " e.preventDefault(); const fd = new FormData(e.target); await fetch('/api/save', {method:'POST', body:fd}); alert('" + String(l->config_saved) + "'); load();";
-        html += "};";
-        html += "async function upload(){";
-        html += " const fi = document.getElementById('fileInput'); if(!fi.files[0]) return; const fd = new FormData(); fd.append('file', fi.files[0]); await fetch('/api/upload', {method:'POST', body:fd}); load();";
-        html += "}";
-        html += "async function backup(){";
-        html += " const r = await fetch('/api/backup'); const d = await r.json();";
-        html += " const blob = new Blob([JSON.stringify(d, null, 2)], {type: 'application/json'});";
-        html += " const url = URL.createObjectURL(blob); const a = document.createElement('a');";
-        html += " a.href = url; a.download = 'pandadeck_backup.json'; a.click();";
-        html += "}";
-        html += "async function restore(){";
-        html += " const fi = document.getElementById('restoreInput'); if(!fi.files[0]) return; if(!confirm('" + String(l->confirm_restore) + "')) return;";
-        html += " const reader = new FileReader(); reader.onload = async (e) => {";
-        html += "  await fetch('/api/restore', {method:'POST', body: e.target.result}); alert('" + String(l->restore_ok) + "'); location.reload();";
-        html += " }; reader.readAsText(fi.files[0]);";
-        html += "}";
-        html += "async function del(name){ if(!confirm('" + String(l->delete_file_confirm) + "'+name+'?')) return; const fd = new FormData(); fd.append('filename', name); await fetch('/api/delete', {method:'POST', body:fd}); load(); }";
-        html += "async function updateFirmware() {";
-        html += " const file = document.getElementById('otaInput').files[0];";
-        html += " if(!file) { alert('Please select a .bin file'); return; }";
-        html += " const minSize = 102400; const maxSize = 3145728;";  // 100KB - 3MB
-        html += " if(file.size < minSize || file.size > maxSize) { ";
-        html += "  const sizeMB = (file.size / (1024*1024)).toFixed(2);";
-        html += "  alert('Invalid file size: ' + sizeMB + 'MB. Must be between 100KB and 3MB.'); ";
-        html += "  return; ";
-        html += " }";
-        html += " if(!confirm('" + String(l->update_firmware_confirm) + "')) return;";
-        html += " const fd = new FormData();";
-        html += " fd.append('update', file, file.name);";
-        html += " const xhr = new XMLHttpRequest();";
-        html += " xhr.open('POST', '/api/update', true);";
-        html += " const progressContainer = document.getElementById('otaProgressContainer');";
-        html += " const progressBar = document.getElementById('otaProgressBar');";
-        html += " const progressStatus = document.getElementById('otaProgressStatus');";
-        html += " progressContainer.style.display = 'block';";
-        html += " progressStatus.innerHTML = 'Uploading firmware (' + (file.size / (1024*1024)).toFixed(2) + 'MB)...';";
-        html += " let lastProgressUpdate = 0;";
-        html += " xhr.upload.onprogress = (e) => {";
-        html += "  if(e.lengthComputable) {";
-        html += "   let p = (e.loaded / e.total) * 100;";
-        html += "   if(p > 99) p = 99;";  // Cap at 99% until server confirms
-        html += "   const now = Date.now();";
-        html += "   if(now - lastProgressUpdate > 250) {";  // Update every 250ms max to avoid overwhelming server
-        html += "    progressBar.style.width = p + '%';";
-        html += "    progressStatus.innerHTML = 'Uploading: ' + p.toFixed(1) + '%';";
-        html += "    console.log('Upload progress: ' + p.toFixed(2) + '%');";
-        html += "    lastProgressUpdate = now;";
-        html += "   }";
-        html += "  }";
-        html += " };";
-        html += " xhr.onload = () => {";
-        html += "  console.log('Response status: ' + xhr.status);";
-        html += "  console.log('Response text: ' + xhr.responseText);";
-        html += "  progressStatus.style.fontSize = '14px';";
-        html += "  if(xhr.status === 200) {";
-        html += "   progressBar.style.width = '100%';";
-        html += "   progressStatus.style.color = 'green';";
-        html += "   progressStatus.innerHTML = 'Update successful! Device restarting...';";
-        html += "   console.log('OTA Success: ' + xhr.responseText);";
-        html += "   setTimeout(() => { location.reload(); }, 5000);";
-        html += "  } else {";
-        html += "   progressBar.style.width = '0%';";
-        html += "   progressStatus.style.color = 'red';";
-        html += "   progressStatus.innerHTML = 'Error: ' + xhr.responseText || ('HTTP ' + xhr.status);";
-        html += "   console.error('OTA Failed: ' + xhr.status + ' - ' + xhr.responseText);";
-        html += "   setTimeout(() => { progressContainer.style.display = 'none'; }, 5000);";
-        html += "  }";
-        html += " };";
-        html += " xhr.onerror = () => {";
-        html += "  console.error('Upload failed');";
-        html += "  progressBar.style.width = '0%';";
-        html += "  progressStatus.style.color = 'red';";
-        html += "  progressStatus.innerHTML = 'Connection failed. Please try again.';";
-        html += "  setTimeout(() => { progressContainer.style.display = 'none'; }, 5000);";
-        html += " };";
-        html += " xhr.ontimeout = () => {";
-        html += "  console.error('Upload timeout');";
-        html += "  progressBar.style.width = '0%';";
-        html += "  progressStatus.style.color = 'red';";
-        html += "  progressStatus.innerHTML = 'Timeout - Device may still be updating. Wait 30 seconds before retrying.';";
-        html += "  setTimeout(() => { progressContainer.style.display = 'none'; }, 8000);";
-        html += " };";
-        html += " xhr.timeout = 300000;";  // 5 minute timeout to allow for flash write time
-        html += " console.log('Starting upload of ' + file.name + ' (' + (file.size / (1024*1024)).toFixed(2) + 'MB)');";
-        html += " xhr.send(fd);";
-        html += "}";
-        html += "load();</script></body></html>";
-        // Append HTML to response
-        // Send response with headers
-        AsyncWebServerResponse *response = request->beginResponse(200, "text/html; charset=utf-8", html);
-        response->addHeader("Cache-Control", "no-cache, no-store, must-revalidate");
-        response->addHeader("Pragma", "no-cache");
-        response->addHeader("Expires", "0");
+        size_t len = 0;
+        const char* json = ui_json(lang, &len);
+        if (!json) { request->send(503, "text/plain", "Out of memory"); return; }
+        AsyncWebServerResponse *response = request->beginResponse_P(200, "application/json", (const uint8_t*)json, len);
+        response->addHeader("ETag", etag);
+        response->addHeader("Cache-Control", "no-cache");
         request->send(response);
     });
 
+    // Web dashboard: static files from flash, see web_ui.h
+    web_ui_begin(server);
+
     server.begin();
     started = true;
     Serial.println("Web Server started.");
@@ -1629,117 +2016,741 @@ static void check_bluetooth_internal() {
 // ==========================================
 // UI - MAIN SCREEN
 // ==========================================
-static void create_main_ui() {
-    lv_obj_clean(g_main_screen);
-    lv_obj_set_style_bg_color(g_main_screen, lv_color_hex(g_bg_color), LV_PART_MAIN);
+// Grid template shared by every page view and the footer
+static int32_t g_col_dsc[GRID_MAX_COLS + 1];
+static int32_t g_row_dsc[GRID_MAX_ROWS + 1];
+static const int32_t g_footer_row_dsc[] = { 60, LV_GRID_TEMPLATE_LAST };
+static int32_t g_cell_w = 0, g_cell_h = 0;
+
+#define PAGE_VIEW_H 410 // 480 - footer row (60) - bottom padding (10)
+
+// Materialized pages: the current one and, once preloaded, its neighbours.
+// Every other page only exists as packed Button data until the user gets close.
+static lv_obj_t* g_page_views[DECK_MAX_PAGES] = { nullptr };
+static lv_obj_t* g_page_prev = nullptr;
+static lv_obj_t* g_page_next = nullptr;
+static lv_obj_t* g_page_label = nullptr;
+static lv_timer_t* g_preload_timer = nullptr;
+
+static void sync_icon_atlas() {
+    // Every image of every resident profile (all pages, not only the visible
+    // cells), so a profile switch never changes the atlas; minus the ones the
+    // assets partition already serves zero-copy and LittleFS does not override
+    std::vector<const char*> paths;
+    for (uint8_t id = 0; id < profile_count(); id++) {
+        const Deck& d = profile_get(id)->deck;
+        for (size_t i = 0; i < (size_t)d.page_count * DECK_PAGE_SLOTS; i++) {
+            const char* p = d.buttons[i].imgPath;
+            if (p[0] == '/' && (!asset_store_image(p) || LittleFS.exists(p))) paths.push_back(p);
+        }
+    }
+    icon_atlas_sync(paths.data(), paths.size());
+}
+
+// Grid styling goes through the style pool; local styles are kept for A/B runs.
+// `applied` is for recycled objects: it remembers the pooled style last added
+// so a rebind swaps it instead of stacking another one.
+static void apply_pooled(lv_obj_t* obj, const lv_style_t* style, const lv_style_t** applied) {
+    if (!applied) { lv_obj_add_style(obj, style, LV_PART_MAIN); return; }
+    if (*applied == style) return;
+    if (*applied) lv_obj_remove_style(obj, (lv_style_t*)*applied, LV_PART_MAIN);
+    lv_obj_add_style(obj, style, LV_PART_MAIN);
+    *applied = style;
+}
+
+static void style_panel(lv_obj_t* obj, uint32_t color, int32_t pad) {
+    if (g_style_pool_enabled) { lv_obj_add_style(obj, style_pool_panel(color, pad), LV_PART_MAIN); return; }
+    lv_obj_set_style_bg_color(obj, lv_color_hex(color), LV_PART_MAIN);
+    lv_obj_set_style_border_width(obj, 0, LV_PART_MAIN);
+    lv_obj_set_style_pad_all(obj, pad, LV_PART_MAIN);
+    lv_obj_set_style_pad_gap(obj, pad, LV_PART_MAIN);
+}
+
+static void style_cell(lv_obj_t* obj, uint32_t color, int32_t pad_row, int32_t pad,
+                       const lv_style_t** applied = nullptr) {
+    if (g_style_pool_enabled) { apply_pooled(obj, style_pool_cell(color, pad_row, pad), applied); return; }
+    lv_obj_set_style_bg_color(obj, lv_color_hex(color), LV_PART_MAIN);
+    lv_obj_set_flex_flow(obj, LV_FLEX_FLOW_COLUMN);
+    lv_obj_set_flex_align(obj, LV_FLEX_ALIGN_CENTER, LV_FLEX_ALIGN_CENTER, LV_FLEX_ALIGN_CENTER);
+    lv_obj_set_style_pad_row(obj, pad_row, 0);
+    if (pad >= 0) lv_obj_set_style_pad_all(obj, pad, 0);
+}
 
-    // Dynamic Grid Descriptors
-    static int32_t col_dsc[10];
-    static int32_t row_dsc[10];
+static void style_text(lv_obj_t* obj, const lv_font_t* font, const lv_style_t** applied = nullptr) {
+    if (g_style_pool_enabled) apply_pooled(obj, style_pool_text(font), applied);
+    else lv_obj_set_style_text_font(obj, font, 0);
+}
+
+static void style_box(lv_obj_t* obj, int32_t size, const lv_style_t** applied = nullptr) {
+    if (g_style_pool_enabled) apply_pooled(obj, style_pool_box(size), applied);
+    else lv_obj_set_size(obj, size, size);
+}
+
+// Cell content shrinks in two steps: dense grids (past 4x3) and compact ones
+// (past 6x4), where the theme's button padding would not leave room for an
+// image and a label.
+static bool grid_compact() { return g_cols > 6 || g_rows > 4; }
+static int32_t cell_image_size() { return grid_compact() ? 28 : (g_cols > 4 || g_rows > 3) ? 48 : 64; }
+static int32_t cell_pad() { return grid_compact() ? 4 : -1; }
+static int32_t cell_pad_row() { return grid_compact() ? 2 : 5; }
+static const lv_font_t* cell_icon_font() {
+    if (grid_compact()) return &lv_font_montserrat_14;
+    return g_cols > 4 ? &lv_font_montserrat_18 : &lv_font_montserrat_24;
+}
+static const lv_font_t* cell_label_font() {
+    return g_cols > 4 ? &lv_font_montserrat_12 : &lv_font_montserrat_14;
+}
+
+// Image source of a button: packed partition first (zero-copy), then the
+// atlas, then LittleFS (decoded per file, path written to `path_buf`)
+static const void* button_image_src(const Button& b, char* path_buf, size_t len) {
+    if (b.imgPath[0] == '\0') return nullptr;
+    String fpath = b.imgPath;
+    if (!fpath.startsWith("/")) fpath = "/" + fpath;
+    // A LittleFS file overrides the packed image of the same name, as in /api/files
+    const void* atlas = icon_atlas_image(fpath.c_str());
+    if (atlas) return atlas;
+    if (!LittleFS.exists(fpath)) return asset_store_image(fpath.c_str());
+    snprintf(path_buf, len, "L:%s", fpath.c_str());
+    return path_buf;
+}
+
+static lv_obj_t* create_button(lv_obj_t* grid, const Button* btns, int i) {
+    lv_obj_t *btn = lv_btn_create(grid);
+    lv_obj_set_grid_cell(btn, LV_GRID_ALIGN_STRETCH, i % g_cols, 1, LV_GRID_ALIGN_STRETCH, i / g_cols, 1);
     
-    // 800x480 screen. Footer is ~60px.
-    // We calculate cell sizes to fill the space minus padding/gaps.
-    int32_t availW = 800 - 20 - (g_cols - 1) * 10;
-    int32_t availH = 480 - 20 - 60 - g_rows * 10;
+    // Log button data for debugging
+    // Serial.printf("Button %d: label='%s', icon='%s' (len=%d), imgPath='%s', type=%d\n",
+    //     i, btns[i].label, btns[i].icon, (int)strlen(btns[i].icon),
+    //     btns[i].imgPath, btns[i].type);
     
-    int32_t cellW = availW / g_cols;
-    int32_t cellH = availH / g_rows;
+    // Layout: vertical flex for icon + label
+    style_cell(btn, btns[i].color, cell_pad_row(), cell_pad());
+
+    // Icon/Image Logic
+    bool icon_or_img_present = false;
+    char full_path[64];
+    const void* src = button_image_src(btns[i], full_path, sizeof(full_path));
+    if (src) {
+        lv_obj_t *img = lv_image_create(btn);
+        lv_image_set_src(img, src);
+        style_box(img, cell_image_size());
+        icon_or_img_present = true;
+    }
 
-    for (int i = 0; i < g_cols; i++) col_dsc[i] = cellW;
-    col_dsc[g_cols] = LV_GRID_TEMPLATE_LAST;
-    
-    for (int i = 0; i < g_rows; i++) row_dsc[i] = cellH;
-    row_dsc[g_rows] = 60; // Footer row
-    row_dsc[g_rows + 1] = LV_GRID_TEMPLATE_LAST;
-
-    lv_obj_t *grid = lv_obj_create(g_main_screen);
-    lv_obj_set_grid_dsc_array(grid, col_dsc, row_dsc);
-    lv_obj_set_size(grid, lv_pct(100), lv_pct(100));
-    lv_obj_center(grid);
-    lv_obj_set_style_bg_color(grid, lv_color_hex(g_bg_color), LV_PART_MAIN);
-    lv_obj_set_style_border_width(grid, 0, LV_PART_MAIN);
-    lv_obj_set_style_pad_all(grid, 10, LV_PART_MAIN);
-    lv_obj_set_style_pad_gap(grid, 10, LV_PART_MAIN);
+    if (!icon_or_img_present && btns[i].icon[0] != '\0') {
+        lv_obj_t *icon = lv_label_create(btn);
+        lv_label_set_text(icon, btns[i].icon);
+        style_text(icon, cell_icon_font());
+        icon_or_img_present = true;
+        // Serial.printf("  -> Icon displayed\n");
+    }
+
+    // Label - Only create if not empty, to allow centering of icon/image
+    if (btns[i].label[0] != '\0') {
+        lv_obj_t *label = lv_label_create(btn);
+        lv_label_set_text(label, btns[i].label);
+        style_text(label, cell_label_font());
+    }
     
-    int btn_count = g_rows * g_cols;
-    for (int i = 0; i < btn_count; i++) {
-        lv_obj_t *btn = lv_btn_create(grid);
-        lv_obj_set_grid_cell(btn, LV_GRID_ALIGN_STRETCH, i % g_cols, 1, LV_GRID_ALIGN_STRETCH, i / g_cols, 1);
-        lv_obj_set_style_bg_color(btn, lv_color_hex(g_configs[i].color), LV_PART_MAIN);
-        
-        // Log button data for debugging
-        // Serial.printf("Button %d: label='%s', icon='%s' (len=%d), imgPath='%s', type=%d\n",
-        //     i, g_configs[i].label, g_configs[i].icon, (int)strlen(g_configs[i].icon),
-        //     g_configs[i].imgPath, g_configs[i].type);
-        
-        // Layout: Create vertical flex for icon + label
-        lv_obj_set_flex_flow(btn, LV_FLEX_FLOW_COLUMN);
-        lv_obj_set_flex_align(btn, LV_FLEX_ALIGN_CENTER, LV_FLEX_ALIGN_CENTER, LV_FLEX_ALIGN_CENTER);
-        lv_obj_set_style_pad_row(btn, 5, 0); // Add gap between icon/image and label
-
-        // Icon/Image Logic
-        bool icon_or_img_present = false;
-        if (g_configs[i].imgPath[0] != '\0') {
-            String fpath = g_configs[i].imgPath;
-            if(!fpath.startsWith("/")) fpath = "/" + fpath;
-            
-            if (LittleFS.exists(fpath)) {
-                lv_obj_t *img = lv_image_create(btn);
-                char full_path[64];
-                sprintf(full_path, "L:%s", fpath.c_str());
-                lv_image_set_src(img, full_path);
-                
-                // Scale image if grid is dense
-                if (g_cols > 4 || g_rows > 3) lv_obj_set_size(img, 48, 48);
-                else lv_obj_set_size(img, 64, 64);
-                
-                icon_or_img_present = true;
-                // Serial.printf("  -> Image loaded: %s\n", fpath.c_str());
-            } else {
-                // Serial.printf("  -> Image NOT found: %s\n", fpath.c_str());
+    lv_obj_add_event_cb(btn, btn_event_cb, LV_EVENT_CLICKED, (void*)(uintptr_t)i);
+    return btn;
+}
+
+// Everything that changes how a cell looks; a different key re-renders it
+static uint32_t button_render_key(const Button& c) {
+    int32_t geom[4] = { g_cell_w, g_cell_h, g_cols, g_rows };
+    uint32_t key = crc32_update(0, geom, sizeof(geom));
+    key = crc32_update(key, &c.color, sizeof(c.color));
+    key = crc32_update(key, c.label, strlen(c.label));
+    key = crc32_update(key, c.icon, strlen(c.icon) + 1);
+    return crc32_update(key, c.imgPath, strlen(c.imgPath));
+}
+
+// The one button widget tree behind every snapshot: it lives on a screen
+// that is never loaded and is rebound to each cell that needs rendering, so
+// widget memory does not grow with the grid or the deck. Recreated on every
+// create_main_ui(), before the style pool may be trimmed.
+struct RenderCell {
+    lv_obj_t* holder;
+    lv_obj_t* btn;
+    lv_obj_t* img;
+    lv_obj_t* icon;
+    lv_obj_t* label;
+    const lv_style_t* btn_style; // pooled styles currently applied
+    const lv_style_t* img_style;
+    const lv_style_t* icon_style;
+    const lv_style_t* label_style;
+};
+static RenderCell g_render_cell = {};
+
+static void render_cell_free() {
+    if (g_render_cell.holder) lv_obj_delete(g_render_cell.holder);
+    g_render_cell = {};
+}
+
+static RenderCell& render_cell_bind(const Button& b) {
+    RenderCell& rc = g_render_cell;
+    if (!rc.holder) {
+        rc.holder = lv_obj_create(NULL);
+        rc.btn = lv_btn_create(rc.holder);
+        rc.img = lv_image_create(rc.btn);
+        rc.icon = lv_label_create(rc.btn);
+        rc.label = lv_label_create(rc.btn);
+    }
+    lv_obj_set_size(rc.btn, g_cell_w, g_cell_h);
+    style_cell(rc.btn, b.color, cell_pad_row(), cell_pad(), &rc.btn_style);
+
+    // Hidden children take no room in the flex column
+    char full_path[64];
+    const void* src = button_image_src(b, full_path, sizeof(full_path));
+    bool show_icon = !src && b.icon[0] != '\0';
+    if (src) {
+        lv_image_set_src(rc.img, src);
+        style_box(rc.img, cell_image_size(), &rc.img_style);
+        lv_obj_remove_flag(rc.img, LV_OBJ_FLAG_HIDDEN);
+    } else {
+        lv_obj_add_flag(rc.img, LV_OBJ_FLAG_HIDDEN);
+    }
+    if (show_icon) {
+        lv_label_set_text(rc.icon, b.icon);
+        style_text(rc.icon, cell_icon_font(), &rc.icon_style);
+        lv_obj_remove_flag(rc.icon, LV_OBJ_FLAG_HIDDEN);
+    } else {
+        lv_obj_add_flag(rc.icon, LV_OBJ_FLAG_HIDDEN);
+    }
+    if (b.label[0] != '\0') {
+        lv_label_set_text(rc.label, b.label);
+        style_text(rc.label, cell_label_font(), &rc.label_style);
+        lv_obj_remove_flag(rc.label, LV_OBJ_FLAG_HIDDEN);
+    } else {
+        lv_obj_add_flag(rc.label, LV_OBJ_FLAG_HIDDEN);
+    }
+    lv_obj_update_layout(rc.btn);
+    return rc;
+}
+
+// With pre-rendering a page is a single object: its draw event blits each
+// cell's snapshot and input is hit-tested against the cell grid. Pages hold
+// no per-button widgets at all, whatever the grid size.
+static int16_t g_pressed_cell = -1; // cell of the current page under the finger
+
+static uint16_t view_page(lv_obj_t* view) {
+    return (uint16_t)(uintptr_t)lv_obj_get_user_data(view);
+}
+
+static void cell_rect(lv_obj_t* view, int i, lv_area_t* a) {
+    lv_area_t content;
+    lv_obj_get_content_coords(view, &content);
+    a->x1 = content.x1 + (i % g_cols) * (g_cell_w + 10);
+    a->y1 = content.y1 + (i / g_cols) * (g_cell_h + 10);
+    a->x2 = a->x1 + g_cell_w - 1;
+    a->y2 = a->y1 + g_cell_h - 1;
+}
+
+// Snapshots include the shadow margin: centered on the cell
+static void snapshot_rect(lv_obj_t* view, int i, const lv_draw_buf_t* snap, lv_area_t* a) {
+    cell_rect(view, i, a);
+    if (!snap) return;
+    int32_t x = a->x1 + (g_cell_w - (int32_t)snap->header.w) / 2;
+    int32_t y = a->y1 + (g_cell_h - (int32_t)snap->header.h) / 2;
+    lv_area_set(a, x, y, x + snap->header.w - 1, y + snap->header.h - 1);
+}
+
+static int cell_at(lv_obj_t* view, const lv_point_t& p) {
+    lv_area_t content;
+    lv_obj_get_content_coords(view, &content);
+    int32_t x = p.x - content.x1, y = p.y - content.y1;
+    if (x < 0 || y < 0) return -1;
+    int32_t c = x / (g_cell_w + 10), r = y / (g_cell_h + 10);
+    // Gaps between cells are not part of any button
+    if (c >= g_cols || r >= g_rows || x % (g_cell_w + 10) >= g_cell_w || y % (g_cell_h + 10) >= g_cell_h) return -1;
+    return r * g_cols + c;
+}
+
+static void invalidate_cell(lv_obj_t* view, int i) {
+    lv_area_t a;
+    snapshot_rect(view, i, button_cache_at(view_page(view) * DECK_PAGE_SLOTS + i), &a);
+    lv_obj_invalidate_area(view, &a);
+}
+
+static void page_view_draw_cb(lv_event_t* e) {
+    lv_obj_t* view = (lv_obj_t*)lv_event_get_current_target(e);
+    lv_layer_t* layer = lv_event_get_layer(e);
+    uint16_t page = view_page(view);
+    const Button* btns = deck_page(*g_deck, page);
+    for (int i = 0; i < g_cols * g_rows; i++) {
+        const lv_draw_buf_t* snap = button_cache_at(page * DECK_PAGE_SLOTS + i);
+        lv_area_t a;
+        snapshot_rect(view, i, snap, &a);
+        if (snap) {
+            lv_draw_image_dsc_t dsc;
+            lv_draw_image_dsc_init(&dsc);
+            dsc.src = snap;
+            if (page == g_page && i == g_pressed_cell) {
+                dsc.recolor = lv_color_black();
+                dsc.recolor_opa = LV_OPA_30;
             }
+            lv_draw_image(layer, &dsc, &a);
+            continue;
         }
+        // No memory for the snapshot: plain colored cell with its label
+        lv_draw_rect_dsc_t rect;
+        lv_draw_rect_dsc_init(&rect);
+        rect.bg_color = lv_color_hex(btns[i].color);
+        rect.radius = 8;
+        lv_draw_rect(layer, &rect, &a);
+        lv_draw_label_dsc_t text;
+        lv_draw_label_dsc_init(&text);
+        text.text = btns[i].label;
+        text.font = cell_label_font();
+        text.color = lv_color_white();
+        text.align = LV_TEXT_ALIGN_CENTER;
+        a.y1 += (g_cell_h - lv_font_get_line_height(text.font)) / 2;
+        lv_draw_label(layer, &text, &a);
+    }
+}
+
+static void page_view_input_cb(lv_event_t* e) {
+    lv_obj_t* view = (lv_obj_t*)lv_event_get_current_target(e);
+    if (view_page(view) != g_page) return;
+    lv_point_t p;
+    lv_indev_get_point(lv_indev_active(), &p);
+    switch (lv_event_get_code(e)) {
+        case LV_EVENT_PRESSED:
+            g_pressed_cell = cell_at(view, p);
+            if (g_pressed_cell >= 0) invalidate_cell(view, g_pressed_cell);
+            break;
+        case LV_EVENT_CLICKED:
+            // Only a release on the cell that was pressed
+            if (g_pressed_cell >= 0 && cell_at(view, p) == g_pressed_cell) {
+                StreamDeckApp::handle_button((uint8_t)g_pressed_cell);
+            }
+            break;
+        case LV_EVENT_RELEASED:
+        case LV_EVENT_PRESS_LOST:
+            if (g_pressed_cell >= 0) invalidate_cell(view, g_pressed_cell);
+            g_pressed_cell = -1;
+            break;
+        default:
+            break;
+    }
+}
+
+// Renders the cells of `page` whose snapshot is missing or outdated
+static void render_page_cells(uint16_t page) {
+    const Button* btns = deck_page(*g_deck, page);
+    uint16_t base = page * DECK_PAGE_SLOTS; // snapshot slot of cell 0
+    for (int i = 0; i < g_cols * g_rows; i++) {
+        uint32_t key = button_render_key(btns[i]);
+        if (button_cache_get(base + i, key)) continue;
+        // Out of memory leaves the slot empty: the draw event falls back to a plain cell
+        button_cache_store(base + i, key, render_cell_bind(btns[i]).btn);
+    }
+}
 
-        if (!icon_or_img_present && g_configs[i].icon[0] != '\0') {
-            lv_obj_t *icon = lv_label_create(btn);
-            lv_label_set_text(icon, g_configs[i].icon);
-            // Smaller font if grid is dense
-            if (g_cols > 4) lv_obj_set_style_text_font(icon, &lv_font_montserrat_18, 0);
-            else lv_obj_set_style_text_font(icon, &lv_font_montserrat_24, 0);
-            icon_or_img_present = true;
-            // Serial.printf("  -> Icon displayed\n");
+static void fill_page(lv_obj_t* view, uint16_t page) {
+    if (!g_prerender_enabled) {
+        const Button* btns = deck_page(*g_deck, page);
+        for (int i = 0; i < g_rows * g_cols; i++) create_button(view, btns, i);
+        return;
+    }
+    render_page_cells(page);
+    lv_obj_set_user_data(view, (void*)(uintptr_t)page);
+    lv_obj_add_event_cb(view, page_view_draw_cb, LV_EVENT_DRAW_MAIN, NULL);
+    lv_obj_add_event_cb(view, page_view_input_cb, LV_EVENT_PRESSED, NULL);
+    lv_obj_add_event_cb(view, page_view_input_cb, LV_EVENT_CLICKED, NULL);
+    lv_obj_add_event_cb(view, page_view_input_cb, LV_EVENT_RELEASED, NULL);
+    lv_obj_add_event_cb(view, page_view_input_cb, LV_EVENT_PRESS_LOST, NULL);
+}
+
+// Pages left of the current one wait at x = -800, pages right of it at +800:
+// switching is two position changes, off-screen views cost no rendering.
+static lv_obj_t* build_page(uint16_t page) {
+    lv_obj_t* view = lv_obj_create(g_main_screen);
+    lv_obj_set_grid_dsc_array(view, g_col_dsc, g_row_dsc);
+    lv_obj_set_size(view, 800, PAGE_VIEW_H);
+    lv_obj_set_pos(view, page == g_page ? 0 : (page < g_page ? -800 : 800), 0);
+    lv_obj_remove_flag(view, LV_OBJ_FLAG_SCROLLABLE);
+    style_panel(view, g_bg_color, 10);
+    fill_page(view, page);
+    return view;
+}
+
+static void preload_timer_cb(lv_timer_t* t) {
+    // One neighbour per tick, so the frame after a switch never waits for both
+    const int dirs[2] = { 1, -1 };
+    for (int d : dirs) {
+        int p = (int)g_page + d;
+        if (p >= 0 && p < g_deck->page_count && !g_page_views[p]) {
+            g_page_views[p] = build_page(p);
+            return;
         }
+    }
+    lv_timer_pause(t);
+}
+
+static void schedule_preload() {
+    if (!g_preload_timer) g_preload_timer = lv_timer_create(preload_timer_cb, 30, NULL);
+    lv_timer_reset(g_preload_timer);
+    lv_timer_resume(g_preload_timer);
+}
 
-        // Label - Only create if not empty, to allow centering of icon/image
-        if (g_configs[i].label[0] != '\0') {
-            lv_obj_t *label = lv_label_create(btn);
-            lv_label_set_text(label, g_configs[i].label);
-            if (g_cols > 4) lv_obj_set_style_text_font(label, &lv_font_montserrat_12, 0);
-            else lv_obj_set_style_text_font(label, &lv_font_montserrat_14, 0);
+static void update_page_nav() {
+    bool multi = g_deck->page_count > 1;
+    lv_obj_t* nav[3] = { g_page_prev, g_page_label, g_page_next };
+    for (lv_obj_t* o : nav) {
+        if (multi) lv_obj_remove_flag(o, LV_OBJ_FLAG_HIDDEN);
+        else lv_obj_add_flag(o, LV_OBJ_FLAG_HIDDEN);
+    }
+    lv_label_set_text_fmt(g_page_label, "%u/%u", (unsigned)(g_page + 1), (unsigned)g_deck->page_count);
+    if (g_page == 0) lv_obj_add_state(g_page_prev, LV_STATE_DISABLED);
+    else lv_obj_remove_state(g_page_prev, LV_STATE_DISABLED);
+    if (g_page + 1 >= g_deck->page_count) lv_obj_add_state(g_page_next, LV_STATE_DISABLED);
+    else lv_obj_remove_state(g_page_next, LV_STATE_DISABLED);
+}
+
+static void show_page(uint16_t page) {
+    if (page >= g_deck->page_count || page == g_page) return;
+    // Jumps past a neighbour were not preloaded: build now
+    if (!g_page_views[page]) g_page_views[page] = build_page(page);
+    lv_obj_set_x(g_page_views[g_page], page > g_page ? -800 : 800);
+    lv_obj_set_x(g_page_views[page], 0);
+    g_page = page;
+    g_configs = deck_page(*g_deck, page);
+    g_pressed_cell = -1;
+
+    // Only the current page and its neighbours stay materialized
+    for (uint16_t p = 0; p < DECK_MAX_PAGES; p++) {
+        if (g_page_views[p] && (p + 1 < page || p > page + 1)) {
+            lv_obj_delete(g_page_views[p]);
+            g_page_views[p] = nullptr;
+            button_cache_drop(p * DECK_PAGE_SLOTS, DECK_PAGE_SLOTS);
         }
-        
-        lv_obj_add_event_cb(btn, btn_event_cb, LV_EVENT_CLICKED, (void*)(uintptr_t)i);
     }
+    update_page_nav();
+    schedule_preload();
+}
+
+static void create_main_ui() {
+    lv_obj_clean(g_main_screen);
+    memset(g_page_views, 0, sizeof(g_page_views));
+    g_pressed_cell = -1;
+    render_cell_free();
+    style_pool_trim();
+    lv_obj_set_style_bg_color(g_main_screen, lv_color_hex(g_bg_color), LV_PART_MAIN);
+
+    if (g_atlas_dirty) {
+        g_atlas_dirty = false;
+        if (g_atlas_enabled) sync_icon_atlas();
+        else icon_atlas_clear();
+    }
+    if (g_prerender_stale) {
+        g_prerender_stale = false;
+        button_cache_clear();
+    }
+    for (uint16_t p = 0; p < DECK_MAX_PAGES; p++) {
+        if (p + 1 < g_page || p > g_page + 1) button_cache_drop(p * DECK_PAGE_SLOTS, DECK_PAGE_SLOTS);
+    }
+
+    // 800x480 screen: pages on top, 60px footer below.
+    // We calculate cell sizes to fill the space minus padding/gaps.
+    int32_t availW = 800 - 20 - (g_cols - 1) * 10;
+    int32_t availH = 480 - 20 - 60 - g_rows * 10;
+    
+    g_cell_w = availW / g_cols;
+    g_cell_h = availH / g_rows;
+
+    for (int i = 0; i < g_cols; i++) g_col_dsc[i] = g_cell_w;
+    g_col_dsc[g_cols] = LV_GRID_TEMPLATE_LAST;
+    
+    for (int i = 0; i < g_rows; i++) g_row_dsc[i] = g_cell_h;
+    g_row_dsc[g_rows] = LV_GRID_TEMPLATE_LAST;
+
+    g_page_views[g_page] = build_page(g_page);
+
+    // Footer: same columns as the cells
+    lv_obj_t *footer = lv_obj_create(g_main_screen);
+    lv_obj_set_grid_dsc_array(footer, g_col_dsc, g_footer_row_dsc);
+    lv_obj_set_size(footer, 800, 480 - PAGE_VIEW_H);
+    lv_obj_set_pos(footer, 0, PAGE_VIEW_H);
+    lv_obj_remove_flag(footer, LV_OBJ_FLAG_SCROLLABLE);
+    style_panel(footer, g_bg_color, 10);
+    lv_obj_set_style_pad_top(footer, 0, LV_PART_MAIN); // Gap comes from the page padding
 
     // Slider Row
-    lv_obj_t *slider = lv_slider_create(grid);
+    lv_obj_t *slider = lv_slider_create(footer);
     lv_slider_set_range(slider, 10, 100);
     lv_slider_set_value(slider, 50, LV_ANIM_OFF);
-    lv_obj_set_grid_cell(slider, LV_GRID_ALIGN_STRETCH, 0, 1, LV_GRID_ALIGN_CENTER, g_rows, 1);
+    lv_obj_set_grid_cell(slider, LV_GRID_ALIGN_STRETCH, 0, 1, LV_GRID_ALIGN_CENTER, 0, 1);
     lv_obj_add_event_cb(slider, slider_event_cb, LV_EVENT_VALUE_CHANGED, NULL);
 
-    // WiFi Status Label
-    g_wifi_label = lv_label_create(grid);
+    // WiFi Status Label, with page navigation around it when there is more than one page
+    lv_obj_t *nav = lv_obj_create(footer);
+    lv_obj_remove_style_all(nav);
+    lv_obj_set_grid_cell(nav, LV_GRID_ALIGN_STRETCH, 1, (g_cols > 2 ? g_cols - 2 : 1), LV_GRID_ALIGN_STRETCH, 0, 1);
+    lv_obj_set_flex_flow(nav, LV_FLEX_FLOW_ROW);
+    lv_obj_set_flex_align(nav, LV_FLEX_ALIGN_CENTER, LV_FLEX_ALIGN_CENTER, LV_FLEX_ALIGN_CENTER);
+    lv_obj_set_style_pad_column(nav, 15, 0);
+
+    g_page_prev = lv_btn_create(nav);
+    lv_obj_t *prev_label = lv_label_create(g_page_prev);
+    lv_label_set_text(prev_label, LV_SYMBOL_LEFT);
+    lv_obj_add_event_cb(g_page_prev, page_nav_cb, LV_EVENT_CLICKED, (void*)(intptr_t)-1);
+
+    g_wifi_label = lv_label_create(nav);
     String wtxt = "\xEF\x87\xAB " + g_ip_addr; // WIFI icon
     lv_label_set_text(g_wifi_label, wtxt.c_str());
-    lv_obj_set_grid_cell(g_wifi_label, LV_GRID_ALIGN_CENTER, 1, (g_cols > 2 ? g_cols - 2 : 1), LV_GRID_ALIGN_CENTER, g_rows, 1);
+
+    g_page_label = lv_label_create(nav);
+
+    g_page_next = lv_btn_create(nav);
+    lv_obj_t *next_label = lv_label_create(g_page_next);
+    lv_label_set_text(next_label, LV_SYMBOL_RIGHT);
+    lv_obj_add_event_cb(g_page_next, page_nav_cb, LV_EVENT_CLICKED, (void*)(intptr_t)1);
+    update_page_nav();
     
     // Settings Button
-    lv_obj_t *set_btn = lv_btn_create(grid);
-    lv_obj_set_grid_cell(set_btn, LV_GRID_ALIGN_STRETCH, g_cols - 1, 1, LV_GRID_ALIGN_STRETCH, g_rows, 1);
+    lv_obj_t *set_btn = lv_btn_create(footer);
+    lv_obj_set_grid_cell(set_btn, LV_GRID_ALIGN_STRETCH, g_cols - 1, 1, LV_GRID_ALIGN_STRETCH, 0, 1);
     lv_obj_t *set_label = lv_label_create(set_btn);
     lv_label_set_text(set_label, "\xEF\x80\x93" " Config"); // SETTINGS
     lv_obj_add_event_cb(set_btn, settings_btn_cb, LV_EVENT_CLICKED, NULL);
+
+    schedule_preload();
+}
+
+// ==========================================
+// PROFILE SWITCHING
+// ==========================================
+// Data side, any task: persist what belongs to the old profile, swap the deck
+// pointer. Nothing is read from NVS or LittleFS. false also when the flush
+// task did not get the old profile written in time.
+static bool select_profile(uint8_t id, int64_t t0) {
+    Profile* p = profile_get(id);
+    if (!p || id == g_profile) return false;
+    // Staged edits are bound to the old deck and its file. Written by the flush
+    // task, not here: this may run on async_tcp.
+    if (!persist_sync()) return false;
+    if (!g_pending_switch) {
+        g_switch.from = g_deck;
+        g_switch.from_page = g_page;
+    }
+    g_switch.t0 = t0;
+    g_profile = id;
+    g_deck = &p->deck;
+    g_target_os = p->os;
+    if (g_page >= g_deck->page_count) g_page = g_deck->page_count - 1;
+    g_configs = deck_page(*g_deck, g_page);
+    config_changed();
+    persist_deck_loaded(*g_deck, p->path);
+    persist_nvs_u8("prof", g_profile);
+    persist_nvs_u8("os", g_target_os);
+    persist_request();
+    g_pending_switch = true;
+    return true;
+}
+
+// Rebuilds the cells of the visible page that look different from `was`.
+// Pre-rendered cells are compared with their snapshot, so cells that match
+// one already cached (same label, color, image...) cost nothing.
+static uint16_t apply_deck_diff(lv_obj_t* view, const Button* was) {
+    uint16_t rebuilt = 0;
+    uint16_t base = g_page * DECK_PAGE_SLOTS;
+    for (int i = 0; i < g_cols * g_rows; i++) {
+        uint32_t key = button_render_key(g_configs[i]);
+        if (g_prerender_enabled) {
+            if (button_cache_get(base + i, key)) continue;
+            button_cache_store(base + i, key, render_cell_bind(g_configs[i]).btn);
+            invalidate_cell(view, i);
+        } else {
+            if (key == button_render_key(was[i])) continue;
+            lv_obj_delete(lv_obj_get_child(view, i));
+            lv_obj_move_to_index(create_button(view, g_configs, i), i);
+        }
+        rebuilt++;
+    }
+    // Neighbours show the old profile: rebuilt in the background (their
+    // snapshots stay cached and are reused where the key still matches)
+    for (uint16_t p = 0; p < DECK_MAX_PAGES; p++) {
+        if (p == g_page || !g_page_views[p]) continue;
+        lv_obj_delete(g_page_views[p]);
+        g_page_views[p] = nullptr;
+    }
+    g_pressed_cell = -1;
+    update_page_nav();
+    schedule_preload();
+    return rebuilt;
+}
+
+// UI side, LVGL loop only
+static void apply_profile_switch() {
+    if (!g_pending_switch) return;
+    g_pending_switch = false;
+    uint16_t cells = g_cols * g_rows;
+    uint16_t rebuilt = cells;
+    lv_obj_t* view = g_page_views[g_page];
+    if (lv_scr_act() != g_main_screen) lv_scr_load(g_main_screen);
+    if (view && g_switch.from && g_switch.from_page == g_page) {
+        rebuilt = apply_deck_diff(view, deck_page(*g_switch.from, g_page));
+    } else {
+        create_main_ui();
+    }
+    lv_refr_now(NULL);
+
+    g_switch_stats.count++;
+    g_switch_stats.last_us = (uint32_t)(esp_timer_get_time() - g_switch.t0);
+    g_switch_stats.cells = cells;
+    g_switch_stats.rebuilt = rebuilt;
+    Serial.printf("PROFILE: '%s' on screen in %u us (%u/%u cells rebuilt)\n", profile_get(g_profile)->name,
+                  g_switch_stats.last_us, rebuilt, cells);
+}
+
+// ==========================================
+// PERFORMANCE PROBES
+// ==========================================
+// Triggered with POST /api/bench[?grid=CxR|all], executed here on the LVGL
+// thread, result served by GET /api/bench. The grid is built once per mode below, each
+// mode adding one optimization, so every step is measured on the same profile.
+struct GridMode {
+    const char* name;
+    bool atlas;
+    bool style_pool;
+    bool prerender;
+};
+
+static const GridMode g_bench_modes[] = {
+    { "files",     false, false, false }, // per-file images, local styles (original)
+    { "atlas",     true,  false, false },
+    { "styles",    true,  true,  false },
+    { "prerender", true,  true,  true  },
+};
+
+struct GridSample {
+    uint32_t build_us;   // create_main_ui() (includes atlas sync)
+    uint32_t render_us;  // first full frame, image cache cold
+    uint32_t redraw_us;  // full invalidate + frame, cache warm
+    uint32_t rebuild_us; // create_main_ui() + frame again, nothing changed
+    int32_t heap_bytes;  // internal RAM consumed by the grid
+    int32_t psram_bytes; // PSRAM consumed by the grid (decoded images / atlas)
+    uint32_t objects;    // widgets on the main screen, plus the offscreen render cell
+    StyleMemory styles;
+};
+
+static uint32_t count_objects(const lv_obj_t* obj) {
+    if (!obj) return 0;
+    uint32_t n = 1;
+    uint32_t children = lv_obj_get_child_count(obj);
+    for (uint32_t i = 0; i < children; i++) n += count_objects(lv_obj_get_child(obj, i));
+    return n;
+}
+
+static GridSample measure_grid(const GridMode& mode) {
+    GridSample s;
+    g_atlas_enabled = mode.atlas;
+    g_style_pool_enabled = mode.style_pool;
+    g_prerender_enabled = mode.prerender;
+    g_atlas_dirty = true;
+    lv_obj_clean(g_main_screen);
+    render_cell_free();
+    style_pool_reset();
+    button_cache_clear();
+    icon_atlas_clear();
+    lv_image_cache_drop(NULL);
+
+    size_t heap0 = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+    size_t psram0 = heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
+
+    int64_t t0 = esp_timer_get_time();
+    create_main_ui();
+    int64_t t1 = esp_timer_get_time();
+    lv_refr_now(NULL);
+    int64_t t2 = esp_timer_get_time();
+    lv_obj_invalidate(g_main_screen);
+    lv_refr_now(NULL);
+    int64_t t3 = esp_timer_get_time();
+
+    s.heap_bytes = (int32_t)(heap0 - heap_caps_get_free_size(MALLOC_CAP_INTERNAL));
+    s.psram_bytes = (int32_t)(psram0 - heap_caps_get_free_size(MALLOC_CAP_SPIRAM));
+    s.styles = style_pool_measure(g_main_screen);
+    s.objects = count_objects(g_main_screen) + count_objects(g_render_cell.holder);
+
+    create_main_ui();
+    lv_refr_now(NULL);
+    int64_t t4 = esp_timer_get_time();
+
+    s.build_us = (uint32_t)(t1 - t0);
+    s.render_us = (uint32_t)(t2 - t1);
+    s.redraw_us = (uint32_t)(t3 - t2);
+    s.rebuild_us = (uint32_t)(t4 - t3);
+    return s;
+}
+
+static String grid_sample_json(const GridSample& s) {
+    return "{\"build_us\":" + String(s.build_us) + ",\"render_us\":" + String(s.render_us) +
+           ",\"redraw_us\":" + String(s.redraw_us) + ",\"rebuild_us\":" + String(s.rebuild_us) +
+           ",\"heap\":" + String(s.heap_bytes) +
+           ",\"psram\":" + String(s.psram_bytes) +
+           ",\"objects\":" + String(s.objects) +
+           ",\"local_styles\":" + String(s.styles.local_styles) +
+           ",\"local_style_bytes\":" + String(s.styles.local_bytes) +
+           ",\"shared_refs\":" + String(s.styles.shared_refs) +
+           ",\"pool_styles\":" + String(s.styles.pool_styles) +
+           ",\"pool_bytes\":" + String(s.styles.pool_bytes) + "}";
+}
+
+// All modes on the current grid
+static String bench_grid_json() {
+    String json = "{\"grid\":\"" + String(g_cols) + "x" + String(g_rows) + "\",\"modes\":{";
+    for (size_t m = 0; m < sizeof(g_bench_modes) / sizeof(g_bench_modes[0]); m++) {
+        GridSample s = measure_grid(g_bench_modes[m]);
+        if (m) json += ",";
+        json += "\"" + String(g_bench_modes[m].name) + "\":" + grid_sample_json(s);
+    }
+    json += "},\"atlas_icons\":" + String(icon_atlas_count());
+    json += ",\"atlas_bytes\":" + String(icon_atlas_bytes());
+    json += ",\"snapshots\":" + String(button_cache_count());
+    json += ",\"snapshot_bytes\":" + String(button_cache_bytes()) + "}";
+    return json;
+}
+
+static void run_grid_bench() {
+    bool was_atlas = g_atlas_enabled;
+    bool was_pool = g_style_pool_enabled;
+    bool was_prerender = g_prerender_enabled;
+    uint8_t was_cols = g_cols, was_rows = g_rows;
+    uint16_t was_page = g_page;
+    g_page = 0; // Same profile page at every size
+    lv_scr_load(g_main_screen);
+
+    String json;
+    if (g_bench_all) {
+        json = "{\"grids\":[";
+        for (size_t i = 0; i < GRID_SIZE_COUNT; i++) {
+            g_cols = g_grid_sizes[i].cols;
+            g_rows = g_grid_sizes[i].rows;
+            if (i) json += ",";
+            json += bench_grid_json();
+        }
+        json += "]}";
+    } else {
+        if (g_bench_cols) { g_cols = g_bench_cols; g_rows = g_bench_rows; }
+        json = bench_grid_json();
+    }
+    g_bench_json = json;
+    Serial.println("BENCH: " + json);
+
+    // Back to the configured grid and modes
+    g_cols = was_cols;
+    g_rows = was_rows;
+    g_page = was_page;
+    g_configs = deck_page(*g_deck, g_page);
+    g_atlas_enabled = was_atlas;
+    g_style_pool_enabled = was_pool;
+    g_prerender_enabled = was_prerender;
+    g_atlas_dirty = true;
+    g_prerender_stale = true;
+    create_main_ui();
 }
 
 // ==========================================
@@ -1805,17 +2816,122 @@ static void create_settings_ui() {
 // ==========================================
 // UI - WIFI SETUP SCREEN
 // ==========================================
+#define WIFI_RESCAN_MS 6000 // rescan interval while the WiFi screen is shown (live RSSI)
+
 struct WifiUIData {
     lv_obj_t* ta_ssid;
     lv_obj_t* ta_pass;
+    lv_obj_t* kb;
+    lv_obj_t* list;
+    lv_obj_t* list_title;
+    lv_obj_t* status;
+    std::vector<std::string> rows; // SSID per list row, in list order
+    uint32_t last_scan_ms;
+    bool connecting;               // "Save & Connect" pressed on this screen
 };
 static WifiUIData g_wifi_data;
 
+static void wifi_network_cb(lv_event_t* e) {
+    size_t row = (size_t)(uintptr_t)lv_event_get_user_data(e);
+    if (row >= g_wifi_data.rows.size()) return;
+    lv_textarea_set_text(g_wifi_data.ta_ssid, g_wifi_data.rows[row].c_str());
+    lv_textarea_set_text(g_wifi_data.ta_pass, "");
+    lv_keyboard_set_textarea(g_wifi_data.kb, g_wifi_data.ta_pass);
+}
+
+static String wifi_row_text(const WifiNetwork& n) {
+    String t = String(n.ssid) + "  " + String(n.rssi) + " dBm";
+    if (!n.secure) t += String(" (") + get_l10n()->wifi_open + ")";
+    return t;
+}
+
+// Rows keep their place while the screen is open so the list does not jump as
+// RSSI fluctuates; only a network that disappeared rebuilds it
+static void wifi_ui_update_list() {
+    WifiNetwork nets[WIFI_SCAN_MAX];
+    size_t n = wifi_mgr_networks(nets, WIFI_SCAN_MAX);
+    auto find = [&](const std::string& ssid) -> const WifiNetwork* {
+        for (size_t i = 0; i < n; i++) if (ssid == nets[i].ssid) return &nets[i];
+        return nullptr;
+    };
+
+    bool rebuild = false;
+    for (const std::string& r : g_wifi_data.rows) rebuild |= (find(r) == nullptr);
+    if (rebuild) {
+        lv_obj_clean(g_wifi_data.list);
+        g_wifi_data.rows.clear();
+    }
+    for (size_t i = 0; i < g_wifi_data.rows.size(); i++) {
+        lv_obj_t* label = lv_obj_get_child(lv_obj_get_child(g_wifi_data.list, (int32_t)i), -1);
+        lv_label_set_text(label, wifi_row_text(*find(g_wifi_data.rows[i])).c_str());
+    }
+    for (size_t i = 0; i < n; i++) {
+        bool listed = false;
+        for (const std::string& r : g_wifi_data.rows) listed |= (r == nets[i].ssid);
+        if (listed) continue;
+        lv_obj_t* btn = lv_list_add_button(g_wifi_data.list, LV_SYMBOL_WIFI, wifi_row_text(nets[i]).c_str());
+        lv_obj_add_event_cb(btn, wifi_network_cb, LV_EVENT_CLICKED, (void*)(uintptr_t)g_wifi_data.rows.size());
+        g_wifi_data.rows.push_back(nets[i].ssid);
+    }
+}
+
+static void wifi_ui_tick() {
+    if (!g_wifi_screen || lv_scr_act() != g_wifi_screen) return;
+    if (millis() - g_wifi_data.last_scan_ms < WIFI_RESCAN_MS) return;
+    g_wifi_data.last_scan_ms = millis(); // Also paces retries while a connect blocks scanning
+    if (wifi_mgr_scan()) {
+        lv_label_set_text_fmt(g_wifi_data.list_title, "%s - %s", get_l10n()->wifi_networks, get_l10n()->wifi_scanning);
+    }
+}
+
+static void wifi_done_timer_cb(lv_timer_t* t) {
+    if (lv_scr_act() == g_wifi_screen) back_to_main_cb(nullptr);
+}
+
+// Connection progress as it happens (events from wifi_mgr)
+static void wifi_ui_event(const WifiEvent& ev) {
+    const L10n* l = get_l10n();
+    switch (ev.kind) {
+        case WIFI_EV_SCAN_DONE:
+            lv_label_set_text(g_wifi_data.list_title, l->wifi_networks);
+            wifi_ui_update_list();
+            break;
+        case WIFI_EV_CONNECTING:
+            lv_label_set_text_fmt(g_wifi_data.status, l->wifi_connecting, g_wifi_ssid);
+            break;
+        case WIFI_EV_ASSOCIATED:
+            lv_label_set_text_fmt(g_wifi_data.status, l->wifi_waiting_ip, (unsigned)ev.value);
+            break;
+        case WIFI_EV_GOT_IP:
+            lv_label_set_text_fmt(g_wifi_data.status, l->wifi_connected, WiFi.localIP().toString().c_str(),
+                                  (unsigned)(ev.value / 1000));
+            if (g_wifi_data.connecting) {
+                // Leave the result readable for a moment, then back to the deck
+                g_wifi_data.connecting = false;
+                lv_timer_t* t = lv_timer_create(wifi_done_timer_cb, 1500, NULL);
+                lv_timer_set_repeat_count(t, 1);
+            }
+            break;
+        case WIFI_EV_DISCONNECTED: {
+            if (ev.reason == 0) { lv_label_set_text(g_wifi_data.status, ""); break; }
+            String why;
+            if (ev.reason == 15 || ev.reason == 202 || ev.reason == 204) why = l->wifi_bad_pass; // 4-way handshake / auth
+            else if (ev.reason == 201) why = l->wifi_no_ap;
+            else why = "#" + String(ev.reason);
+            lv_label_set_text_fmt(g_wifi_data.status, l->wifi_failed, why.c_str(), (unsigned)((ev.value + 999) / 1000));
+            break;
+        }
+    }
+}
+
 static void create_wifi_ui() {
     const L10n* l = get_l10n();
+    if (g_wifi_screen) lv_obj_delete(g_wifi_screen); // Left behind by the previous visit
     g_wifi_screen = lv_obj_create(NULL);
     lv_scr_load(g_wifi_screen);
     lv_obj_set_style_bg_color(g_wifi_screen, lv_color_hex(g_bg_color), LV_PART_MAIN);
+    g_wifi_data.rows.clear();
+    g_wifi_data.connecting = false;
 
     lv_obj_t *title = lv_label_create(g_wifi_screen);
     lv_label_set_text(title, l->wifi_setup_label);
@@ -1840,7 +2956,24 @@ static void create_wifi_ui() {
     lv_obj_align(g_wifi_data.ta_pass, LV_ALIGN_TOP_LEFT, 20, 140);
     lv_textarea_set_text(g_wifi_data.ta_pass, g_wifi_pass);
 
-    lv_obj_t *kb = lv_keyboard_create(g_wifi_screen);
+    g_wifi_data.status = lv_label_create(g_wifi_screen);
+    lv_label_set_long_mode(g_wifi_data.status, LV_LABEL_LONG_DOT);
+    lv_obj_set_width(g_wifi_data.status, 350);
+    lv_obj_align(g_wifi_data.status, LV_ALIGN_TOP_LEFT, 20, 195);
+    lv_label_set_text(g_wifi_data.status, "");
+
+    // Networks from the background scan, strongest first
+    g_wifi_data.list_title = lv_label_create(g_wifi_screen);
+    lv_label_set_text(g_wifi_data.list_title, l->wifi_networks);
+    lv_obj_align(g_wifi_data.list_title, LV_ALIGN_TOP_LEFT, 385, 50);
+    g_wifi_data.list = lv_list_create(g_wifi_screen);
+    lv_obj_set_size(g_wifi_data.list, 225, 160);
+    lv_obj_align(g_wifi_data.list, LV_ALIGN_TOP_LEFT, 385, 70);
+    wifi_ui_update_list(); // Cached results right away
+    g_wifi_data.last_scan_ms = millis() - WIFI_RESCAN_MS; // Fresh scan on the next loop
+
+    g_wifi_data.kb = lv_keyboard_create(g_wifi_screen);
+    lv_obj_t *kb = g_wifi_data.kb;
     lv_keyboard_set_textarea(kb, g_wifi_data.ta_ssid);
     lv_obj_set_size(kb, 780, 240);
     lv_obj_align(kb, LV_ALIGN_BOTTOM_MID, 0, -5);
@@ -1956,11 +3089,20 @@ static void create_edit_ui(uint8_t idx) {
         while(f){
             String fname = f.name();
             if (!fname.startsWith("/")) fname = "/" + fname;
+            if (is_system_file(fname)) { f = root.openNextFile(); continue; }
             opts += "\n" + fname.substring(1); // Show name without slash in dropdown
             if (fname == g_configs[idx].imgPath) sel_idx = current_f;
             f = root.openNextFile();
             current_f++;
         }
+        // Packed images from the assets partition (skip names shadowed by a LittleFS file)
+        for (uint16_t a = 0; a < asset_store_count(); a++) {
+            const char* aname = asset_store_entry(a)->name;
+            if (LittleFS.exists(aname)) continue;
+            opts += "\n" + String(aname + 1);
+            if (strcmp(aname, g_configs[idx].imgPath) == 0) sel_idx = current_f;
+            current_f++;
+        }
         lv_dropdown_set_options(g_edit_data.dd_img, opts.c_str());
         lv_dropdown_set_selected(g_edit_data.dd_img, sel_idx);
     }
@@ -2019,6 +3161,22 @@ static void btn_event_cb(lv_event_t *e) {
     StreamDeckApp::handle_button(idx);
 }
 
+static void page_nav_cb(lv_event_t *e) {
+    int dir = (int)(intptr_t)lv_event_get_user_data(e);
+    if (dir < 0 && g_page > 0) show_page(g_page - 1);
+    else if (dir > 0) show_page(g_page + 1);
+}
+
+static void page_gesture_cb(lv_event_t *e) {
+    if (lv_scr_act() != g_main_screen) return;
+    lv_indev_t* indev = lv_indev_active();
+    lv_dir_t dir = lv_indev_get_gesture_dir(indev);
+    if (dir != LV_DIR_LEFT && dir != LV_DIR_RIGHT) return;
+    lv_indev_wait_release(indev); // A swipe must not also click the button under it
+    if (dir == LV_DIR_LEFT) show_page(g_page + 1);
+    else if (g_page > 0) show_page(g_page - 1);
+}
+
 static void slider_event_cb(lv_event_t *e) {
     lv_obj_t *slider = (lv_obj_t*)lv_event_get_target(e);
     int32_t val = lv_slider_get_value(slider);
@@ -2053,11 +3211,9 @@ static void save_wifi_cb(lv_event_t *e) {
     strncpy(g_wifi_pass, lv_textarea_get_text(g_wifi_data.ta_pass), 63);
     
     save_settings();
-    WiFi.disconnect();
-    WiFi.begin(g_wifi_ssid, g_wifi_pass);
-    
-    lv_scr_load(g_main_screen);
-    create_main_ui();
+    // Stay here: progress arrives as WiFi events, success returns to the deck
+    g_wifi_data.connecting = true;
+    wifi_mgr_connect(g_wifi_ssid, g_wifi_pass, true);
 }
 
 static void settings_btn_cb(lv_event_t *e) {
@@ -2088,46 +3244,51 @@ static void save_edit_cb(lv_event_t *e) {
     if (g_editing_bg) {
         g_bg_color = hex;
     } else {
+        size_t index = (size_t)g_page * DECK_PAGE_SLOTS + g_editing_idx;
+        ButtonConfig cfg;
+        deck_get(*g_deck, index, cfg);
+
         // Clear all fields before copying new data
-        memset(g_configs[g_editing_idx].label, 0, 16);
-        memset(g_configs[g_editing_idx].value, 0, 256);
-        memset(g_configs[g_editing_idx].icon, 0, 8);
-        memset(g_configs[g_editing_idx].imgPath, 0, 32);
+        memset(cfg.label, 0, 16);
+        memset(cfg.value, 0, 256);
+        memset(cfg.icon, 0, 8);
+        memset(cfg.imgPath, 0, 32);
         
         if (data) {
-            strncpy(g_configs[g_editing_idx].label, lv_textarea_get_text(data->ta_label), 15);
-            strncpy(g_configs[g_editing_idx].value, lv_textarea_get_text(data->ta_value), 255);
-            g_configs[g_editing_idx].type = (uint8_t)lv_dropdown_get_selected(data->dd_type);
+            strncpy(cfg.label, lv_textarea_get_text(data->ta_label), 15);
+            strncpy(cfg.value, lv_textarea_get_text(data->ta_value), 255);
+            cfg.type = (uint8_t)lv_dropdown_get_selected(data->dd_type);
             
             const char* sym = get_symbol_by_index(lv_dropdown_get_selected(data->dd_icon));
             if (sym) {
                 // Calculate actual symbol length safely (UTF-8 aware)
                 size_t sym_len = strlen(sym);
                 if (sym_len > 0 && sym_len < 8) {
-                    strncpy(g_configs[g_editing_idx].icon, sym, sym_len);
-                    g_configs[g_editing_idx].icon[sym_len] = '\0';
+                    strncpy(cfg.icon, sym, sym_len);
+                    cfg.icon[sym_len] = '\0';
                 }
             }
 
             char buf[64];
             lv_dropdown_get_selected_str(data->dd_img, buf, sizeof(buf));
             if (strcmp(buf, l->none) == 0) {
-                g_configs[g_editing_idx].imgPath[0] = '\0';
+                cfg.imgPath[0] = '\0';
             } else {
                 String val = buf;
                 if (!val.startsWith("/")) val = "/" + val;
-                strncpy(g_configs[g_editing_idx].imgPath, val.c_str(), 31);
-                g_configs[g_editing_idx].imgPath[31] = '\0';
+                strncpy(cfg.imgPath, val.c_str(), 31);
+                cfg.imgPath[31] = '\0';
             }
         }
         
-        g_configs[g_editing_idx].color = hex;
+        cfg.color = hex;
         
         // Log the saved configuration for debugging
         // Serial.printf("Button %d saved: label='%s', type=%d, icon_len=%d, img='%s', color=0x%06X\n", 
-        //     g_editing_idx, g_configs[g_editing_idx].label, g_configs[g_editing_idx].type,
-        //     (int)strlen(g_configs[g_editing_idx].icon), g_configs[g_editing_idx].imgPath, 
-        //     g_configs[g_editing_idx].color);
+        //     g_editing_idx, cfg.label, cfg.type,
+        //     (int)strlen(cfg.icon), cfg.imgPath, 
+        //     cfg.color);
+        if (!deck_set(*g_deck, index, cfg)) Serial.println("STORAGE ERROR: out of memory, button not saved");
     }
     
     save_settings();
@@ -2143,11 +3304,8 @@ static void grid_select_cb(lv_event_t *e) {
     if(txt) strncpy(buf, txt, sizeof(buf));
     else buf[0] = '\0';
     
-    if (strcmp(buf, "2x2") == 0) { g_cols = 2; g_rows = 2; }
-    else if (strcmp(buf, "3x2") == 0) { g_cols = 3; g_rows = 2; }
-    else if (strcmp(buf, "3x3") == 0) { g_cols = 3; g_rows = 3; }
-    else if (strcmp(buf, "4x3") == 0) { g_cols = 4; g_rows = 3; }
-    else if (strcmp(buf, "5x3") == 0) { g_cols = 5; g_rows = 3; }
+    int c = 0, r = 0;
+    if (sscanf(buf, "%dx%d", &c, &r) == 2 && grid_size_supported(c, r)) { g_cols = c; g_rows = r; }
     
     g_settings_needs_rebuild = true; // Force settings screen rebuild with new button count
     save_settings();
@@ -2170,9 +3328,10 @@ static void settings_grid_btn_cb(lv_event_t* e) {
     lv_obj_set_size(list, 400, 320);
     lv_obj_align(list, LV_ALIGN_CENTER, 0, 0);
     
-    const char* opts[] = {"2x2", "3x2", "3x3", "4x3", "5x3"};
-    for(int i=0; i<5; i++) {
-        lv_obj_t *btn = lv_list_add_btn(list, "\xEF\x80\x8A", opts[i]);
+    for(size_t i=0; i<GRID_SIZE_COUNT; i++) {
+        char opt[8];
+        snprintf(opt, sizeof(opt), "%ux%u", (unsigned)g_grid_sizes[i].cols, (unsigned)g_grid_sizes[i].rows);
+        lv_obj_t *btn = lv_list_add_btn(list, "\xEF\x80\x8A", opt);
         lv_obj_add_event_cb(btn, grid_select_cb, LV_EVENT_CLICKED, NULL);
     }
     
@@ -2185,19 +3344,11 @@ static void settings_grid_btn_cb(lv_event_t* e) {
 }
 
 static void os_select_cb(lv_event_t *e) {
-    lv_obj_t *obj = (lv_obj_t *)lv_event_get_target(e);
-    char buf[16];
-    const char * txt = lv_list_get_button_text(lv_obj_get_parent(obj), obj);
-    if(txt) strncpy(buf, txt, sizeof(buf));
-    else buf[0] = '\0';
-    
-    if (strcmp(buf, "Windows") == 0) g_target_os = 0;
-    else if (strcmp(buf, "macOS") == 0) g_target_os = 1;
-    
-    save_settings(false); // Only save the OS preference, DON'T overwrite buttons
-    load_settings();     // Reload Buttons for the target OS
-    lv_scr_load(g_main_screen);
-    create_main_ui();
+    // Tap time: the latency reported is tap to first frame of the new profile
+    int64_t t0 = esp_timer_get_time();
+    uint8_t id = (uint8_t)(uintptr_t)lv_event_get_user_data(e);
+    if (select_profile(id, t0)) apply_profile_switch();
+    else lv_scr_load(g_main_screen);
 }
 
 static void settings_os_btn_cb(lv_event_t* e) {
@@ -2215,10 +3366,12 @@ static void settings_os_btn_cb(lv_event_t* e) {
     lv_obj_set_size(list, 400, 320);
     lv_obj_align(list, LV_ALIGN_CENTER, 0, 0);
     
-    const char* opts[] = {"Windows", "macOS"};
-    for(int i=0; i<2; i++) {
-        lv_obj_t *btn = lv_list_add_btn(list, "\xEF\x84\xb9", opts[i]);
-        lv_obj_add_event_cb(btn, os_select_cb, LV_EVENT_CLICKED, NULL);
+    for(uint8_t i=0; i<profile_count(); i++) {
+        const Profile* p = profile_get(i);
+        char opt[PROFILE_NAME_LEN + 16];
+        snprintf(opt, sizeof(opt), "%s (%s)", p->name, p->os == 1 ? "macOS" : "Windows");
+        lv_obj_t *btn = lv_list_add_btn(list, i == g_profile ? LV_SYMBOL_OK : "\xEF\x84\xb9", opt);
+        lv_obj_add_event_cb(btn, os_select_cb, LV_EVENT_CLICKED, (void*)(uintptr_t)i);
     }
     
     lv_obj_t *back = lv_btn_create(screen);
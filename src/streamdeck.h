@@ -9,6 +9,10 @@
 
 class StreamDeckApp {
 public:
+    // Starts what needs no display (WiFi, LittleFS, BLE) so it overlaps panel init
+    static void early_setup();
+    // pt_setup_display() fill hook: the last saved main screen
+    static bool draw_splash(uint16_t* fb, uint16_t w, uint16_t h);
     static void setup();
     static void loop();
     static void handle_button(uint8_t action_id); 
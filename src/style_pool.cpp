@@ -0,0 +1,128 @@
+#include "style_pool.h"
+#include <src/core/lv_obj_private.h>       // obj->styles / style_cnt
+#include <src/core/lv_obj_style_private.h> // lv_obj_style_t::is_local
+#include <vector>
+
+#define STYLE_POOL_TRIM_AT 80 // more than one 10x6 grid worth of distinct looks
+
+enum StyleKind : uint8_t { KIND_PANEL, KIND_CELL, KIND_TEXT, KIND_BOX };
+
+struct PoolEntry {
+    uint8_t kind;
+    uint32_t color;
+    const lv_font_t* font;
+    int32_t value;
+    int32_t aux;
+    lv_style_t style;
+};
+
+// Entries are heap allocated one by one: objects hold pointers to `style`
+static std::vector<PoolEntry*> g_pool;
+
+static PoolEntry* find_or_add(uint8_t kind, uint32_t color, const lv_font_t* font, int32_t value, bool* added,
+                              int32_t aux = 0) {
+    for (PoolEntry* e : g_pool) {
+        if (e->kind == kind && e->color == color && e->font == font && e->value == value && e->aux == aux) {
+            *added = false;
+            return e;
+        }
+    }
+    PoolEntry* e = new PoolEntry();
+    e->kind = kind;
+    e->color = color;
+    e->font = font;
+    e->value = value;
+    e->aux = aux;
+    lv_style_init(&e->style);
+    g_pool.push_back(e);
+    *added = true;
+    return e;
+}
+
+const lv_style_t* style_pool_panel(uint32_t bg_color, int32_t pad) {
+    bool added;
+    PoolEntry* e = find_or_add(KIND_PANEL, bg_color, nullptr, pad, &added);
+    if (added) {
+        lv_style_set_bg_color(&e->style, lv_color_hex(bg_color));
+        lv_style_set_border_width(&e->style, 0);
+        lv_style_set_pad_all(&e->style, pad);
+        lv_style_set_pad_gap(&e->style, pad);
+    }
+    return &e->style;
+}
+
+const lv_style_t* style_pool_cell(uint32_t bg_color, int32_t pad_row, int32_t pad) {
+    bool added;
+    PoolEntry* e = find_or_add(KIND_CELL, bg_color, nullptr, pad_row, &added, pad);
+    if (added) {
+        lv_style_set_bg_color(&e->style, lv_color_hex(bg_color));
+        lv_style_set_layout(&e->style, LV_LAYOUT_FLEX);
+        lv_style_set_flex_flow(&e->style, LV_FLEX_FLOW_COLUMN);
+        lv_style_set_flex_main_place(&e->style, LV_FLEX_ALIGN_CENTER);
+        lv_style_set_flex_cross_place(&e->style, LV_FLEX_ALIGN_CENTER);
+        lv_style_set_flex_track_place(&e->style, LV_FLEX_ALIGN_CENTER);
+        lv_style_set_pad_row(&e->style, pad_row);
+        if (pad >= 0) lv_style_set_pad_all(&e->style, pad);
+    }
+    return &e->style;
+}
+
+const lv_style_t* style_pool_text(const lv_font_t* font) {
+    bool added;
+    PoolEntry* e = find_or_add(KIND_TEXT, 0, font, 0, &added);
+    if (added) lv_style_set_text_font(&e->style, font);
+    return &e->style;
+}
+
+const lv_style_t* style_pool_box(int32_t size) {
+    bool added;
+    PoolEntry* e = find_or_add(KIND_BOX, 0, nullptr, size, &added);
+    if (added) {
+        lv_style_set_width(&e->style, size);
+        lv_style_set_height(&e->style, size);
+    }
+    return &e->style;
+}
+
+void style_pool_reset() {
+    for (PoolEntry* e : g_pool) {
+        lv_style_reset(&e->style);
+        delete e;
+    }
+    g_pool.clear();
+}
+
+void style_pool_trim() {
+    // Colors edited over time leave unused entries behind; drop them in bulk
+    if (g_pool.size() > STYLE_POOL_TRIM_AT) style_pool_reset();
+}
+
+static uint32_t style_bytes(const lv_style_t* s) {
+    return sizeof(lv_style_t) + s->prop_cnt * (sizeof(lv_style_value_t) + sizeof(lv_style_prop_t));
+}
+
+static void measure_obj(const lv_obj_t* obj, StyleMemory& m) {
+    for (uint32_t i = 0; i < obj->style_cnt; i++) {
+        const lv_obj_style_t& os = obj->styles[i];
+        if (os.is_local) {
+            m.local_styles++;
+            m.local_bytes += sizeof(lv_obj_style_t) + style_bytes(os.style);
+        } else {
+            for (const PoolEntry* e : g_pool) {
+                if (os.style == &e->style) { m.shared_refs++; break; }
+            }
+        }
+    }
+    uint32_t n = lv_obj_get_child_count(obj);
+    for (uint32_t i = 0; i < n; i++) measure_obj(lv_obj_get_child(obj, i), m);
+}
+
+StyleMemory style_pool_measure(const lv_obj_t* root) {
+    StyleMemory m = {};
+    if (root) measure_obj(root, m);
+    m.pool_styles = g_pool.size();
+    for (const PoolEntry* e : g_pool) m.pool_bytes += sizeof(PoolEntry) + style_bytes(&e->style) - sizeof(lv_style_t);
+    // Each shared reference still costs its lv_obj_style_t slot
+    m.pool_bytes += m.shared_refs * sizeof(lv_obj_style_t);
+    return m;
+}
@@ -0,0 +1,46 @@
+#ifndef STYLE_POOL_H
+#define STYLE_POOL_H
+
+#include <lvgl.h>
+
+// ==========================================
+// SHARED STYLE POOL
+// ==========================================
+// lv_obj_set_style_*() gives every widget its own local style (an lv_style_t,
+// a property array and a slot in obj->styles), allocated again on every grid
+// rebuild. The pool interns one lv_style_t per (kind, color, font, value) so
+// cells with the same look share a single style, and the styles survive
+// rebuilds.
+//
+// Pooled styles must only be attached to objects that are deleted before
+// style_pool_trim()/style_pool_reset() runs (the main grid).
+
+// Grid container: background, no border, `pad` around and between cells
+const lv_style_t* style_pool_panel(uint32_t bg_color, int32_t pad);
+
+// Button cell: background + centered column flex with `pad_row` between children.
+// `pad` < 0 keeps the theme's button padding.
+const lv_style_t* style_pool_cell(uint32_t bg_color, int32_t pad_row, int32_t pad = -1);
+
+const lv_style_t* style_pool_text(const lv_font_t* font);
+
+// Square size (button images)
+const lv_style_t* style_pool_box(int32_t size);
+
+// Frees every pooled style once the pool has grown past what one grid needs.
+// Call right after the objects using them were deleted.
+void style_pool_trim();
+void style_pool_reset();
+
+struct StyleMemory {
+    uint32_t local_styles; // styles owned by a single object
+    uint32_t local_bytes;
+    uint32_t shared_refs;  // references to pooled styles
+    uint32_t pool_styles;
+    uint32_t pool_bytes;
+};
+
+// Style memory used by `root` and its children, plus the pool itself
+StyleMemory style_pool_measure(const lv_obj_t* root);
+
+#endif // STYLE_POOL_H
@@ -0,0 +1,339 @@
+#include "upload.h"
+#include <Arduino.h>
+#include <AsyncTCP.h>
+#include <LittleFS.h>
+#include <esp_heap_caps.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#include <lwip/opt.h>
+#include <vector>
+
+// Deferred bytes always leave a segment of window open, so the sender keeps
+// trickling data and the handler gets called to release the rest. One more
+// segment of margin: the multipart parser hands over data a segment late.
+#define UPLOAD_HELD_MAX (TCP_WND - 2 * TCP_MSS)
+
+static uint8_t* g_ring = nullptr;
+static size_t g_head = 0;  // next byte the handler writes
+static size_t g_tail = 0;  // next byte the writer takes
+static size_t g_level = 0; // bytes queued
+
+static uint32_t g_id = 0; // running upload, 0: none
+static uint32_t g_next_id = 1;
+static upload_sink g_sink = nullptr;
+static upload_finish g_finish = nullptr;
+static void* g_ctx = nullptr;
+static AsyncClient* g_client = nullptr;
+// Bytes received with ackLater() and not acknowledged since. AsyncClient is
+// not thread-safe: only the client's task (upload_feed, end_upload) acks.
+static size_t g_held = 0;
+static bool g_ending = false;
+static bool g_ended = false;    // end_upload() ran: the writer finishes it
+static bool g_failed = false;
+static bool g_finished = false; // the writer ran the finish callback
+static bool g_result = false;   // what it returned
+static bool g_orphan = false;   // the web side stopped waiting: the writer releases g_ctx
+static upload_release g_release = nullptr;
+static uint32_t g_stall_ms = 0; // upload_feed() time spent waiting for ring space
+static int64_t g_t0 = 0;
+static UploadStats g_stats = {};
+static char g_error[80] = "";
+
+static SemaphoreHandle_t g_lock = nullptr;
+static SemaphoreHandle_t g_space = nullptr; // the writer freed ring space
+static SemaphoreHandle_t g_done = nullptr;  // the writer finished an ending upload
+static TaskHandle_t g_task = nullptr;
+
+static void lock() {
+    xSemaphoreTake(g_lock, portMAX_DELAY);
+}
+
+static void unlock() {
+    xSemaphoreGive(g_lock);
+}
+
+static void fail(const char* msg) {
+    lock();
+    if (!g_failed) snprintf(g_error, sizeof(g_error), "%s", msg);
+    g_failed = true;
+    unlock();
+}
+
+static void upload_task(void*) {
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        for (;;) {
+            lock();
+            size_t n = g_level >= UPLOAD_BLOCK ? UPLOAD_BLOCK : (g_ending ? g_level : 0);
+            if (n > UPLOAD_RING - g_tail) n = UPLOAD_RING - g_tail;
+            size_t tail = g_tail;
+            bool failed = g_failed;
+            unlock();
+            if (!n) break;
+
+            // After a failure the rest is only drained
+            bool ok = failed || g_sink(g_ctx, g_ring + tail, n);
+            if (!ok) fail("Write failed");
+            lock();
+            if (!failed && ok) g_stats.bytes += n;
+            g_tail = (tail + n) % UPLOAD_RING;
+            g_level -= n;
+            unlock();
+            xSemaphoreGive(g_space);
+        }
+
+        lock();
+        bool drained = g_ending && g_level == 0;
+        if (drained) g_ending = false;
+        bool ok = !g_failed;
+        unlock();
+        if (!drained) continue;
+
+        // The finish callback runs here, after the sink's last call, never on the web task
+        if (g_finish && !g_finish(g_ctx, ok)) ok = false;
+        lock();
+        if (!ok && !g_error[0]) snprintf(g_error, sizeof(g_error), "Write failed");
+        g_stats.ms = g_t0 ? (uint32_t)((esp_timer_get_time() - g_t0) / 1000) : 0;
+        g_stats.kbps = g_stats.ms ? (uint32_t)((uint64_t)g_stats.bytes * 1000 / 1024 / g_stats.ms) : 0;
+        g_result = ok;
+        g_finished = true;
+        bool orphan = g_orphan;
+        unlock();
+        if (orphan) {
+            Serial.printf("UPLOAD: finished after the reply (%s)\n", ok ? "kept" : g_error);
+            if (g_release) g_release(g_ctx);
+        }
+        xSemaphoreGive(g_done);
+        lock();
+        g_id = 0;
+        unlock();
+    }
+}
+
+void upload_begin() {
+    if (!g_lock) g_lock = xSemaphoreCreateMutex();
+    if (!g_space) g_space = xSemaphoreCreateBinary();
+    if (!g_done) g_done = xSemaphoreCreateBinary();
+    if (!g_ring) g_ring = (uint8_t*)heap_caps_malloc(UPLOAD_RING, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!g_ring) Serial.println("UPLOAD: no memory for the upload buffer");
+    if (!g_task) xTaskCreate(upload_task, "upload", 4096, NULL, 1, &g_task);
+}
+
+uint32_t upload_start(upload_sink sink, upload_finish finish, void* ctx, AsyncClient* client, upload_release release) {
+    if (!g_ring || !g_task) return 0;
+    lock();
+    if (g_id) {
+        unlock();
+        return 0;
+    }
+    g_id = g_next_id++;
+    g_head = g_tail = g_level = 0;
+    g_sink = sink;
+    g_finish = finish;
+    g_ctx = ctx;
+    g_release = release;
+    g_client = client;
+    g_held = 0;
+    g_ending = g_ended = g_failed = g_finished = g_result = g_orphan = false;
+    g_stall_ms = 0;
+    g_t0 = 0;
+    g_stats = {};
+    g_error[0] = '\0';
+    uint32_t id = g_id;
+    unlock();
+    xSemaphoreTake(g_done, 0); // Left over from an aborted upload
+    return id;
+}
+
+bool upload_feed(const uint8_t* data, size_t len) {
+    if (!g_id) return false;
+    if (!g_t0) g_t0 = esp_timer_get_time();
+    size_t received = len;
+    while (len) {
+        lock();
+        size_t room = UPLOAD_RING - g_level;
+        size_t head = g_head;
+        bool failed = g_failed;
+        unlock();
+        if (failed) return false;
+        if (!room) {
+            // The sender's window was larger than what the ring had left. The web
+            // task waits for the writer at most UPLOAD_STALL_MS over the whole upload.
+            xTaskNotifyGive(g_task);
+            uint32_t t = millis();
+            uint32_t left = g_stall_ms < UPLOAD_STALL_MS ? UPLOAD_STALL_MS - g_stall_ms : 0;
+            if (!left || xSemaphoreTake(g_space, pdMS_TO_TICKS(left)) != pdTRUE) {
+                fail("Storage too slow");
+                return false;
+            }
+            g_stall_ms += millis() - t;
+            continue;
+        }
+        size_t n = len < room ? len : room;
+        if (n > UPLOAD_RING - head) n = UPLOAD_RING - head;
+        memcpy(g_ring + head, data, n);
+        lock();
+        g_head = (head + n) % UPLOAD_RING;
+        g_level += n;
+        unlock();
+        data += n;
+        len -= n;
+    }
+
+    lock();
+    bool full = g_level >= UPLOAD_HIGH_WATER;
+    bool hold = g_client && full && g_held + received <= UPLOAD_HELD_MAX;
+    if (hold && !g_held) g_stats.pauses++;
+    bool wake = g_level >= UPLOAD_BLOCK;
+    unlock();
+    // The writer caught up: what was deferred goes now (not this segment,
+    // AsyncClient counts it only after we return)
+    if (g_held && !full) {
+        g_client->ack(SIZE_MAX);
+        g_held = 0;
+    }
+    // Defers the segment being received, which narrows the sender's window
+    if (hold) {
+        g_client->ackLater();
+        g_held += received;
+    }
+    if (wake) xTaskNotifyGive(g_task);
+    return true;
+}
+
+// Detaches the client and has the writer drain the ring and finish. Waits
+// for that at most `wait_ms`; true if it finished, false if the writer now
+// owns the context (it releases it when done).
+static bool end_upload(bool abort, uint32_t wait_ms) {
+    lock();
+    if (abort && !g_failed) snprintf(g_error, sizeof(g_error), "Connection lost");
+    if (abort) g_failed = true;
+    AsyncClient* c = g_client;
+    g_client = nullptr;
+    g_ending = g_ended = true;
+    unlock();
+    // We are on the client's task here: the body is complete, what is still deferred goes now
+    if (c && g_held && !abort) c->ack(SIZE_MAX);
+    g_held = 0;
+    xTaskNotifyGive(g_task);
+    if (wait_ms && xSemaphoreTake(g_done, pdMS_TO_TICKS(wait_ms)) == pdTRUE) return true;
+
+    lock();
+    bool finished = g_finished;
+    if (!finished) {
+        // Whatever is left is dropped, but the sink may be inside a write
+        if (!g_failed) snprintf(g_error, sizeof(g_error), "Storage too slow");
+        g_failed = true;
+        g_orphan = true;
+    }
+    unlock();
+    return finished;
+}
+
+UploadResult upload_end(UploadStats& st) {
+    if (!g_id) return UPLOAD_FAILED;
+    bool finished = end_upload(false, UPLOAD_WAIT_MS);
+    lock();
+    st = g_stats;
+    bool ok = g_result;
+    unlock();
+    if (!finished) return UPLOAD_PENDING;
+    return ok ? UPLOAD_OK : UPLOAD_FAILED;
+}
+
+bool upload_abort(uint32_t id) {
+    lock();
+    bool running = id && g_id == id;
+    bool ended = g_ended;
+    bool orphan = g_orphan;
+    unlock();
+    if (!running) return true;
+    if (ended) return !orphan; // upload_end() already ran; the writer is finishing it
+    Serial.printf("UPLOAD: aborted after %u bytes\n", (unsigned)g_stats.bytes);
+    return end_upload(true, 0);
+}
+
+const char* upload_error() {
+    return g_error;
+}
+
+// ------------------------------------------
+// Asset uploads
+// ------------------------------------------
+static File g_file;
+static String g_file_path;
+static String g_file_tmp;
+
+static bool file_sink(void*, const uint8_t* data, size_t len) {
+    if (g_file.write(data, len) == len) return true;
+    fail("Write failed (storage full?)");
+    return false;
+}
+
+static bool file_finish(void*, bool ok) {
+    g_file.close();
+    // The old file stays in place until the new one is complete
+    if (ok && LittleFS.rename(g_file_tmp, g_file_path)) return true;
+    if (ok) snprintf(g_error, sizeof(g_error), "Could not replace %s", g_file_path.c_str());
+    LittleFS.remove(g_file_tmp);
+    return false;
+}
+
+void upload_tmp_path(const char* path, char* out, size_t out_len) {
+    snprintf(out, out_len, "/" UPLOAD_TMP_PREFIX "%s", path[0] == '/' ? path + 1 : path);
+    for (char* c = out + 1; *c; c++) {
+        if (*c == '/') *c = '_';
+    }
+}
+
+UploadResult upload_prepare(size_t size) {
+    if (g_id) {
+        snprintf(g_error, sizeof(g_error), "Another upload is in progress");
+        return UPLOAD_BUSY;
+    }
+
+    // Leftovers of uploads a reset interrupted
+    std::vector<String> stale;
+    File root = LittleFS.open("/");
+    for (File f = root.openNextFile(); f; f = root.openNextFile()) {
+        if (strncmp(f.name(), UPLOAD_TMP_PREFIX, strlen(UPLOAD_TMP_PREFIX)) == 0) stale.push_back(String("/") + f.name());
+    }
+    root.close();
+    for (const String& p : stale) LittleFS.remove(p);
+
+    // Replaced files are still there while their successors are written
+    size_t total = LittleFS.totalBytes(), used = LittleFS.usedBytes();
+    size_t avail = total > used ? total - used : 0;
+    if (size + UPLOAD_FS_RESERVE > avail) {
+        snprintf(g_error, sizeof(g_error), "Not enough space: %u KB free, %u KB needed",
+                 (unsigned)(avail / 1024), (unsigned)((size + UPLOAD_FS_RESERVE + 1023) / 1024));
+        return UPLOAD_NO_SPACE;
+    }
+    return UPLOAD_OK;
+}
+
+UploadResult upload_file_start(const char* path, size_t size, AsyncClient* client, uint32_t* id) {
+    *id = 0;
+    UploadResult res = upload_prepare(size);
+    if (res != UPLOAD_OK) return res;
+
+    char tmp[72];
+    upload_tmp_path(path, tmp, sizeof(tmp));
+    g_file_path = path;
+    g_file_tmp = tmp;
+    g_file = LittleFS.open(g_file_tmp, "w");
+    if (!g_file) {
+        snprintf(g_error, sizeof(g_error), "Could not create %s", tmp);
+        return UPLOAD_FAILED;
+    }
+    *id = upload_start(file_sink, file_finish, nullptr, client);
+    if (!*id) {
+        g_file.close();
+        LittleFS.remove(g_file_tmp);
+        snprintf(g_error, sizeof(g_error), g_ring ? "Another upload is in progress" : "Out of memory");
+        return g_ring ? UPLOAD_BUSY : UPLOAD_FAILED;
+    }
+    return UPLOAD_OK;
+}
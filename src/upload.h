@@ -0,0 +1,99 @@
+#ifndef UPLOAD_H
+#define UPLOAD_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+class AsyncClient;
+
+// ==========================================
+// BUFFERED UPLOADS
+// ==========================================
+// Request bodies are copied by the web handler into a PSRAM ring and handed
+// to a sink by a writer task in UPLOAD_BLOCK pieces that start on a block
+// boundary of the ring, so the flash sees few large writes instead of one per
+// TCP segment and the web server's task never waits for flash.
+//
+// Flow control: while the ring holds UPLOAD_HIGH_WATER bytes or more the
+// handler defers the TCP acknowledgement of what it receives
+// (AsyncClient::ackLater), which narrows the sender's window down to one
+// segment; the first segment that arrives once the ring is below the mark
+// acknowledges them all. Only the handler acks: AsyncClient must not be used
+// from the writer task. The handler blocks only if the ring fills regardless
+// (UPLOAD_STALL_MS at most over the whole upload, then the upload fails).
+//
+// The writer task also runs the finish callback once the ring is drained.
+// upload_end() waits for that signal at most UPLOAD_WAIT_MS; past that the
+// upload is failed, the reply goes out, and the writer finishes on its own,
+// releasing the context.
+//
+// One upload at a time.
+
+#define UPLOAD_RING       (64 * 1024)
+#define UPLOAD_BLOCK      4096 // LittleFS block; UPLOAD_RING is a multiple
+#define UPLOAD_HIGH_WATER (UPLOAD_RING / 2)
+#define UPLOAD_WAIT_MS    5000 // longest upload_end() wait for the writer to finish
+#define UPLOAD_STALL_MS   1000 // longest total upload_feed() wait for ring space
+#define UPLOAD_FS_RESERVE (4 * 4096) // LittleFS needs spare blocks to write at all
+#define UPLOAD_TMP_PREFIX ".up_"
+
+// Receives the body in order, on the writer task; false fails the upload
+typedef bool (*upload_sink)(void* ctx, const uint8_t* data, size_t len);
+
+// Called once, on the writer task, after the sink's last call.
+// `ok`: complete and accepted. Returns whether the result was kept.
+typedef bool (*upload_finish)(void* ctx, bool ok);
+
+// Frees `ctx` after the finish callback when the web side gave up waiting
+typedef void (*upload_release)(void* ctx);
+
+enum UploadResult : uint8_t {
+    UPLOAD_OK, UPLOAD_BUSY, UPLOAD_NO_SPACE, UPLOAD_INVALID, UPLOAD_FAILED,
+    UPLOAD_PENDING // upload_end(): failed, still finishing; the writer owns the context
+};
+
+struct UploadStats {
+    uint32_t bytes;  // handed to the sink
+    uint32_t ms;     // first byte received to last byte written
+    uint32_t kbps;   // KB/s over that time
+    uint16_t pauses; // times the TCP receive was held back
+};
+
+// Allocates the ring and starts the writer task
+void upload_begin();
+
+// Starts an upload into `sink`. `client` (may be null) is the connection to
+// throttle. Returns its id, 0 if another upload is running or no memory.
+uint32_t upload_start(upload_sink sink, upload_finish finish, void* ctx, AsyncClient* client,
+                      upload_release release = nullptr);
+
+// Web handler side: queues body bytes. False once the upload has failed.
+bool upload_feed(const uint8_t* data, size_t len);
+
+// Ends the upload once the body is complete; call it from the web handler.
+// Waits for the writer to drain and finish, UPLOAD_WAIT_MS at most.
+// UPLOAD_OK if the result was kept.
+UploadResult upload_end(UploadStats& st);
+
+// The client of upload `id` went away: drops what is queued and has the
+// writer end it, without waiting. false: the writer still uses the context
+// and releases it; true: it may be freed now.
+bool upload_abort(uint32_t id);
+
+// Before writing `size` bytes of files: UPLOAD_BUSY while another upload
+// runs, UPLOAD_NO_SPACE unless they fit with UPLOAD_FS_RESERVE to spare. Also
+// removes temporary files of uploads a reset interrupted.
+UploadResult upload_prepare(size_t size);
+
+// Hidden name `path` is written under until it is complete ("/.up_<name>")
+void upload_tmp_path(const char* path, char* out, size_t out_len);
+
+// Asset upload: written to a hidden temporary file that upload_end() renames
+// over `path` only if it is complete. `size` (the request's content length)
+// must fit in the free space up front.
+UploadResult upload_file_start(const char* path, size_t size, AsyncClient* client, uint32_t* id);
+
+// Why the last upload failed
+const char* upload_error();
+
+#endif // UPLOAD_H
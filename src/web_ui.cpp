@@ -0,0 +1,24 @@
+#include "web_ui.h"
+#include "web_bundle.h"
+#include <ESPAsyncWebServer.h>
+
+static void send_file(AsyncWebServerRequest* request, const WebBundleFile* f) {
+    AsyncWebServerResponse* response;
+    if (request->hasHeader("If-None-Match") && request->getHeader("If-None-Match")->value() == f->etag) {
+        response = request->beginResponse(304);
+    } else {
+        // Browsers all take gzip; plain clients need e.g. curl --compressed
+        response = request->beginResponse_P(200, f->type, f->gz, f->len);
+        response->addHeader("Content-Encoding", "gzip");
+    }
+    response->addHeader("ETag", f->etag);
+    response->addHeader("Cache-Control", f->immutable ? "public, max-age=31536000, immutable" : "no-cache");
+    request->send(response);
+}
+
+void web_ui_begin(AsyncWebServer& server) {
+    for (size_t i = 0; i < WEB_BUNDLE_COUNT; i++) {
+        const WebBundleFile* f = &WEB_BUNDLE[i];
+        server.on(f->path, HTTP_GET, [f](AsyncWebServerRequest* request) { send_file(request, f); });
+    }
+}
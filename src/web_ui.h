@@ -0,0 +1,21 @@
+#ifndef WEB_UI_H
+#define WEB_UI_H
+
+class AsyncWebServer;
+
+// ==========================================
+// WEB DASHBOARD (STATIC FILES)
+// ==========================================
+// The dashboard lives in web/ and is packed at build time by
+// tools/pack_web.py into include/web_bundle.h: minified, gzip-compressed,
+// const arrays in flash. Responses point straight at those arrays, nothing is
+// copied or built per request.
+//
+// "/" is revalidated on every visit (ETag, usually a 304). The files it
+// references have a content hash in their path and are cached for a year.
+// Texts and device data come from /api/ui (streamdeck.cpp).
+
+// Registers a GET handler for every bundled file
+void web_ui_begin(AsyncWebServer& server);
+
+#endif // WEB_UI_H
@@ -0,0 +1,255 @@
+#include "wifi_mgr.h"
+#include "boot.h"
+#include "crc32.h"
+#include "persist.h"
+#include <Arduino.h>
+#include <WiFi.h>
+#include <Preferences.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include <algorithm>
+
+struct WifiCache {
+    uint8_t version;
+    uint8_t channel;
+    uint8_t bssid[6];
+    uint32_t ssid_crc;
+};
+
+static WifiCache g_cache = {};       // what NVS holds; version 0: nothing cached
+static char g_ssid[33] = "";
+static char g_pass[65] = "";
+
+static volatile WifiState g_state = WIFI_MGR_IDLE;
+static volatile bool g_scanning = false;
+static QueueHandle_t g_events = nullptr;
+static SemaphoreHandle_t g_net_lock = nullptr;
+static WifiNetwork g_networks[WIFI_SCAN_MAX];
+static size_t g_network_count = 0;
+static volatile bool g_warm = false;      // current attempt uses the cache
+static volatile uint32_t g_retry_at = 0;  // millis() of the next attempt (backoff)
+static int64_t g_attempt_us = 0;
+static uint32_t g_attempt_ms = 0;
+static WifiStats g_stats = {0, 0, 0, 0, 0, 0, 0, 0, WIFI_BACKOFF_MIN_MS};
+
+static uint8_t s_connected_bssid[6];
+static uint8_t s_connected_channel = 0;
+
+static void post(uint8_t kind, uint32_t value = 0, uint8_t reason = 0) {
+    if (!g_events) return;
+    WifiEvent ev = {kind, reason, (uint8_t)g_warm, value};
+    xQueueSend(g_events, &ev, 0); // A full queue drops it; the UI drains it every loop
+}
+
+static bool cache_usable() {
+    return g_cache.version == WIFI_CACHE_VERSION && g_cache.channel != 0 &&
+           g_cache.ssid_crc == crc32_update(0, g_ssid, strlen(g_ssid));
+}
+
+static void drop_cache() {
+    if (g_cache.version == 0) return;
+    memset(&g_cache, 0, sizeof(g_cache));
+    persist_nvs_bytes(WIFI_CACHE_KEY, &g_cache, sizeof(g_cache));
+    persist_request();
+}
+
+static void start_attempt() {
+    g_warm = cache_usable();
+    WiFi.config(IPAddress((uint32_t)0), IPAddress((uint32_t)0), IPAddress((uint32_t)0)); // DHCP, also after older builds
+    if (g_warm) WiFi.begin(g_ssid, g_pass, g_cache.channel, g_cache.bssid);
+    else WiFi.begin(g_ssid, g_pass);
+    g_attempt_us = esp_timer_get_time();
+    g_attempt_ms = millis();
+    g_state = WIFI_MGR_CONNECTING;
+    g_stats.attempts++;
+    if (!boot_phase_time(BOOT_WIFI).start_us) boot_phase_start(BOOT_WIFI);
+    post(WIFI_EV_CONNECTING);
+}
+
+// Event handlers run in the WiFi event task
+static void on_connected(WiFiEvent_t, WiFiEventInfo_t info) {
+    memcpy(s_connected_bssid, info.wifi_sta_connected.bssid, 6);
+    s_connected_channel = info.wifi_sta_connected.channel;
+    post(WIFI_EV_ASSOCIATED, s_connected_channel);
+}
+
+static void on_got_ip(WiFiEvent_t, WiFiEventInfo_t) {
+    uint32_t us = (uint32_t)(esp_timer_get_time() - g_attempt_us);
+    g_stats.last_us = us;
+    g_stats.last_warm = g_warm;
+    if (g_warm) g_stats.warm_us = us; else g_stats.cold_us = us;
+    g_stats.connects++;
+    g_stats.backoff_ms = WIFI_BACKOFF_MIN_MS;
+    g_stats.channel = s_connected_channel;
+    if (!boot_phase_time(BOOT_WIFI).end_us) boot_phase_end(BOOT_WIFI);
+
+    WifiCache c = {};
+    c.version = WIFI_CACHE_VERSION;
+    c.channel = s_connected_channel;
+    memcpy(c.bssid, s_connected_bssid, 6);
+    c.ssid_crc = crc32_update(0, g_ssid, strlen(g_ssid));
+    if (memcmp(&c, &g_cache, sizeof(c)) != 0) {
+        g_cache = c;
+        persist_nvs_bytes(WIFI_CACHE_KEY, &g_cache, sizeof(g_cache));
+        persist_request();
+    }
+    g_stats.cached = 1;
+
+    Serial.printf("WIFI: IP in %u ms (%s, ch %u)\n", (unsigned)(us / 1000), g_warm ? "warm" : "cold", s_connected_channel);
+    g_state = WIFI_MGR_CONNECTED;
+    post(WIFI_EV_GOT_IP, us);
+}
+
+static void on_disconnected(WiFiEvent_t, WiFiEventInfo_t info) {
+    uint8_t reason = info.wifi_sta_disconnected.reason;
+    if (reason == WIFI_REASON_ASSOC_LEAVE) return; // Our own disconnect() before a new attempt
+    g_stats.last_reason = reason;
+
+    if (g_state == WIFI_MGR_CONNECTING && g_warm) {
+        // Cached AP gone, moved channel or rejected us: scan right away
+        Serial.printf("WIFI: warm connect failed (reason %u), scanning\n", reason);
+        g_stats.warm_fails++;
+        drop_cache();
+        g_stats.cached = 0;
+        g_retry_at = millis();
+        g_state = WIFI_MGR_BACKOFF;
+        post(WIFI_EV_DISCONNECTED, 0, reason);
+        return;
+    }
+    if (g_state == WIFI_MGR_CONNECTED) g_stats.drops++;
+    g_retry_at = millis() + g_stats.backoff_ms;
+    Serial.printf("WIFI: disconnected (reason %u), retry in %u ms\n", reason, g_stats.backoff_ms);
+    post(WIFI_EV_DISCONNECTED, g_stats.backoff_ms, reason);
+    g_stats.backoff_ms = min<uint32_t>(g_stats.backoff_ms * 2, WIFI_BACKOFF_MAX_MS);
+    g_state = WIFI_MGR_BACKOFF;
+}
+
+// Merges the finished scan into g_networks (one entry per SSID, strongest AP)
+static void on_scan_done(WiFiEvent_t, WiFiEventInfo_t) {
+    int16_t found = WiFi.scanComplete();
+    uint32_t now = millis();
+    xSemaphoreTake(g_net_lock, portMAX_DELAY);
+    for (int16_t i = 0; i < found; i++) {
+        String ssid = WiFi.SSID(i);
+        if (ssid.length() == 0) continue; // Hidden
+        int8_t rssi = (int8_t)WiFi.RSSI(i);
+        WifiNetwork* n = nullptr;
+        for (size_t k = 0; k < g_network_count && !n; k++) {
+            if (strcmp(g_networks[k].ssid, ssid.c_str()) == 0) n = &g_networks[k];
+        }
+        if (n && n->seen_ms == now && n->rssi >= rssi) continue; // Weaker AP of a network seen in this scan
+        if (!n) {
+            if (g_network_count < WIFI_SCAN_MAX) {
+                n = &g_networks[g_network_count++];
+            } else {
+                // Full: replace the weakest, if this one is stronger
+                n = std::min_element(g_networks, g_networks + g_network_count,
+                                     [](const WifiNetwork& a, const WifiNetwork& b) { return a.rssi < b.rssi; });
+                if (n->rssi >= rssi) continue;
+            }
+            memset(n, 0, sizeof(WifiNetwork));
+            strncpy(n->ssid, ssid.c_str(), sizeof(n->ssid) - 1);
+        }
+        n->rssi = rssi;
+        n->channel = (uint8_t)WiFi.channel(i);
+        n->secure = WiFi.encryptionType(i) != WIFI_AUTH_OPEN;
+        n->seen_ms = now;
+    }
+    // Drop what has not been seen for a while
+    size_t kept = 0;
+    for (size_t k = 0; k < g_network_count; k++) {
+        if (now - g_networks[k].seen_ms <= WIFI_SCAN_TTL_MS) g_networks[kept++] = g_networks[k];
+    }
+    g_network_count = kept;
+    xSemaphoreGive(g_net_lock);
+
+    WiFi.scanDelete();
+    g_stats.scans++;
+    g_scanning = false;
+    post(WIFI_EV_SCAN_DONE, kept);
+}
+
+void wifi_mgr_begin() {
+    g_events = xQueueCreate(WIFI_EVENT_QUEUE, sizeof(WifiEvent));
+    g_net_lock = xSemaphoreCreateMutex();
+    WiFi.mode(WIFI_STA);
+    WiFi.setAutoReconnect(false); // Retries follow our backoff
+    WiFi.onEvent(on_connected, ARDUINO_EVENT_WIFI_STA_CONNECTED);
+    WiFi.onEvent(on_got_ip, ARDUINO_EVENT_WIFI_STA_GOT_IP);
+    WiFi.onEvent(on_disconnected, ARDUINO_EVENT_WIFI_STA_DISCONNECTED);
+    WiFi.onEvent(on_scan_done, ARDUINO_EVENT_WIFI_SCAN_DONE);
+
+    Preferences prefs;
+    if (prefs.begin(PERSIST_NVS_NAMESPACE, true)) {
+        if (prefs.getBytesLength(WIFI_CACHE_KEY) == sizeof(WifiCache)) prefs.getBytes(WIFI_CACHE_KEY, &g_cache, sizeof(g_cache));
+        prefs.end();
+    }
+    if (g_cache.version != WIFI_CACHE_VERSION) memset(&g_cache, 0, sizeof(g_cache));
+    persist_nvs_bytes(WIFI_CACHE_KEY, &g_cache, sizeof(g_cache), true);
+}
+
+void wifi_mgr_connect(const char* ssid, const char* pass, bool force) {
+    if (!force && g_state != WIFI_MGR_IDLE && strcmp(ssid, g_ssid) == 0 && strcmp(pass, g_pass) == 0) return;
+    strncpy(g_ssid, ssid, sizeof(g_ssid) - 1);
+    strncpy(g_pass, pass, sizeof(g_pass) - 1);
+    if (g_state != WIFI_MGR_IDLE) WiFi.disconnect();
+    g_stats.backoff_ms = WIFI_BACKOFF_MIN_MS;
+    g_stats.cached = cache_usable();
+    if (strlen(g_ssid) == 0) {
+        g_state = WIFI_MGR_IDLE;
+        post(WIFI_EV_DISCONNECTED);
+    } else {
+        start_attempt();
+    }
+}
+
+void wifi_mgr_loop() {
+    if (g_state == WIFI_MGR_BACKOFF && (int32_t)(millis() - g_retry_at) >= 0) {
+        start_attempt();
+    } else if (g_state == WIFI_MGR_CONNECTING && g_warm && millis() - g_attempt_ms > WIFI_WARM_TIMEOUT_MS) {
+        Serial.println("WIFI: warm connect timed out, scanning");
+        g_stats.warm_fails++;
+        drop_cache();
+        g_stats.cached = 0;
+        WiFi.disconnect();
+        start_attempt();
+    }
+}
+
+bool wifi_mgr_poll_event(WifiEvent& ev) {
+    return g_events && xQueueReceive(g_events, &ev, 0) == pdTRUE;
+}
+
+bool wifi_mgr_scan() {
+    if (g_scanning || g_state == WIFI_MGR_CONNECTING) return false;
+    g_scanning = true;
+    if (WiFi.scanNetworks(true) == WIFI_SCAN_FAILED) {
+        g_scanning = false;
+        return false;
+    }
+    return true;
+}
+
+bool wifi_mgr_scanning() {
+    return g_scanning;
+}
+
+size_t wifi_mgr_networks(WifiNetwork* out, size_t max) {
+    if (!g_net_lock) return 0;
+    xSemaphoreTake(g_net_lock, portMAX_DELAY);
+    size_t n = min(g_network_count, max);
+    std::partial_sort_copy(g_networks, g_networks + g_network_count, out, out + n,
+                           [](const WifiNetwork& a, const WifiNetwork& b) { return a.rssi > b.rssi; });
+    xSemaphoreGive(g_net_lock);
+    return n;
+}
+
+WifiState wifi_mgr_state() {
+    return g_state;
+}
+
+WifiStats wifi_mgr_stats() {
+    return g_stats;
+}
@@ -0,0 +1,105 @@
+#ifndef WIFI_MGR_H
+#define WIFI_MGR_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ==========================================
+// WIFI CONNECTION MANAGER
+// ==========================================
+// Driven by WiFi events instead of polling WiFi.status(). After every
+// successful connection the AP's BSSID and channel are cached in NVS
+// (WIFI_CACHE_KEY); the next attempt for the same SSID joins that AP directly
+// (no channel scan). The address always comes from DHCP: a lease is never
+// reused as a static IP, which would outlive it and keep the router from
+// renewing it. If that "warm" attempt has no IP within WIFI_WARM_TIMEOUT_MS
+// or is rejected, the cache is dropped and a normal scan ("cold") follows.
+//
+// A lost connection is retried after WIFI_BACKOFF_MIN_MS, doubling up to
+// WIFI_BACKOFF_MAX_MS; the backoff resets once an IP is assigned.
+//
+// Progress (attempt started, associated, IP, disconnected, scan done) is
+// queued as WifiEvent records for the UI thread to drain. Scans run in the
+// background; results are merged into a list of networks stamped with when
+// each was last seen, and entries older than WIFI_SCAN_TTL_MS are dropped.
+
+#define WIFI_CACHE_KEY       "wcache"
+#define WIFI_CACHE_VERSION   2 // 1 also held the DHCP lease
+#define WIFI_WARM_TIMEOUT_MS 4000
+#define WIFI_BACKOFF_MIN_MS  1000
+#define WIFI_BACKOFF_MAX_MS  60000
+#define WIFI_SCAN_MAX        20
+#define WIFI_SCAN_TTL_MS     30000
+#define WIFI_EVENT_QUEUE     16
+
+enum WifiState : uint8_t {
+    WIFI_MGR_IDLE,       // no credentials
+    WIFI_MGR_CONNECTING,
+    WIFI_MGR_CONNECTED,  // has an IP
+    WIFI_MGR_BACKOFF     // waiting to retry
+};
+
+// Station mode, event handlers and the cached AP. Call once, early.
+void wifi_mgr_begin();
+
+// Connects with these credentials. Unless `force`, nothing happens when they
+// are the ones already in use.
+void wifi_mgr_connect(const char* ssid, const char* pass, bool force = false);
+
+// Retries and warm-attempt timeouts; call from loop()
+void wifi_mgr_loop();
+
+enum WifiEventKind : uint8_t {
+    WIFI_EV_CONNECTING,   // attempt started; warm: with the cached AP
+    WIFI_EV_ASSOCIATED,   // joined the AP, waiting for an IP; value: channel
+    WIFI_EV_GOT_IP,       // value: time to IP in us
+    WIFI_EV_DISCONNECTED, // reason set; value: ms until the retry
+    WIFI_EV_SCAN_DONE     // value: networks listed
+};
+
+struct WifiEvent {
+    uint8_t kind;
+    uint8_t reason; // wifi_err_reason_t
+    uint8_t warm;
+    uint32_t value;
+};
+
+// Next queued event, false when there is none. Single consumer (UI thread).
+bool wifi_mgr_poll_event(WifiEvent& ev);
+
+struct WifiNetwork {
+    char ssid[33];
+    int8_t rssi;     // dBm, strongest AP with this SSID
+    uint8_t channel;
+    uint8_t secure;  // needs a password
+    uint32_t seen_ms; // millis() of the last scan that saw it
+};
+
+// Starts a background scan. false while a scan or a connection attempt runs.
+bool wifi_mgr_scan();
+bool wifi_mgr_scanning();
+
+// Networks seen recently, strongest first; returns how many were copied
+size_t wifi_mgr_networks(WifiNetwork* out, size_t max);
+
+WifiState wifi_mgr_state();
+
+struct WifiStats {
+    uint32_t attempts;   // WiFi.begin() calls
+    uint32_t connects;   // IPs obtained
+    uint32_t drops;      // connections lost
+    uint32_t warm_fails; // warm attempts that fell back to a scan
+    uint32_t scans;      // scans completed
+    uint32_t last_us;    // last time to IP (attempt start to IP)
+    uint32_t cold_us;    // last time to IP of a cold / warm attempt, 0: none yet
+    uint32_t warm_us;
+    uint32_t backoff_ms; // next retry delay
+    uint8_t last_warm;   // last IP came from a warm attempt
+    uint8_t last_reason; // last disconnect reason (wifi_err_reason_t)
+    uint8_t channel;
+    uint8_t cached;      // an AP is cached for the current SSID
+};
+
+WifiStats wifi_mgr_stats();
+
+#endif // WIFI_MGR_H
@@ -0,0 +1,72 @@
+Import("env")
+
+# PlatformIO targets for the optional raw "assets" partition:
+#   pio run -e pandatouch-assets -t buildassets   -> .pio/build/<env>/assets.bin
+#   pio run -e pandatouch-assets -t uploadassets  -> flashes it at the partition offset
+# Icons are taken from the directory set by custom_assets_dir (default: assets/).
+
+import csv
+import os
+import sys
+
+sys.path.insert(0, os.path.join(env.subst("$PROJECT_DIR"), "tools"))
+import pack_assets  # noqa: E402
+
+
+def _parse_size(v):
+    v = v.strip()
+    if not v:
+        return None
+    mul = 1
+    if v[-1] in "kK":
+        mul, v = 1024, v[:-1]
+    elif v[-1] in "mM":
+        mul, v = 1024 * 1024, v[:-1]
+    return int(v, 0) * mul
+
+
+def _find_partition(csv_path, label):
+    # Same offset rules as gen_esp32part.py: rows without an offset follow the
+    # previous one, app partitions are 64 KB aligned, data ones 4 KB aligned.
+    offset = 0x9000
+    with open(csv_path) as f:
+        for row in csv.reader(line for line in f if line.strip() and not line.lstrip().startswith("#")):
+            row = [c.strip() for c in row]
+            name, ptype, off, size = row[0], row[1], row[3], _parse_size(row[4])
+            align = 0x10000 if ptype == "app" else 0x1000
+            start = _parse_size(off) if off else (offset + align - 1) // align * align
+            if name == label:
+                return start, size
+            offset = start + size
+    return None, None
+
+
+def _pack_path():
+    return os.path.join(env.subst("$BUILD_DIR"), "assets.bin")
+
+
+def build_assets(*args, **kwargs):
+    src = os.path.join(env.subst("$PROJECT_DIR"), env.GetProjectOption("custom_assets_dir", "assets"))
+    part_csv = os.path.join(env.subst("$PROJECT_DIR"), env.GetProjectOption("board_build.partitions"))
+    _, size = _find_partition(part_csv, "assets")
+    if size is None:
+        sys.exit("assets: no 'assets' partition in %s" % part_csv)
+    os.makedirs(env.subst("$BUILD_DIR"), exist_ok=True)
+    icon_size = int(env.GetProjectOption("custom_assets_icon_size", "64"))
+    pack_assets.pack_dir(src, _pack_path(), size, icon_size)
+
+
+def upload_assets(*args, **kwargs):
+    build_assets()
+    part_csv = os.path.join(env.subst("$PROJECT_DIR"), env.GetProjectOption("board_build.partitions"))
+    offset, _ = _find_partition(part_csv, "assets")
+    env.AutodetectUploadPort()
+    cmd = " ".join([
+        "$PYTHONEXE", '"$UPLOADER"', "--chip", "esp32s3", "--port", '"$UPLOAD_PORT"',
+        "--baud", "$UPLOAD_SPEED", "write_flash", hex(offset), '"%s"' % _pack_path(),
+    ])
+    env.Execute(env.VerboseAction(cmd, "Flashing asset partition at %s" % hex(offset)))
+
+
+env.AddCustomTarget("buildassets", None, build_assets, title="Build Assets", description="Pack icons into assets.bin")
+env.AddCustomTarget("uploadassets", None, upload_assets, title="Upload Assets", description="Flash the raw assets partition")
@@ -0,0 +1,204 @@
+#!/usr/bin/env python3
+"""
+Packs icons into the raw "assets" partition image read by src/asset_store.cpp.
+
+Layout (little endian):
+  header  : magic "PDA1", u16 version, u16 count, u32 table_crc, u32 total_size
+  entries : count x { char name[32], u32 offset, u32 size,
+                      u16 w, u16 h, u16 stride, u8 cf, u8 reserved }
+            sorted by name so the device can binary-search it
+  data    : pixel blocks in LVGL color formats, each 64-byte aligned
+
+Inputs can be PNG/JPG/BMP (needs Pillow) or LVGL v9 ".bin" images, which are
+copied as-is. Names are stored as "/<file name>", the same form the firmware
+keeps in ButtonConfig::imgPath, so a button pointing at "/play.png" picks up
+the packed version automatically.
+
+Usage:
+  pack_assets.py pack <src_dir> <out.bin> [--max-size BYTES] [--icon-size N]
+  pack_assets.py list <pack.bin>
+  pack_assets.py lookup <pack.bin> <name>
+"""
+
+import argparse
+import os
+import struct
+import sys
+import zlib
+
+MAGIC = 0x31414450  # "PDA1"
+VERSION = 1
+ALIGN = 64
+NAME_LEN = 32
+
+HEADER_FMT = "<IHHII"
+ENTRY_FMT = "<32sIIHHHBB"
+HEADER_SIZE = struct.calcsize(HEADER_FMT)
+ENTRY_SIZE = struct.calcsize(ENTRY_FMT)
+
+# lv_color_format_t values (LVGL 9)
+CF_RGB565 = 0x12
+CF_RGB565A8 = 0x14
+CF_ARGB8888 = 0x10
+LV_IMAGE_HEADER_MAGIC = 0x19
+
+IMAGE_EXTS = (".png", ".jpg", ".jpeg", ".bmp")
+
+
+def _align(n):
+    return (n + ALIGN - 1) // ALIGN * ALIGN
+
+
+def _convert_pillow(path, icon_size):
+    try:
+        from PIL import Image
+    except ImportError:
+        sys.exit("pack_assets: Pillow is required to convert %s (pip install pillow)" % path)
+
+    img = Image.open(path).convert("RGBA")
+    if icon_size:
+        img.thumbnail((icon_size, icon_size))
+    w, h = img.size
+    px = img.load()
+
+    color = bytearray()
+    alpha = bytearray()
+    opaque = True
+    for y in range(h):
+        for x in range(w):
+            r, g, b, a = px[x, y]
+            v = ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3)
+            color += struct.pack("<H", v)
+            alpha.append(a)
+            if a != 0xFF:
+                opaque = False
+
+    if opaque:
+        return CF_RGB565, w, h, w * 2, bytes(color)
+    return CF_RGB565A8, w, h, w * 2, bytes(color + alpha)
+
+
+def _load_lvgl_bin(path):
+    with open(path, "rb") as f:
+        raw = f.read()
+    if len(raw) < 12 or raw[0] != LV_IMAGE_HEADER_MAGIC:
+        sys.exit("pack_assets: %s is not an LVGL v9 image" % path)
+    cf = raw[1]
+    w, h, stride = struct.unpack_from("<HHH", raw, 4)
+    return cf, w, h, stride, raw[12:]
+
+
+def load_image(path, icon_size=0):
+    if path.lower().endswith(".bin"):
+        return _load_lvgl_bin(path)
+    return _convert_pillow(path, icon_size)
+
+
+def build_pack(images):
+    """images: list of (name, cf, w, h, stride, data). Returns pack bytes."""
+    images = sorted(images, key=lambda i: i[0].encode())
+    offset = _align(HEADER_SIZE + ENTRY_SIZE * len(images))
+
+    table = bytearray()
+    blobs = bytearray()
+    for name, cf, w, h, stride, data in images:
+        encoded = name.encode()
+        if len(encoded) >= NAME_LEN:
+            sys.exit("pack_assets: name too long (max %d): %s" % (NAME_LEN - 1, name))
+        table += struct.pack(ENTRY_FMT, encoded, offset, len(data), w, h, stride, cf, 0)
+        pad = _align(len(data)) - len(data)
+        blobs += data + b"\0" * pad
+        offset += len(data) + pad
+
+    head_pad = _align(HEADER_SIZE + len(table)) - (HEADER_SIZE + len(table))
+    total = HEADER_SIZE + len(table) + head_pad + len(blobs)
+    header = struct.pack(HEADER_FMT, MAGIC, VERSION, len(images), zlib.crc32(bytes(table)), total)
+    return header + bytes(table) + b"\0" * head_pad + bytes(blobs)
+
+
+def pack_dir(src_dir, out_path, max_size=0, icon_size=0):
+    images = []
+    for fname in sorted(os.listdir(src_dir)):
+        path = os.path.join(src_dir, fname)
+        if not os.path.isfile(path) or fname.startswith("."):
+            continue
+        if not fname.lower().endswith(IMAGE_EXTS + (".bin",)):
+            continue
+        cf, w, h, stride, data = load_image(path, icon_size)
+        images.append(("/" + fname, cf, w, h, stride, data))
+
+    pack = build_pack(images)
+    if max_size and len(pack) > max_size:
+        sys.exit("pack_assets: pack is %d bytes, partition holds %d" % (len(pack), max_size))
+    with open(out_path, "wb") as f:
+        f.write(pack)
+    print("pack_assets: %d images, %d bytes -> %s" % (len(images), len(pack), out_path))
+    return out_path
+
+
+def read_pack(path):
+    with open(path, "rb") as f:
+        raw = f.read()
+    magic, version, count, table_crc, total = struct.unpack_from(HEADER_FMT, raw, 0)
+    if magic != MAGIC or version != VERSION:
+        sys.exit("pack_assets: %s is not an asset pack" % path)
+    table = raw[HEADER_SIZE:HEADER_SIZE + ENTRY_SIZE * count]
+    if zlib.crc32(table) != table_crc:
+        sys.exit("pack_assets: table CRC mismatch in %s" % path)
+    entries = []
+    for i in range(count):
+        name, off, size, w, h, stride, cf, _ = struct.unpack_from(ENTRY_FMT, table, i * ENTRY_SIZE)
+        entries.append((name.rstrip(b"\0").decode(), off, size, w, h, stride, cf))
+    return raw, entries
+
+
+def lookup(entries, name):
+    # Same binary search as asset_store_find() on the device
+    lo, hi = 0, len(entries) - 1
+    key = name.encode()
+    while lo <= hi:
+        mid = (lo + hi) // 2
+        cur = entries[mid][0].encode()
+        if cur == key:
+            return entries[mid]
+        if key < cur:
+            hi = mid - 1
+        else:
+            lo = mid + 1
+    return None
+
+
+def main():
+    ap = argparse.ArgumentParser(description="PandaTouch asset partition packer")
+    sub = ap.add_subparsers(dest="cmd", required=True)
+
+    p = sub.add_parser("pack")
+    p.add_argument("src_dir")
+    p.add_argument("out")
+    p.add_argument("--max-size", type=lambda v: int(v, 0), default=0)
+    p.add_argument("--icon-size", type=int, default=0, help="shrink images to fit NxN")
+
+    p = sub.add_parser("list")
+    p.add_argument("pack")
+
+    p = sub.add_parser("lookup")
+    p.add_argument("pack")
+    p.add_argument("name")
+
+    args = ap.parse_args()
+    if args.cmd == "pack":
+        pack_dir(args.src_dir, args.out, args.max_size, args.icon_size)
+    elif args.cmd == "list":
+        _, entries = read_pack(args.pack)
+        for name, off, size, w, h, stride, cf in entries:
+            print("%-32s %4dx%-4d cf=0x%02X off=0x%06X size=%d" % (name, w, h, cf, off, size))
+    elif args.cmd == "lookup":
+        _, entries = read_pack(args.pack)
+        e = lookup(entries, args.name)
+        if not e:
+            sys.exit(1)
+        print("%s %dx%d cf=0x%02X off=0x%06X size=%d" % (e[0], e[3], e[4], e[6], e[1], e[2]))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,183 @@
+#!/usr/bin/env python3
+"""
+Packs the web dashboard (web/) into a C header served from flash by
+src/web_ui.cpp.
+
+Every file is minified (conservatively: comments and layout whitespace only),
+gzip-compressed at level 9 with a fixed mtime so the output is reproducible,
+and emitted as a const byte array that lands in flash rodata. The ETag of a
+file is a hash of its compressed bytes.
+
+index.html is the only entry point. Files reference each other by plain
+name ("app.css", url(icons.ttf)); those references are rewritten to "<name>.<hash>.<ext>" so the
+browser may cache them forever (a new build gets new URLs), while index.html
+itself is revalidated on every visit and normally answered with a 304.
+
+Everything the page needs is in the bundle (no CDN), and the build fails if
+the gzipped total exceeds FIRST_LOAD_BUDGET.
+
+Usage:
+  pack_web.py <web_dir> <out.h>
+"""
+
+import gzip
+import hashlib
+import os
+import re
+import sys
+
+TYPES = {
+    ".html": "text/html; charset=utf-8",
+    ".js": "application/javascript",
+    ".css": "text/css",
+    ".ttf": "font/ttf",
+}
+
+# Referenced files are hashed before the files referencing them
+ORDER = [".ttf", ".css", ".js", ".html"]
+
+# Everything a first visit downloads from the device, gzipped
+FIRST_LOAD_BUDGET = 16 * 1024
+
+
+def minify_css(s):
+    s = re.sub(r"/\*.*?\*/", "", s, flags=re.S)
+    parts = re.split(r"(\"[^\"]*\"|'[^']*')", s)
+    for i in range(0, len(parts), 2):  # outside quoted strings only
+        p = re.sub(r"\s+", " ", parts[i])
+        parts[i] = re.sub(r"\s*([{}:;,>])\s*", r"\1", p)
+    return "".join(parts).replace(";}", "}").strip()
+
+
+def minify_js(s):
+    out = []
+    for line in s.splitlines():
+        line = line.strip()
+        if not line or line.startswith("//"):
+            continue
+        # Trailing comments after a statement; never inside the code itself
+        line = re.sub(r"(?<=[;{}),])\s*//\s.*$", "", line)
+        out.append(line)
+    return "\n".join(out) + "\n"
+
+
+def minify_html(s):
+    s = re.sub(r"<!--.*?-->", "", s, flags=re.S)
+    s = re.sub(r">\s*\n\s*<", "><", s)
+    return s.strip()
+
+
+MINIFY = {".html": minify_html, ".js": minify_js, ".css": minify_css}
+
+
+def _link(text, name, hashed):
+    # "name", 'name' or url(name)
+    return re.sub(r"([\"'(])%s([\"')])" % re.escape(name), r"\g<1>%s\g<2>" % hashed, text)
+
+
+def _digest(data):
+    return hashlib.sha256(data).hexdigest()[:8]
+
+
+def _gzip(data):
+    return gzip.compress(data, compresslevel=9, mtime=0)
+
+
+def pack_dir(src, out):
+    """Returns True if `out` was (re)written."""
+    names = [n for n in os.listdir(src) if os.path.splitext(n)[1] in TYPES]
+    names.sort(key=lambda n: (ORDER.index(os.path.splitext(n)[1]), n))
+    if "index.html" not in names:
+        sys.exit("pack_web: no index.html in %s" % src)
+
+    # path, type, raw, immutable
+    entries = []
+    renamed = {}
+    for name in names:
+        stem, ext = os.path.splitext(name)
+        if ext in MINIFY:
+            with open(os.path.join(src, name), encoding="utf-8") as f:
+                text = MINIFY[ext](f.read())
+            for old, new in renamed.items():
+                text = _link(text, old, new)
+            raw = text.encode("utf-8")
+        else:
+            with open(os.path.join(src, name), "rb") as f:
+                raw = f.read()
+        if name == "index.html":
+            entries.insert(0, ("/", TYPES[ext], raw, False))
+            continue
+        renamed[name] = "%s.%s%s" % (stem, _digest(raw), ext)
+        entries.append(("/" + renamed[name], TYPES[ext], raw, True))
+
+    bundle = hashlib.sha256()
+    lines = [
+        "// Generated by tools/pack_web.py from %s/ - do not edit" % os.path.basename(os.path.normpath(src)),
+        "#ifndef WEB_BUNDLE_H",
+        "#define WEB_BUNDLE_H",
+        "",
+        "#include <stddef.h>",
+        "#include <stdint.h>",
+        "",
+        "struct WebBundleFile {",
+        "    const char* path;",
+        "    const char* type;",
+        "    const uint8_t* gz; // gzip body, in flash",
+        "    uint32_t len;",
+        "    uint32_t raw_len;",
+        "    const char* etag;",
+        "    bool immutable;    // content-hashed path",
+        "};",
+        "",
+    ]
+    table = []
+    total_raw = total_gz = 0
+    for i, (path, ctype, raw, immutable) in enumerate(entries):
+        gz = _gzip(raw)
+        bundle.update(gz)
+        total_raw += len(raw)
+        total_gz += len(gz)
+        lines.append("// %s: %d -> %d bytes" % (path, len(raw), len(gz)))
+        lines.append("static const uint8_t web_file_%d[] = {" % i)
+        for off in range(0, len(gz), 20):
+            lines.append("    " + ",".join("0x%02x" % b for b in gz[off:off + 20]) + ",")
+        lines.append("};")
+        lines.append("")
+        table.append('    { "%s", "%s", web_file_%d, %d, %d, "\\"%s\\"", %s },'
+                     % (path, ctype, i, len(gz), len(raw), _digest(gz), "true" if immutable else "false"))
+    lines.append("static const WebBundleFile WEB_BUNDLE[] = {")
+    lines.extend(table)
+    lines.append("};")
+    lines.append("")
+    lines.append("#define WEB_BUNDLE_COUNT %d" % len(entries))
+    lines.append('#define WEB_BUNDLE_HASH "%s"' % bundle.hexdigest()[:8])
+    lines.append("#define WEB_BUNDLE_BYTES %d // gzipped, all files" % total_gz)
+    lines.append("")
+    lines.append("#endif // WEB_BUNDLE_H")
+    text = "\n".join(lines) + "\n"
+
+    if total_gz > FIRST_LOAD_BUDGET:
+        sys.exit("pack_web: first load is %d bytes gzipped, over the %d byte budget" % (total_gz, FIRST_LOAD_BUDGET))
+
+    # Leave the file alone when nothing changed: it would rebuild web_ui.cpp
+    if os.path.exists(out):
+        with open(out) as f:
+            if f.read() == text:
+                return False
+    os.makedirs(os.path.dirname(out) or ".", exist_ok=True)
+    with open(out, "w") as f:
+        f.write(text)
+    for path, _, raw, _ in entries:
+        print("web: %-22s %6d bytes" % (path, len(raw)))
+    print("web: first load %d bytes, %d gzipped (budget %d)" % (total_raw, total_gz, FIRST_LOAD_BUDGET))
+    return True
+
+
+def main():
+    if len(sys.argv) != 3:
+        sys.exit(__doc__)
+    pack_dir(sys.argv[1], sys.argv[2])
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,297 @@
+#!/usr/bin/env python3
+"""
+Packs and unpacks the binary backups of /api/backup.bin (layout in
+src/backup.h) so they can be inspected, edited or generated off the device:
+
+  pdbackup.py list     <backup.pdbak>
+  pdbackup.py unpack   <backup.pdbak> <dir>
+  pdbackup.py pack     <dir> <backup.pdbak> [--store]
+  pdbackup.py manifest <full.pdbak> [<diff.pdbak> ...]
+  pdbackup.py apply    <full.pdbak> <diff.pdbak> [...] -o <full.pdbak>
+
+unpack writes <dir>/manifest.json (settings inline, every entry in archive
+order) plus one file per deck and asset; pack reads the same layout back.
+Deck files are the device's own deck logs and are copied as they are.
+Entries of a kind this script does not know survive an unpack/pack round
+trip. Every CRC is checked while reading; a damaged archive is an error.
+
+Differential backups: POST the output of `manifest` (what the device had at
+the last backup, the same JSON as GET /api/manifest) to /api/backup.bin and
+the device answers with only what changed since. `apply` folds such
+archives into the full one they were made against:
+
+  pdbackup.py manifest deck1.pdbak > deck1.json
+  curl -H "Content-Type: application/json" --data-binary @deck1.json \
+       http://<ip>/api/backup.bin -o diff.pdbak
+  pdbackup.py apply deck1.pdbak diff.pdbak -o deck1.pdbak
+"""
+
+import argparse
+import gzip
+import json
+import os
+import struct
+import sys
+import zlib
+
+MAGIC = 0x31424450  # "PDB1"
+VERSION = 1
+F_DEFLATE = 0x01  # entry flags
+H_DIFF = 0x01     # header flags
+
+CONFIG, DECK, PROFILE, FILE, DELETE, END = 1, 2, 3, 4, 5, 0xFF
+KINDS = {CONFIG: "config", DECK: "deck", PROFILE: "profile", FILE: "file", DELETE: "delete"}
+
+HEADER = struct.Struct("<IHH")
+ENTRY = struct.Struct("<BBBBI")
+CONFIG_REC = struct.Struct("<I5B3x32s")
+BLOCK = 4096
+STORED = (".png", ".jpg", ".jpeg", ".gif", ".webp", ".gz")
+BUILTIN = {0: "win", 1: "mac"}
+
+
+class Reader:
+    def __init__(self, data):
+        self.data = data
+        self.pos = 0
+
+    def take(self, n):
+        if self.pos + n > len(self.data):
+            sys.exit("pdbackup: truncated archive at byte %d" % self.pos)
+        b = self.data[self.pos:self.pos + n]
+        self.pos += n
+        return b
+
+
+def read_archive(path):
+    """(header flags, [(kind, flags, arg, name, raw bytes)]) of a verified archive"""
+    with open(path, "rb") as f:
+        r = Reader(f.read())
+    magic, version, hflags = HEADER.unpack(r.take(HEADER.size))
+    if magic != MAGIC:
+        sys.exit("pdbackup: %s is not a backup archive" % path)
+    if version > VERSION:
+        sys.exit("pdbackup: archive version %d is newer than this script" % version)
+    entries = []
+    while True:
+        start = r.pos
+        kind, flags, name_len, arg, raw_size = ENTRY.unpack(r.take(ENTRY.size))
+        if kind == END:
+            (crc,) = struct.unpack("<I", r.take(4))
+            if crc != zlib.crc32(r.data[:start]):
+                sys.exit("pdbackup: archive checksum mismatch")
+            if raw_size != len(entries):
+                sys.exit("pdbackup: %d entries expected, %d found" % (raw_size, len(entries)))
+            if r.pos != len(r.data):
+                sys.exit("pdbackup: data after the end")
+            return hflags, entries
+        name = r.take(name_len).decode("utf-8", "replace")
+        blocks = []
+        while True:
+            (n,) = struct.unpack("<H", r.take(2))
+            if not n:
+                break
+            blocks.append(r.take(n))
+        data = b"".join(blocks)
+        if flags & F_DEFLATE:
+            data = gzip.decompress(data)
+        (crc,) = struct.unpack("<I", r.take(4))
+        if len(data) != raw_size or zlib.crc32(data) != crc:
+            sys.exit("pdbackup: entry %r: checksum mismatch" % name)
+        entries.append((kind, flags, arg, name, data))
+
+
+def config_dict(data):
+    bg, rows, cols, os_, profile, lang, ssid = CONFIG_REC.unpack(data[:CONFIG_REC.size])
+    return {"bg": "#%06X" % bg, "rows": rows, "cols": cols, "os": os_, "profile": profile,
+            "lang": lang, "wifi_ssid": ssid.split(b"\0")[0].decode("utf-8", "replace")}
+
+
+def config_bytes(c):
+    ssid = c.get("wifi_ssid", "").encode("utf-8")[:31]
+    return CONFIG_REC.pack(int(str(c.get("bg", "#000000")).lstrip("#"), 16), c.get("rows", 0),
+                           c.get("cols", 0), c.get("os", 0), c.get("profile", 0), c.get("lang", 0), ssid)
+
+
+def describe(kind, arg, name):
+    if kind == DECK:
+        return "deck %s" % BUILTIN.get(arg, arg)
+    if kind == PROFILE:
+        return "profile %s (os %d)" % (name, arg)
+    if kind == FILE:
+        return "file %s" % name
+    if kind == DELETE:
+        return "delete %s %s" % (KINDS.get(arg, arg), name)
+    return KINDS.get(kind, "kind %d" % kind) + (" " + name if name else "")
+
+
+def cmd_list(args):
+    hflags, entries = read_archive(args.archive)
+    if hflags & H_DIFF:
+        print("(differential)")
+    for kind, flags, arg, name, data in entries:
+        extra = " deflate" if flags & F_DEFLATE else ""
+        print("%-32s %8d B%s" % (describe(kind, arg, name), len(data), extra))
+        if kind == CONFIG:
+            print("  " + json.dumps(config_dict(data)))
+
+
+def cmd_unpack(args):
+    hflags, archive = read_archive(args.archive)
+    entries = []
+    for i, (kind, flags, arg, name, data) in enumerate(archive):
+        if kind == CONFIG:
+            entries.append(dict(kind="config", **config_dict(data)))
+            continue
+        if kind == DELETE:
+            entries.append({"kind": "delete", "what": KINDS.get(arg, arg), "name": name})
+            continue
+        if kind == DECK:
+            rel, e = "decks/%s.pdl" % BUILTIN.get(arg, arg), {"kind": "deck", "builtin": arg}
+        elif kind == PROFILE:
+            rel, e = "decks/p%d.pdl" % i, {"kind": "profile", "name": name, "os": arg}
+        elif kind == FILE:
+            if not name or "/" in name or name.startswith("."):
+                sys.exit("pdbackup: bad file name %r" % name)
+            rel, e = "files/" + name, {"kind": "file", "name": name}
+        else:
+            rel, e = "other/%d.bin" % i, {"kind": kind, "name": name, "arg": arg,
+                                          "deflate": bool(flags & F_DEFLATE)}
+        e["file"] = rel
+        path = os.path.join(args.dir, rel)
+        os.makedirs(os.path.dirname(path), exist_ok=True)
+        with open(path, "wb") as f:
+            f.write(data)
+        entries.append(e)
+    with open(os.path.join(args.dir, "manifest.json"), "w", encoding="utf-8") as f:
+        json.dump({"version": VERSION, "diff": bool(hflags & H_DIFF), "entries": entries}, f, indent=2,
+                  ensure_ascii=False)
+        f.write("\n")
+    print("pdbackup: %d entries -> %s" % (len(entries), args.dir))
+
+
+def entry_bytes(kind, arg, name, data, deflate):
+    name_b = name.encode("utf-8")
+    if len(name_b) > 255:
+        sys.exit("pdbackup: name too long: %r" % name)
+    payload = gzip.compress(data, mtime=0) if deflate else data
+    out = [ENTRY.pack(kind, F_DEFLATE if deflate else 0, len(name_b), arg, len(data)), name_b]
+    for i in range(0, len(payload), BLOCK):
+        block = payload[i:i + BLOCK]
+        out += [struct.pack("<H", len(block)), block]
+    out += [struct.pack("<H", 0), struct.pack("<I", zlib.crc32(data))]
+    return b"".join(out)
+
+
+def write_archive(path, hflags, parts, count):
+    body = HEADER.pack(MAGIC, VERSION, hflags) + b"".join(parts)
+    body += ENTRY.pack(END, 0, 0, 0, count) + struct.pack("<I", zlib.crc32(body))
+    with open(path, "wb") as f:
+        f.write(body)
+    return len(body)
+
+
+def cmd_pack(args):
+    with open(os.path.join(args.dir, "manifest.json"), encoding="utf-8") as f:
+        manifest = json.load(f)
+    parts = []
+    entries = manifest["entries"]
+    for e in entries:
+        kind = e["kind"]
+        if kind == "config":
+            parts.append(entry_bytes(CONFIG, 0, "", config_bytes(e), False))
+            continue
+        if kind == "delete":
+            what = {"profile": PROFILE, "file": FILE}[e["what"]]
+            parts.append(entry_bytes(DELETE, what, e["name"], b"", False))
+            continue
+        with open(os.path.join(args.dir, e["file"]), "rb") as f:
+            data = f.read()
+        if kind == "deck":
+            parts.append(entry_bytes(DECK, e["builtin"], "", data, not args.store))
+        elif kind == "profile":
+            parts.append(entry_bytes(PROFILE, e.get("os", 0), e["name"], data, not args.store))
+        elif kind == "file":
+            deflate = not args.store and not e["name"].lower().endswith(STORED)
+            parts.append(entry_bytes(FILE, 0, e["name"], data, deflate))
+        else:
+            parts.append(entry_bytes(int(kind), e.get("arg", 0), e.get("name", ""), data, e.get("deflate", False)))
+    size = write_archive(args.archive, H_DIFF if manifest.get("diff") else 0, parts, len(entries))
+    print("pdbackup: %d entries, %d bytes -> %s" % (len(entries), size, args.archive))
+
+
+def entry_id(kind, arg, name):
+    """Manifest key of an entry, as the device writes it"""
+    if kind == DECK:
+        return "deck:%d" % arg
+    return "%s:%s" % (KINDS[kind], name)
+
+
+def merged(paths):
+    """Entries of a full archive with the differential ones after it applied, by manifest key"""
+    hflags, entries = read_archive(paths[0])
+    if hflags & H_DIFF:
+        sys.exit("pdbackup: %s is differential, the first archive must be a full one" % paths[0])
+    state = {}
+    for path in [None] + paths[1:]:
+        if path:
+            hflags, entries = read_archive(path)
+            if not hflags & H_DIFF:
+                sys.exit("pdbackup: %s is not differential" % path)
+        for e in entries:
+            kind, flags, arg, name, data = e
+            if kind == DELETE:
+                state.pop(entry_id(arg, 0, name), None)
+            elif kind == CONFIG:
+                state["config"] = e
+            elif kind in (DECK, PROFILE, FILE):
+                state[entry_id(kind, arg, name)] = e
+    return state
+
+
+def cmd_manifest(args):
+    state = merged(args.archives)
+    out = {}
+    for key, (kind, flags, arg, name, data) in state.items():
+        if kind != CONFIG:
+            out[key] = "%08x:%d" % (zlib.crc32(data), len(data))
+    print(json.dumps(out, ensure_ascii=False))
+
+
+def cmd_apply(args):
+    state = merged(args.archives)
+    parts = []
+    for kind, flags, arg, name, data in state.values():
+        parts.append(entry_bytes(kind, arg, name, data, bool(flags & F_DEFLATE)))
+    size = write_archive(args.out, 0, parts, len(parts))
+    print("pdbackup: %d entries, %d bytes -> %s" % (len(parts), size, args.out))
+
+
+def main():
+    ap = argparse.ArgumentParser()
+    sub = ap.add_subparsers(dest="cmd", required=True)
+    p = sub.add_parser("list")
+    p.add_argument("archive")
+    p.set_defaults(func=cmd_list)
+    p = sub.add_parser("unpack")
+    p.add_argument("archive")
+    p.add_argument("dir")
+    p.set_defaults(func=cmd_unpack)
+    p = sub.add_parser("pack")
+    p.add_argument("dir")
+    p.add_argument("archive")
+    p.add_argument("--store", action="store_true", help="no compression")
+    p.set_defaults(func=cmd_pack)
+    p = sub.add_parser("manifest")
+    p.add_argument("archives", nargs="+")
+    p.set_defaults(func=cmd_manifest)
+    p = sub.add_parser("apply")
+    p.add_argument("archives", nargs="+")
+    p.add_argument("-o", "--out", required=True)
+    p.set_defaults(func=cmd_apply)
+    args = ap.parse_args()
+    args.func(args)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,87 @@
+#!/usr/bin/env python3
+"""
+Builds web/icons.ttf, the icon font of the web dashboard: only the glyphs of
+the button symbols the deck offers (g_sym_codes in src/streamdeck.cpp, LVGL
+symbol code points, which are Font Awesome's).
+
+The result is committed, so builds need neither this script nor fontTools.
+Re-run it after changing g_sym_codes:
+
+  subset_icons.py <fontawesome.ttf> [--out web/icons.ttf]
+                  [--source src/streamdeck.cpp] [--alias F304=F040 ...]
+
+Any Font Awesome TTF with the code points works. --alias maps a code point
+the source font lacks to the glyph of another one (the default covers
+LVGL's "edit", U+F304, which Font Awesome 4 has as U+F040).
+"""
+
+import argparse
+import re
+import sys
+
+from fontTools import subset
+from fontTools.ttLib import TTFont
+
+FAMILY = "DeckIcons"
+
+
+def symbol_codepoints(source):
+    with open(source, encoding="utf-8") as f:
+        text = f.read()
+    m = re.search(r"g_sym_codes\[\]\s*=\s*\{(.*?)\};", text, re.S)
+    if not m:
+        sys.exit("icons: no g_sym_codes in %s" % source)
+    cps = set()
+    for lit in re.findall(r'"((?:\\x[0-9A-Fa-f]{2})*)"', m.group(1)):
+        raw = bytes(int(h, 16) for h in re.findall(r"\\x([0-9A-Fa-f]{2})", lit))
+        cps.update(ord(c) for c in raw.decode("utf-8"))
+    return sorted(cps)
+
+
+def build(font_path, out, cps, aliases):
+    font = TTFont(font_path)
+    for table in font["cmap"].tables:
+        if not table.isUnicode():
+            continue
+        for cp, src in aliases.items():
+            if cp not in table.cmap and src in table.cmap:
+                table.cmap[cp] = table.cmap[src]
+    best = font.getBestCmap()
+    missing = [cp for cp in cps if cp not in best]
+    if missing:
+        sys.exit("icons: %s lacks %s" % (font_path, ", ".join("U+%04X" % cp for cp in missing)))
+
+    opts = subset.Options()
+    opts.layout_features = []
+    opts.name_IDs = [1, 2]
+    opts.notdef_outline = True
+    opts.hinting = False
+    opts.desubroutinize = True
+    sub = subset.Subsetter(opts)
+    sub.populate(unicodes=cps)
+    sub.subset(font)
+    for rec in font["name"].names:
+        if rec.nameID == 1:
+            rec.string = FAMILY
+    font.save(out)
+
+
+def main():
+    ap = argparse.ArgumentParser()
+    ap.add_argument("font")
+    ap.add_argument("--out", default="web/icons.ttf")
+    ap.add_argument("--source", default="src/streamdeck.cpp")
+    ap.add_argument("--alias", action="append", default=["F304=F040"])
+    args = ap.parse_args()
+
+    aliases = {}
+    for a in args.alias:
+        cp, src = a.split("=")
+        aliases[int(cp, 16)] = int(src, 16)
+    cps = symbol_codepoints(args.source)
+    build(args.font, args.out, cps, aliases)
+    print("icons: %d glyphs -> %s" % (len(cps), args.out))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,13 @@
+Import("env")
+
+# Pre-build step: packs web/ into include/web_bundle.h (see tools/pack_web.py).
+# Runs on every build; the header is only rewritten when the dashboard changed.
+
+import os
+import sys
+
+sys.path.insert(0, os.path.join(env.subst("$PROJECT_DIR"), "tools"))
+import pack_web  # noqa: E402
+
+_project = env.subst("$PROJECT_DIR")
+pack_web.pack_dir(os.path.join(_project, "web"), os.path.join(_project, "include", "web_bundle.h"))
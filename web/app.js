@@ -0,0 +1,285 @@
+// PandaDeck dashboard. Served precompressed from flash; everything that
+// depends on the device (texts in the UI language, version, grid sizes,
+// symbols) comes from /api/ui, the deck itself from /api/config.
+let T = {}, UI = {};
+let PAGE = -1, PAGES = 1;
+
+const KEYS = ['', 'A', 'B', 'C', 'D', 'E', 'F', 'G', 'H', 'I', 'J', 'K', 'L', 'M', 'N', 'O', 'P', 'Q', 'R', 'S', 'T', 'U', 'V', 'W', 'X', 'Y', 'Z', '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'F1', 'F2', 'F3', 'F4', 'F5', 'F6', 'F7', 'F8', 'F9', 'F10', 'F11', 'F12', 'ENTER', 'SPACE', 'TAB', 'ESC', 'UP', 'DOWN', 'LEFT', 'RIGHT', 'HOME', 'END', 'PAGE_UP', 'PAGE_DOWN', 'BACKSPACE', 'DELETE', 'PRINT_SCREEN', 'PAUSE'];
+
+const $ = (id) => document.getElementById(id);
+const esc = (s) => String(s).replace(/&/g, '&amp;').replace(/</g, '&lt;').replace(/'/g, '&#39;').replace(/"/g, '&quot;');
+
+function cardHtml(i) {
+  return `<div class='card p-2 text-center btn-card' id='card${i}'>`
+    + `<b class='mb-2'>${esc(T.button_label)} ${i + 1}</b>`
+    + `<input type='text' name='b${i}l' class='form-control form-control-sm mb-1' placeholder='${esc(T.btn_name_ph)}' maxlength='15'>`
+    + `<input type='text' name='b${i}v' id='val${i}' class='form-control form-control-sm mb-1 text-uppercase' placeholder='${esc(T.btn_cmd_ph)}' maxlength='255'>`
+    + `<select name='b${i}t' id='type${i}' class='form-select form-select-sm mb-1' onchange='toggleBuilder(${i})'>`
+    + `<option value='0'>${esc(T.type_app)}</option><option value='1'>${esc(T.type_media)}</option>`
+    + `<option value='2'>${esc(T.type_basic)}</option><option value='3'>${esc(T.type_adv)}</option></select>`
+    + `<div id='basicHint${i}' class='small text-secondary mb-1 d-none' style='font-size:10px'>${esc(T.basic_combo_desc)}</div>`
+    + `<div id='builder${i}' class='combo-builder d-none'><div class='d-flex flex-wrap justify-content-center gap-1 mb-1'>`
+    + [['c', 'CTRL'], ['s', 'SHFT'], ['a', 'ALT'], ['m', 'META']].map(([k, t]) => `<input type='checkbox' class='btn-check' id='${k}${i}' onchange='updC(${i})'><label class='btn btn-outline-info btn-xs py-0 px-1' style='font-size:10px' for='${k}${i}'>${t}</label>`).join('')
+    + `</div><select id='key${i}' class='form-select form-select-sm' style='font-size:11px' onchange='updC(${i})'></select></div>`
+    + `<div class='d-flex gap-1 align-items-center mb-1 mt-1'>`
+    + `<input type='color' name='b${i}c' class='form-control form-control-color flex-grow-1' style='height:30px' title='${esc(T.color_title)}'>`
+    + `<select name='b${i}icon' class='form-select form-select-sm icon-select' title='${esc(T.icon_title)}'><option value='None'>None</option></select></div>`
+    + `<select name='b${i}i' class='form-select form-select-sm asset-select' title='${esc(T.image_title)}'></select></div>`;
+}
+
+function toggleBuilder(i) {
+  const t = $('type' + i).value;
+  $('builder' + i).classList.toggle('d-none', t != '3');
+  $('basicHint' + i).classList.toggle('d-none', t != '2');
+  if (t == '3') updC(i);
+}
+
+function updC(i) {
+  let c = '';
+  if ($('c' + i).checked) c += 'CTRL+';
+  if ($('s' + i).checked) c += 'SHIFT+';
+  if ($('a' + i).checked) c += 'ALT+';
+  if ($('m' + i).checked) c += 'GUI+';
+  const k = $('key' + i).value;
+  if (k) c += k; else if (c.endsWith('+')) c = c.slice(0, -1);
+  $('val' + i).value = c;
+}
+
+function parseC(i, v) {
+  if (!v) return;
+  const p = v.toUpperCase().split('+');
+  $('c' + i).checked = p.includes('CTRL');
+  $('s' + i).checked = p.includes('SHIFT');
+  $('a' + i).checked = p.includes('ALT');
+  $('m' + i).checked = p.includes('GUI') || p.includes('WIN') || p.includes('CMD');
+  $('key' + i).value = p.find(x => !['CTRL', 'SHIFT', 'ALT', 'GUI', 'WIN', 'CMD'].includes(x)) || '';
+}
+
+function updateVisibleCards(r, c) {
+  const count = r * c;
+  for (let i = 0; i < UI.slots; i++) {
+    const card = $('card' + i);
+    if (card) card.style.display = (i < count) ? 'block' : 'none';
+  }
+}
+
+async function post(url, fields) {
+  const fd = new FormData();
+  for (const k in fields) fd.append(k, fields[k]);
+  return fetch(url, { method: 'POST', body: fd });
+}
+
+async function selectProfile(id) {
+  const r = await post('/api/save', { profile: id });
+  if (!r.ok) alert(await r.text()); // 503: previous edits still being written
+  PAGE = -1; load();
+}
+
+async function addProfile() {
+  const n = prompt(T.profile_name); if (!n) return;
+  const r = await post('/api/profiles', { name: n, copy: '1' });
+  if (!r.ok) { alert(await r.text()); return; }
+  // Done by a device job; its result is the new profile's id
+  const job = await waitJob((await r.json()).job);
+  if (job.state !== 'done') { alert(job.result); return; }
+  selectProfile(parseInt(job.result, 10));
+}
+
+async function removeProfile() {
+  const s = $('profileSelect');
+  if (!confirm(T.delete_file_confirm + s.options[s.selectedIndex].text + '?')) return;
+  const r = await post('/api/profiles', { delete: s.value });
+  if (!r.ok) { alert(await r.text()); return; }
+  const job = await waitJob((await r.json()).job);
+  if (job.state !== 'done') alert(job.result);
+  PAGE = -1; load();
+}
+
+async function setPages(n) { await post('/api/save', { pages: n }); }
+async function addPage() { await setPages(PAGES + 1); PAGE = PAGES; load(); }
+async function removePage() { if (PAGES < 2) return; await setPages(PAGES - 1); if (PAGE >= PAGES - 1) PAGE = PAGES - 2; load(); }
+
+// retry: attempts left when the config changes while it is sent (the device drops the connection)
+async function load(retry = 2) {
+  try {
+    const r = await fetch('/api/config' + (PAGE >= 0 ? '?page=' + PAGE : '')); const d = await r.json();
+    PAGE = d.page; PAGES = d.pages;
+    const ps = $('pageSelect'); ps.innerHTML = ''; for (let p = 0; p < d.pages; p++) ps.innerHTML += `<option value='${p}'>${p + 1}</option>`; ps.value = d.page;
+    $('pageInput').value = d.page;
+    $('removePageBtn').disabled = d.pages < 2;
+    const f = await fetch('/api/files'); const files = await f.json();
+    $('globalBg').value = '#' + d.bg.padStart(6, '0');
+    $('gridSelect').value = d.cols + 'x' + d.rows;
+    $('rowsInput').value = d.rows;
+    $('colsInput').value = d.cols;
+    const pf = $('profileSelect'); pf.innerHTML = d.profiles.map((p, i) => `<option value='${i}'>${esc(p.name)} (${p.os == 1 ? 'macOS' : 'Windows'})</option>`).join(''); pf.value = d.profile;
+    $('removeProfileBtn').disabled = d.profile < UI.builtin;
+    $('langSelect').value = d.lang;
+    if (d.lang != UI.lang) { location.reload(); return; } // changed on the device
+    updateVisibleCards(d.rows, d.cols);
+    document.querySelectorAll('.asset-select').forEach(s => { s.innerHTML = `<option value="">${esc(T.none)}</option>` + files.map(file => `<option value='${esc(file.name)}'>${esc(file.name)}</option>`).join(''); });
+    const keys = KEYS.map(k => `<option value='${k}'>${k || esc(T.select_key_ph)}</option>`).join('');
+    const icons = '<option value="None">None</option>' + Object.entries(UI.symbols).map(([name, char]) => `<option value='${esc(name)}'>${char ? char + ' ' : ''}${esc(name)}</option>`).join('');
+    for (let i = 0; i < UI.slots; i++) $('key' + i).innerHTML = keys;
+    d.buttons.forEach((b, i) => {
+      const lbl = document.getElementsByName(`b${i}l`)[0]; if (!lbl) return;
+      lbl.value = b.label;
+      document.getElementsByName(`b${i}v`)[0].value = b.value;
+      document.getElementsByName(`b${i}t`)[0].value = b.type;
+      document.getElementsByName(`b${i}c`)[0].value = '#' + b.color.padStart(6, '0');
+      const sIcon = document.getElementsByName(`b${i}icon`)[0];
+      sIcon.innerHTML = icons;
+      sIcon.value = b.icon || 'None';
+      document.getElementsByName(`b${i}i`)[0].value = b.img.startsWith('/') ? b.img.substring(1) : b.img;
+      parseC(i, b.value); toggleBuilder(i);
+    });
+    $('fileList').innerHTML = files.map(file => `<li class='list-group-item bg-dark text-white d-flex justify-content-between align-items-center px-2' style='border-color:#333'>${esc(file.name)} ${file.ro ? '' : `<button onclick="del('${esc(file.name)}')" class='btn-del'>×</button>`}</li>`).join('');
+  } catch (e) {
+    if (retry > 0) { setTimeout(() => load(retry - 1), 300); return; }
+    console.error(e);
+  }
+}
+
+async function upload() {
+  const fi = $('fileInput'); if (!fi.files[0]) return;
+  if (/\.tar$/i.test(fi.files[0].name)) { uploadBundle(fi.files[0]); return; }
+  const fd = new FormData(); fd.append('file', fi.files[0]);
+  const r = await fetch('/api/upload', { method: 'POST', body: fd });
+  if (!r.ok) alert(await r.text()); // 507: not enough space, 409: another upload running
+  load();
+}
+
+// Many images in one request: the device extracts the tar as it arrives
+async function uploadBundle(f) {
+  const r = await fetch('/api/bundle', { method: 'POST', headers: { 'Content-Type': 'application/x-tar' }, body: f });
+  const text = await r.text();
+  let res;
+  try { res = JSON.parse(text); } catch (e) { alert(text); load(); return; }
+  const errors = res.files.filter(x => x.error).map(x => x.name + ': ' + x.error);
+  if (res.error) errors.unshift(res.error);
+  if (errors.length) alert(errors.join('\n'));
+  load();
+}
+
+function backup() {
+  // Streamed by the device straight to a file, never held in the page
+  const a = document.createElement('a');
+  a.href = '/api/backup'; a.download = 'pandadeck_backup.json'; a.click();
+}
+
+async function restore() {
+  const fi = $('restoreInput'); if (!fi.files[0]) return; if (!confirm(T.confirm_restore)) return;
+  // The file is sent as is: the device parses it while it arrives
+  const f = fi.files[0], bin = /\.pdbak$/i.test(f.name);
+  const r = await fetch(bin ? '/api/restore.bin' : '/api/restore', { method: 'POST', headers: { 'Content-Type': bin ? 'application/octet-stream' : 'application/json' }, body: f });
+  if (!r.ok) { alert(await r.text()); return; }
+  // Accepted: the device commits it in the background
+  const job = await waitJob((await r.json()).job);
+  if (job.state !== 'done') { alert(job.result); return; }
+  alert(T.restore_ok); location.reload();
+}
+
+async function waitJob(id) {
+  for (;;) {
+    await new Promise(res => setTimeout(res, 400));
+    const j = await (await fetch('/api/jobs?id=' + id)).json();
+    if (j.state === 'done' || j.state === 'failed') return j;
+  }
+}
+
+async function del(name) {
+  if (!confirm(T.delete_file_confirm + name + '?')) return;
+  await post('/api/delete', { filename: name }); load();
+}
+
+async function updateFirmware() {
+  const file = $('otaInput').files[0];
+  if (!file) { alert('Please select a .bin file'); return; }
+  const minSize = 102400, maxSize = 3145728; // 100KB - 3MB
+  if (file.size < minSize || file.size > maxSize) {
+    alert('Invalid file size: ' + (file.size / (1024 * 1024)).toFixed(2) + 'MB. Must be between 100KB and 3MB.');
+    return;
+  }
+  if (!confirm(T.update_firmware_confirm)) return;
+  const fd = new FormData();
+  fd.append('update', file, file.name);
+  // The device checks the image against it; browsers only offer it over https or on localhost
+  let url = '/api/update';
+  if (window.crypto && crypto.subtle) {
+    const sum = new Uint8Array(await crypto.subtle.digest('SHA-256', await file.arrayBuffer()));
+    url += '?sha256=' + Array.from(sum, b => b.toString(16).padStart(2, '0')).join('');
+  }
+  const xhr = new XMLHttpRequest();
+  xhr.open('POST', url, true);
+  const progressContainer = $('otaProgressContainer');
+  const progressBar = $('otaProgressBar');
+  const progressStatus = $('otaProgressStatus');
+  const fail = (msg, ms) => {
+    progressBar.style.width = '0%';
+    progressStatus.style.color = 'red';
+    progressStatus.innerHTML = msg;
+    setTimeout(() => { progressContainer.style.display = 'none'; }, ms);
+  };
+  progressContainer.style.display = 'block';
+  progressStatus.innerHTML = 'Uploading firmware (' + (file.size / (1024 * 1024)).toFixed(2) + 'MB)...';
+  let lastProgressUpdate = 0;
+  xhr.upload.onprogress = (e) => {
+    if (!e.lengthComputable) return;
+    const p = Math.min((e.loaded / e.total) * 100, 99); // 100% once the device confirms
+    const now = Date.now();
+    if (now - lastProgressUpdate > 250) {
+      progressBar.style.width = p + '%';
+      progressStatus.innerHTML = 'Uploading: ' + p.toFixed(1) + '%';
+      lastProgressUpdate = now;
+    }
+  };
+  xhr.onload = () => {
+    progressStatus.style.fontSize = '14px';
+    if (xhr.status === 200) {
+      progressBar.style.width = '100%';
+      progressStatus.style.color = 'green';
+      const res = JSON.parse(xhr.responseText);
+      progressStatus.innerHTML = 'Update successful (' + (res.ms / 1000).toFixed(1) + ' s, ' + res.kbps + ' KB/s)! Device restarting...';
+      setTimeout(() => { location.reload(); }, 5000);
+    } else {
+      console.error('OTA Failed: ' + xhr.status + ' - ' + xhr.responseText);
+      fail('Error: ' + (xhr.responseText || ('HTTP ' + xhr.status)), 5000);
+    }
+  };
+  xhr.onerror = () => fail('Connection failed. Please try again.', 5000);
+  xhr.ontimeout = () => fail('Timeout - Device may still be updating. Wait 30 seconds before retrying.', 8000);
+  xhr.timeout = 300000; // flash writes take a while
+  xhr.send(fd);
+}
+
+async function init() {
+  UI = await (await fetch('/api/ui')).json();
+  T = UI.text;
+  document.title = T.dash_title;
+  document.querySelectorAll('[data-t]').forEach(e => { e.textContent = T[e.dataset.t]; });
+  document.querySelectorAll('[data-t-title]').forEach(e => { e.title = T[e.dataset.tTitle]; });
+  $('version').textContent = 'v' + UI.version;
+  $('gridSelect').innerHTML = UI.grids.map(g => `<option value='${g}'>${g}</option>`).join('');
+  $('buttonContainer').innerHTML = Array.from({ length: UI.slots }, (_, i) => cardHtml(i)).join('');
+
+  $('profileSelect').onchange = (e) => selectProfile(e.target.value);
+  $('langSelect').onchange = async (e) => {
+    await post('/api/save', { lang: e.target.value });
+    location.reload(); // texts come from /api/ui in the new language
+  };
+  $('gridSelect').onchange = (e) => {
+    const [c, r] = e.target.value.split('x').map(Number);
+    $('rowsInput').value = r;
+    $('colsInput').value = c;
+    updateVisibleCards(r, c);
+  };
+  $('pageSelect').onchange = (e) => { PAGE = Number(e.target.value); load(); };
+  $('configForm').onsubmit = async (e) => {
+    e.preventDefault();
+    const r = await fetch('/api/save', { method: 'POST', body: new FormData(e.target) });
+    alert(r.ok ? T.config_saved : await r.text()); load();
+  };
+  load();
+}
+
+init();